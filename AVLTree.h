@@ -5,6 +5,46 @@
 
 #define MAX(a, b) (((a) >= (b))?(a):(b))
 #define HEIGHT(x) ((x)?((x)->height):(0))
+#define MAXCOUNT(x) ((x)?((x)->maxCount):(0))
+#define MIN(a, b) (((a) <= (b))?(a):(b))
+
+//the number of keys whose descents are interleaved by searchBatch
+#define SEARCH_BATCH_GROUP 16
+//the number of nodes that compact moves between two checks
+#define COMPACT_STEP 1024
+//the balancing policies of a tree (see setTreePolicy)
+#define TREE_AVL 0
+#define TREE_WAVL 1
+//the share of deleted nodes that starts a purge and the nodes it visits for
+//every lazy deletion (see lazyDelete)
+#define TREE_PURGE_RATIO 0.25
+#define PURGE_STEP 64
+//a key deleted by lazyDelete keeps its nodes until the purge, with count 0
+#define TOMBSTONE(x) ((x)->count == 0)
+#ifdef __GNUC__
+#define PREFETCH(x) __builtin_prefetch(x)
+#else
+#define PREFETCH(x)
+#endif
+
+/*
+ * Built with -DTREE_STATS, every tree keeps counters of what it does (see
+ * TreeStats); otherwise the counting macros are empty and cost nothing.
+ */
+#ifdef TREE_STATS
+#include <stdio.h>
+#include <string.h>
+#define TREE_COUNT(tree, field, n) ((tree)->stats.field += (n))
+#define TREE_TRACK_HEIGHT(tree) ((tree)->stats.maxHeight = \
+		MAX((tree)->stats.maxHeight, HEIGHT((tree)->root)))
+#else
+#define TREE_COUNT(tree, field, n) ((void)0)
+#define TREE_TRACK_HEIGHT(tree) ((void)0)
+#endif
+#define TREE_COMPARE(tree, a, b) (TREE_COUNT(tree, compares, 1), \
+		(tree)->compare((a), (b)))
+//the lengths of the lists of duplicates are counted in powers of two
+#define TREE_STATS_BUCKETS 16
 
 /*
    IMPORTANT!
@@ -14,6 +54,8 @@
  */
 // -----------------------------------------------------------------------------
 
+struct TreeArena;
+
 typedef struct node{
 	void* elem;
 	void* info;
@@ -23,9 +65,62 @@ typedef struct node{
 	struct node* next;
 	struct node* prev;
 	struct node* end;
+	//with the WAVL policy this is the rank of the node + 1, so that a missing
+	//child still has 0
 	long height;
+	//the number of duplicates of the key and the maximum in the subtree
+	long count;
+	long maxCount;
+	//the block of compact that holds the node, NULL if it was malloc'd alone
+	struct TreeArena *arena;
 }TreeNode;
 
+/*
+ * Optional side index of a tree: an open addressing hash table (linear
+ * probing) from a key to the first node of its list of duplicates.
+ */
+typedef struct HashIndex{
+	TreeNode **slots;
+	long capacity;
+	long size;
+	unsigned long (*hash)(void*);
+}HashIndex;
+
+/*
+ * A block of memory where compact puts nodes one after the other, in the
+ * order of the list. After every node come its key and its info when the
+ * tree knows their sizes (see setFlatSizes). A node that leaves the block
+ * is not freed alone; the block is freed when none of its nodes is left,
+ * whatever tree they ended up in.
+ */
+typedef struct TreeArena{
+	long live;
+	long capacity, used;
+	long elementSize, infoSize, entrySize;
+	char *entries;
+}TreeArena;
+
+#ifdef TREE_STATS
+/*
+ * The counters of a tree. The rotations are those of insert and delete:
+ * rotations counts every single rotation and doubleRotations the pairs of
+ * them that make a double rotation. The fields after maxHeight describe the
+ * tree as it is and are only filled by treeStatsSnapshot; with the WAVL
+ * policy the heights are the ranks + 1. The counters are not atomic, so
+ * queries from several threads at once count approximately.
+ */
+typedef struct TreeStats{
+	long compares;
+	long rotations, doubleRotations;
+	long nodesAllocated, nodesFreed;
+	long maxHeight;
+	long height, nodes, keys;
+	long keyBytes, infoBytes, nodeBytes;
+	//chains[i] is the number of keys with 2^i .. 2^(i + 1) - 1 copies
+	long chains[TREE_STATS_BUCKETS];
+}TreeStats;
+#endif
+
 typedef struct TTree{
 	TreeNode *root;
 	void* (*createElement)(void*);
@@ -34,8 +129,38 @@ typedef struct TTree{
 	void (*destroyInfo)(void*);
 	int (*compare)(void*, void*);
 	long size;
+	//TREE_AVL or TREE_WAVL
+	int policy;
+	HashIndex *hashIndex;
+	//the sizes of the keys and of the infos that compact can copy (0 if they
+	//are not flat blocks of memory)
+	long elementSize, infoSize;
+	//the compaction in progress: the block that is filled, the next node to
+	//move and the last first node of a key that was moved
+	TreeArena *compactArena;
+	TreeNode *compactNext, *compactHead;
+	//the nodes of the keys deleted by lazyDelete, the share of them that
+	//starts a purge and the next key the purge in progress looks at
+	long tombstones;
+	double purgeRatio;
+	TreeNode *purgeNext;
+#ifdef TREE_STATS
+	TreeStats stats;
+#endif
 }TTree;
 
+/*
+ * A position in the list of a tree: a node (any copy of a key) and the first
+ * node of its key, or the end of the list when node is NULL. The steps follow
+ * next/prev, never compare keys and skip the keys deleted by lazyDelete. A
+ * cursor stays valid while the tree is not changed.
+ */
+typedef struct TreeCursor{
+	TTree *tree;
+	TreeNode *node;
+	TreeNode *head;
+}TreeCursor;
+
 /*
  * Name function: createTree
  * Return: the memory address of the tree
@@ -58,9 +183,44 @@ TTree* createTree(void* (*createElement)(void*), void (*destroyElement)(void*),
 	tree->createInfo = createInfo;
 	tree->destroyInfo = destroyInfo;
 	tree->compare = compare;
+	tree->policy = TREE_AVL;
+	tree->hashIndex = NULL;
+	tree->elementSize = tree->infoSize = 0;
+	tree->compactArena = NULL;
+	tree->compactNext = tree->compactHead = NULL;
+	tree->tombstones = 0;
+	tree->purgeRatio = TREE_PURGE_RATIO;
+	tree->purgeNext = NULL;
+#ifdef TREE_STATS
+	memset(&tree->stats, 0, sizeof(TreeStats));
+#endif
 	return tree;
 }
 
+/*
+ * Name function: setTreePolicy
+ * Return: 1 if the policy was set, 0 otherwise
+ * Arguments: the tree and TREE_AVL or TREE_WAVL
+ * Purpose: choose how insert and delete keep the tree balanced. A weak AVL
+ * tree keeps ranks instead of heights: the rank of a child is 1 or 2 smaller
+ * than the rank of its parent and a leaf has rank 0. It has the height of an
+ * AVL tree while there are only insertions and at most twice that after
+ * deletions, but a deletion makes at most two rotations and the ranks change
+ * on O(1) nodes per update, amortized. An AVL tree is a valid WAVL tree, so a
+ * tree can always become WAVL; a WAVL tree can only become AVL while it is
+ * empty.
+ */
+int setTreePolicy(TTree* tree, int policy) {
+	if(policy != TREE_AVL && policy != TREE_WAVL) {
+		return 0;
+	}
+	if(policy == TREE_AVL && tree->policy == TREE_WAVL && tree->root != NULL) {
+		return 0;
+	}
+	tree->policy = policy;
+	return 1;
+}
+
 /*
  * Name function: createTreeNode
  * Return: the memory address of a new node
@@ -78,12 +238,28 @@ TreeNode* createTreeNode(TTree *tree, void* value, void* info) {
 	newNode->next = newNode->prev = NULL;
 	newNode->end = newNode;
 	newNode->height = 1;
+	newNode->count = newNode->maxCount = 1;
+	newNode->arena = NULL;
 	newNode->info = tree->createInfo(info);
 	newNode->elem = tree->createElement(value);
+	TREE_COUNT(tree, nodesAllocated, 1);
 
 	return newNode;
 }
 
+/*
+ * Name function: releaseArena
+ * Return: void (it does not return a value)
+ * Arguments: a block of compact
+ * Purpose: forget one node of a block and free the block after the last one
+ */
+void releaseArena(TreeArena* arena) {
+	arena->live--;
+	if(arena->live == 0) {
+		free(arena);
+	}
+}
+
 /*
  * Name function: destroyTreeNode
  * Return: void (it does not return a value)
@@ -91,9 +267,27 @@ TreeNode* createTreeNode(TTree *tree, void* value, void* info) {
  * Purpose: free the memory of a node
  */
 void destroyTreeNode(TTree *tree, TreeNode* node) {
-	tree->destroyInfo(node->info);
-	tree->destroyElement(node->elem);
-	free(node);
+	TREE_COUNT(tree, nodesFreed, 1);
+	//a compaction in progress goes on from the next node
+	if(tree->compactNext == node) {
+		tree->compactNext = node->next;
+	}
+	//and so does a purge
+	if(tree->purgeNext == node) {
+		tree->purgeNext = node->next;
+	}
+	//the keys and infos that were copied into a block are freed with it
+	if(node->arena == NULL || node->arena->infoSize == 0) {
+		tree->destroyInfo(node->info);
+	}
+	if(node->arena == NULL || node->arena->elementSize == 0) {
+		tree->destroyElement(node->elem);
+	}
+	if(node->arena == NULL) {
+		free(node);
+	} else {
+		releaseArena(node->arena);
+	}
 }
 
 /*
@@ -109,22 +303,148 @@ int isEmpty(TTree* tree) {
 	return 0;
 }
 
+/*
+ * Name function: hashAdd
+ * Return: void (it does not return a value)
+ * Arguments: the hash index and the first node of a key
+ * Purpose: put a node in the first free slot after the slot of its key
+ */
+void hashAdd(HashIndex* index, TreeNode* node) {
+	long mask = index->capacity - 1;
+	long i = index->hash(node->elem) & mask;
+	while(index->slots[i] != NULL) {
+		i = (i + 1) & mask;
+	}
+	index->slots[i] = node;
+	index->size++;
+}
+
+/*
+ * Name function: hashResize
+ * Return: void (it does not return a value)
+ * Arguments: the hash index and the new capacity (a power of two)
+ * Purpose: move every node into a new array of slots
+ */
+void hashResize(HashIndex* index, long capacity) {
+	TreeNode **old = index->slots;
+	long oldCapacity = index->capacity, i;
+	TreeNode **slots = (TreeNode**)calloc(capacity, sizeof(TreeNode*));
+	if(slots == NULL) {
+		printf("Not enough memory\n");
+		return;
+	}
+	index->slots = slots;
+	index->capacity = capacity;
+	index->size = 0;
+	for(i = 0; i < oldCapacity; i++) {
+		if(old[i] != NULL) {
+			hashAdd(index, old[i]);
+		}
+	}
+	free(old);
+}
+
+/*
+ * Name function: hashInsert
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the first node of a new key
+ * Purpose: add a key to the hash index of a tree, if it has one
+ */
+void hashInsert(TTree* tree, TreeNode* node) {
+	HashIndex *index = tree->hashIndex;
+	if(index == NULL) {
+		return;
+	}
+	//keep the table at most half full
+	if(2 * (index->size + 1) > index->capacity) {
+		hashResize(index, index->capacity * 2);
+	}
+	hashAdd(index, node);
+}
+
+/*
+ * Name function: hashRemove
+ * Return: void (it does not return a value)
+ * Arguments: the tree and a node
+ * Purpose: take a node out of the hash index; only the pointers are compared,
+ * so it can be called for duplicates (which are not there) and while other
+ * nodes of the list are being freed
+ */
+void hashRemove(TTree* tree, TreeNode* node) {
+	HashIndex *index = tree->hashIndex;
+	long mask, i, j, home;
+	if(index == NULL) {
+		return;
+	}
+	mask = index->capacity - 1;
+	i = index->hash(node->elem) & mask;
+	while(index->slots[i] != NULL && index->slots[i] != node) {
+		i = (i + 1) & mask;
+	}
+	if(index->slots[i] == NULL) {
+		return;
+	}
+	index->slots[i] = NULL;
+	index->size--;
+	//move back the nodes that would not be found after the new gap
+	j = i;
+	while(1) {
+		j = (j + 1) & mask;
+		if(index->slots[j] == NULL) {
+			break;
+		}
+		home = index->hash(index->slots[j]->elem) & mask;
+		if(((j - home) & mask) >= ((j - i) & mask)) {
+			index->slots[i] = index->slots[j];
+			index->slots[j] = NULL;
+			i = j;
+		}
+	}
+}
+
+/*
+ * Name function: hashSearch
+ * Return: the first node of a key, NULL if it is not in the tree
+ * Arguments: the tree and the key
+ * Purpose: exact search in O(1) through the hash index
+ */
+TreeNode* hashSearch(TTree* tree, void* elem) {
+	HashIndex *index = tree->hashIndex;
+	long mask = index->capacity - 1;
+	long i = index->hash(elem) & mask;
+	while(index->slots[i] != NULL) {
+		if(TREE_COMPARE(tree, index->slots[i]->elem, elem) == 0) {
+			return index->slots[i];
+		}
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
 /*
  * Name function: search
  * Return: the memory adress of a node with a specific elem
  * Arguments: the tree, the node after which I am searching
- * Purpose: find a node with a specific data
+ * Purpose: find a node with a specific data; a search from tree->root uses
+ * the hash index when one is enabled
  */
 TreeNode* search(TTree* tree, TreeNode* x, void* elem) {
 	TreeNode *node;
 	node = x;
 
+	//an exact search in the whole tree can use the hash index
+	if(x != NULL && x == tree->root && tree->hashIndex != NULL) {
+		node = hashSearch(tree, elem);
+		return (node != NULL && TOMBSTONE(node)) ? NULL : node;
+	}
+
 	//start searching after the given node
 	while(node != NULL) {
-		if(tree->compare(node->elem, elem) == 0) {
-			return node;
+		if(TREE_COMPARE(tree, node->elem, elem) == 0) {
+			//a deleted key is not found
+			return TOMBSTONE(node) ? NULL : node;
 		} else {
-			if(tree->compare(node->elem, elem) > 0) {
+			if(TREE_COMPARE(tree, node->elem, elem) > 0) {
 				node = node->lt;
 			} else {
 				node = node->rt;
@@ -134,6 +454,152 @@ TreeNode* search(TTree* tree, TreeNode* x, void* elem) {
 	return NULL;
 }
 
+/*
+ * Name function: liveHead
+ * Return: the first node of the first key from head on that is not deleted,
+ * NULL if there is none
+ * Arguments: the first node of a key (or NULL)
+ * Purpose: skip the keys deleted by lazyDelete along the list
+ */
+TreeNode* liveHead(TreeNode* head) {
+	while(head != NULL && TOMBSTONE(head)) {
+		head = head->end->next;
+	}
+	return head;
+}
+
+/*
+ * Name function: lowerBoundNode
+ * Return: the first node of the smallest key >= elem, NULL if there is none
+ * Arguments: the tree and the key
+ * Purpose: find where an ordered scan starting at elem has to begin
+ */
+TreeNode* lowerBoundNode(TTree* tree, void* elem) {
+	TreeNode *node = tree->root, *bound = NULL;
+	while(node != NULL) {
+		if(TREE_COMPARE(tree, node->elem, elem) >= 0) {
+			bound = node;
+			node = node->lt;
+		} else {
+			node = node->rt;
+		}
+	}
+	return liveHead(bound);
+}
+
+/*
+ * Name function: descendBatch
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the keys, their number, the results and whether it is
+ * a lower bound (1) or an exact search (0)
+ * Purpose: do the descents of a group of keys at the same time; every step of
+ * a key first prefetches its next node, then (on the next round) the key of
+ * that node, and only compares it on the round after, so the cache misses of
+ * the whole group overlap instead of being waited for one by one
+ */
+void descendBatch(TTree* tree, void** keys, long n, TreeNode** out,
+		int lower) {
+	TreeNode *node[SEARCH_BATCH_GROUP];
+	int state[SEARCH_BATCH_GROUP];
+	long base, i, group, active;
+	int cmp;
+
+	for(base = 0; base < n; base += SEARCH_BATCH_GROUP) {
+		group = MIN(SEARCH_BATCH_GROUP, n - base);
+		active = 0;
+		for(i = 0; i < group; i++) {
+			out[base + i] = NULL;
+			node[i] = tree->root;
+			state[i] = 0;
+			if(node[i] != NULL) {
+				PREFETCH(node[i]);
+				active++;
+			}
+		}
+		while(active > 0) {
+			for(i = 0; i < group; i++) {
+				if(node[i] == NULL) {
+					continue;
+				}
+				//the node is in cache: ask for its key
+				if(state[i] == 0) {
+					PREFETCH(node[i]->elem);
+					state[i] = 1;
+					continue;
+				}
+				//the key is in cache: compare and move one level down
+				cmp = TREE_COMPARE(tree, node[i]->elem, keys[base + i]);
+				if(lower) {
+					if(cmp >= 0) {
+						out[base + i] = node[i];
+						node[i] = node[i]->lt;
+					} else {
+						node[i] = node[i]->rt;
+					}
+				} else {
+					if(cmp == 0) {
+						out[base + i] = node[i];
+						node[i] = NULL;
+					} else {
+						node[i] = (cmp > 0) ? node[i]->lt : node[i]->rt;
+					}
+				}
+				state[i] = 0;
+				if(node[i] != NULL) {
+					PREFETCH(node[i]);
+				} else {
+					active--;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Name function: searchBatch
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the keys, their number and an array for the results
+ * Purpose: search many keys at once; out[i] is what search would return for
+ * keys[i]
+ */
+void searchBatch(TTree* tree, void** keys, long n, TreeNode** out) {
+	long i;
+	if(tree == NULL) {
+		return;
+	}
+	if(tree->hashIndex != NULL) {
+		for(i = 0; i < n; i++) {
+			out[i] = hashSearch(tree, keys[i]);
+		}
+	} else {
+		descendBatch(tree, keys, n, out, 0);
+	}
+	//a deleted key is not found
+	for(i = 0; i < n; i++) {
+		if(out[i] != NULL && TOMBSTONE(out[i])) {
+			out[i] = NULL;
+		}
+	}
+}
+
+/*
+ * Name function: lowerBoundBatch
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the keys, their number and an array for the results
+ * Purpose: find many lower bounds at once; out[i] is what lowerBoundNode
+ * would return for keys[i]
+ */
+void lowerBoundBatch(TTree* tree, void** keys, long n, TreeNode** out) {
+	long i;
+	if(tree == NULL) {
+		return;
+	}
+	descendBatch(tree, keys, n, out, 1);
+	for(i = 0; i < n; i++) {
+		out[i] = liveHead(out[i]);
+	}
+}
+
 /*
  * Name function: minimum
  * Return: the memory adress of a node with the minimum elem
@@ -183,7 +649,7 @@ TreeNode* successor(TTree* tree, TreeNode* x) {
 		t=x->pt;
 		//searching for the successor between the parents of the given node
 		while(t != NULL) {
-			if(tree->compare(t->elem, x->elem) > 0) {
+			if(TREE_COMPARE(tree, t->elem, x->elem) > 0) {
 				return t;
 			}
 			t=t->pt;
@@ -207,7 +673,7 @@ TreeNode* predecessor(TTree* tree, TreeNode* x) {
 		t=x->pt;
 		//searching for the successor between the parents of the given node
 		while(t != NULL){
-			if(tree->compare(t->elem, x->elem) < 0) {
+			if(TREE_COMPARE(tree, t->elem, x->elem) < 0) {
 				return t;
 			}
 			t=t->pt;
@@ -216,6 +682,191 @@ TreeNode* predecessor(TTree* tree, TreeNode* x) {
 	}
 }
 
+/*
+ * Name function: upperBoundNode
+ * Return: the first node of the smallest key > elem, NULL if there is none
+ * Arguments: the tree and the key
+ * Purpose: find where an ordered scan after elem has to begin
+ */
+TreeNode* upperBoundNode(TTree* tree, void* elem) {
+	TreeNode *node = tree->root, *bound = NULL;
+	while(node != NULL) {
+		if(TREE_COMPARE(tree, node->elem, elem) > 0) {
+			bound = node;
+			node = node->lt;
+		} else {
+			node = node->rt;
+		}
+	}
+	return liveHead(bound);
+}
+
+/*
+ * Name function: previousHead
+ * Return: the first node of the key before the key of head, NULL if there is
+ * none
+ * Arguments: the tree and the first node of a key
+ * Purpose: the predecessor of a node in the tree, found from the links alone
+ */
+TreeNode* previousHead(TTree* tree, TreeNode* head) {
+	if(head->lt != NULL) {
+		return maximum(tree, head->lt);
+	}
+	//go up until the node is a right child
+	while(head->pt != NULL && head->pt->lt == head) {
+		head = head->pt;
+	}
+	return head->pt;
+}
+
+/*
+ * Name function: liveBefore
+ * Return: the first node of the last key from head backwards that is not
+ * deleted, NULL if there is none
+ * Arguments: the tree and the first node of a key (or NULL)
+ * Purpose: skip the keys deleted by lazyDelete going back
+ */
+TreeNode* liveBefore(TTree* tree, TreeNode* head) {
+	while(head != NULL && TOMBSTONE(head)) {
+		head = previousHead(tree, head);
+	}
+	return head;
+}
+
+/*
+ * Name function: cursorAt
+ * Return: a cursor
+ * Arguments: the tree and the first node of a key (NULL for the end)
+ * Purpose: make a cursor on the first copy of a key, or of the next key that
+ * is not deleted
+ */
+TreeCursor cursorAt(TTree* tree, TreeNode* head) {
+	TreeCursor cursor;
+	cursor.tree = tree;
+	cursor.node = cursor.head = liveHead(head);
+	return cursor;
+}
+
+/*
+ * Name function: lowerBound
+ * Return: a cursor on the first copy of the smallest key >= elem (the end if
+ * there is none)
+ * Arguments: the tree and the key
+ * Purpose: start an ordered scan at elem
+ */
+TreeCursor lowerBound(TTree* tree, void* elem) {
+	return cursorAt(tree, lowerBoundNode(tree, elem));
+}
+
+/*
+ * Name function: upperBound
+ * Return: a cursor on the first copy of the smallest key > elem (the end if
+ * there is none)
+ * Arguments: the tree and the key
+ * Purpose: start an ordered scan after elem
+ */
+TreeCursor upperBound(TTree* tree, void* elem) {
+	return cursorAt(tree, upperBoundNode(tree, elem));
+}
+
+/*
+ * Name function: cursorFirst
+ * Return: a cursor on the first node of the list (the end if the tree is
+ * empty)
+ * Arguments: the tree
+ * Purpose: start a scan of the whole tree
+ */
+TreeCursor cursorFirst(TTree* tree) {
+	return cursorAt(tree, minimum(tree, tree->root));
+}
+
+/*
+ * Name function: cursorSeek
+ * Return: 1 if the cursor is on a node, 0 if it is at the end
+ * Arguments: a cursor and a key
+ * Purpose: move the cursor to the first copy of the smallest key >= elem,
+ * forwards or backwards
+ */
+int cursorSeek(TreeCursor* cursor, void* elem) {
+	*cursor = lowerBound(cursor->tree, elem);
+	return cursor->node != NULL;
+}
+
+/*
+ * Name function: cursorNext
+ * Return: 1 if the cursor is on a node, 0 if it is at the end
+ * Arguments: a cursor that is not at the end
+ * Purpose: move to the next node of the list, duplicates included
+ */
+int cursorNext(TreeCursor* cursor) {
+	TreeNode *node = cursor->node;
+	cursor->node = node->next;
+	//after the last copy comes the first copy of the next key
+	if(node == cursor->head->end) {
+		cursor->node = cursor->head = liveHead(cursor->node);
+	}
+	return cursor->node != NULL;
+}
+
+/*
+ * Name function: cursorPrev
+ * Return: 1 if the cursor is on a node, 0 if it was on the first one
+ * Arguments: a cursor
+ * Purpose: move to the node before in the list, duplicates included; from the
+ * end it moves to the last node
+ */
+int cursorPrev(TreeCursor* cursor) {
+	TreeNode *head;
+	if(cursor->node == NULL) {
+		head = liveBefore(cursor->tree, maximum(cursor->tree, cursor->tree->root));
+		cursor->head = head;
+		cursor->node = (head != NULL) ? head->end : NULL;
+		return cursor->node != NULL;
+	}
+	if(cursor->node != cursor->head) {
+		cursor->node = cursor->node->prev;
+		return 1;
+	}
+	//before the first copy comes the last copy of the key before
+	head = liveBefore(cursor->tree, previousHead(cursor->tree, cursor->head));
+	if(head == NULL) {
+		return 0;
+	}
+	cursor->head = head;
+	cursor->node = head->end;
+	return 1;
+}
+
+/*
+ * Name function: cursorNextKey
+ * Return: 1 if the cursor is on a node, 0 if it is at the end
+ * Arguments: a cursor that is not at the end
+ * Purpose: skip the other copies of the key and move to the next key
+ */
+int cursorNextKey(TreeCursor* cursor) {
+	cursor->node = cursor->head = liveHead(cursor->head->end->next);
+	return cursor->node != NULL;
+}
+
+/*
+ * Name function: cursorPrevKey
+ * Return: 1 if the cursor is on a node, 0 if it was on the first key
+ * Arguments: a cursor
+ * Purpose: move to the first copy of the key before; from the end it moves
+ * to the first copy of the last key
+ */
+int cursorPrevKey(TreeCursor* cursor) {
+	TreeNode *head = (cursor->node == NULL) ?
+			maximum(cursor->tree, cursor->tree->root) :
+			previousHead(cursor->tree, cursor->head);
+	head = liveBefore(cursor->tree, head);
+	if(head == NULL) {
+		return 0;
+	}
+	cursor->node = cursor->head = head;
+	return 1;
+}
+
 /*
  * Name function: max
  * Return: the maximum of two integers
@@ -226,6 +877,56 @@ long max(long a, long b) {
 	return (a > b)? a : b;
 }
 
+/*
+ * Name function: refreshNode
+ * Return: void (it does not return a value)
+ * Arguments: the node
+ * Purpose: recompute the height and the maximum count of a node from its
+ * children
+ */
+void refreshNode(TreeNode* x) {
+	x->height = MAX(HEIGHT(x->lt), HEIGHT(x->rt)) + 1;
+	x->maxCount = MAX(x->count, MAX(MAXCOUNT(x->lt), MAXCOUNT(x->rt)));
+}
+
+/*
+ * Name function: refreshCounts
+ * Return: void (it does not return a value)
+ * Arguments: the lowest node whose count or children changed and the last
+ * node that has to be recomputed in any case (NULL for none)
+ * Purpose: update the maximum counts up the tree, stopping at the first node
+ * whose maximum count does not change
+ */
+void refreshCounts(TreeNode* x, TreeNode* last) {
+	long before;
+	for(; x != NULL; x = x->pt) {
+		before = x->maxCount;
+		x->maxCount = MAX(x->count, MAX(MAXCOUNT(x->lt), MAXCOUNT(x->rt)));
+		if(x == last) {
+			last = NULL;
+			continue;
+		}
+		if(last == NULL && x->maxCount == before) {
+			return;
+		}
+	}
+}
+
+/*
+ * Name function: refreshRotated
+ * Return: void (it does not return a value)
+ * Arguments: the tree and a node that was rotated
+ * Purpose: recompute the height and the maximum count of a node after a
+ * rotation; the ranks of a WAVL tree are set by the caller
+ */
+void refreshRotated(TTree* tree, TreeNode* x) {
+	if(tree->policy == TREE_WAVL) {
+		x->maxCount = MAX(x->count, MAX(MAXCOUNT(x->lt), MAXCOUNT(x->rt)));
+	} else {
+		refreshNode(x);
+	}
+}
+
 /*
  * Name function: avlRotateLeft
  * Return: void (it does not return a value)
@@ -261,23 +962,10 @@ void avlRotateLeft(TTree* tree, TreeNode* x) {
 	pivot->lt->rt=pivot_left;
 	x->pt = pivot;
 
-	//change heights
-	int pivot_hl = 0, pivot_hr = 0, x_hl = 1, x_hr = 1;
-	if(x->rt != NULL) {
-		x_hr = x->rt->height;
-	}
-	if(x->lt != NULL) {
-		x_hl = x->lt->height;
-	}
-	x->height = max(x_hl, x_hr) + 1;
-
-	if(pivot->lt != NULL)   {
-		pivot_hl = pivot->lt->height;
-	}
-	if(pivot->rt != NULL) {
-		pivot_hr = pivot->rt->height;
-	}
-	pivot->height = max(pivot_hl, pivot_hr) + 1;
+	TREE_COUNT(tree, rotations, 1);
+	//change heights and counts
+	refreshRotated(tree, x);
+	refreshRotated(tree, pivot);
 }
 
 /*
@@ -315,23 +1003,10 @@ void avlRotateRight(TTree* tree, TreeNode* y) {
 	pivot->rt->lt=pivot_right;
 	y->pt = pivot;
 
-	//change heights
-	int pivot_hl = 0, pivot_hr = 0, y_hl = 0, y_hr = 0;
-	if(y->rt != NULL) {
-		y_hr = y->rt->height;
-	}
-	if(y->lt != NULL) {
-		y_hl = y->lt->height;
-	}
-	y->height = max(y_hl, y_hr) + 1;
-
-	if(pivot->lt != NULL)   {
-		pivot_hl = pivot->lt->height;
-	}
-	if(pivot->rt != NULL) {
-		pivot_hr = pivot->rt->height;
-	}
-	pivot->height = max(pivot_hl, pivot_hr) + 1;
+	TREE_COUNT(tree, rotations, 1);
+	//change heights and counts
+	refreshRotated(tree, y);
+	refreshRotated(tree, pivot);
 }
 
 /*
@@ -354,6 +1029,20 @@ int avlGetBalance(TTree* tree, TreeNode *x) {
 	return l_height - r_height;
 }
 
+/*
+ * Name function: refreshHeights
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the node above which I am updating the heights
+ * Purpose: update the height and the maximum count of nodes after an insertion
+ */
+void refreshHeights(TTree *tree, TreeNode *copy) {
+	//the maximum counts are kept up to date on the same path
+	while(copy != NULL)   {
+		refreshNode(copy);
+		copy = copy->pt;
+	}
+}
+
 /*
  * Name function: avlFixUp
  * Return: void (it does not return a value)
@@ -362,60 +1051,135 @@ int avlGetBalance(TTree* tree, TreeNode *x) {
  */
 void avlFixUp(TTree* tree, TreeNode* y, int balance) {
 
-	if(balance > 1 && tree->compare(y->lt->lt->elem, y->lt->elem) < 0) {
+	if(balance > 1 && TREE_COMPARE(tree, y->lt->lt->elem, y->lt->elem) < 0) {
 		avlRotateRight(tree, y);
+		refreshHeights(tree, y);
 		return;
 	}
 	if(y->rt->rt != NULL) {
-		if(balance < -1 && tree->compare(y->rt->rt->elem, y->rt->elem) > 0) {
+		if(balance < -1 && TREE_COMPARE(tree, y->rt->rt->elem, y->rt->elem) > 0) {
 			avlRotateLeft(tree, y);
+			refreshHeights(tree, y);
 			return;
 		}
 	}	
 	if(y->rt->lt != NULL) {
-		if(balance < -1 && tree->compare(y->rt->lt->elem, y->rt->elem) < 0) {
+		if(balance < -1 && TREE_COMPARE(tree, y->rt->lt->elem, y->rt->elem) < 0) {
 			avlRotateRight(tree, y->rt);
 			avlRotateLeft(tree, y);
+			TREE_COUNT(tree, doubleRotations, 1);
+			refreshHeights(tree, y);
 			return;
 		}
 	}
 	if(y->lt->rt != NULL) {
-		if(balance > 1 && tree->compare(y->lt->rt->elem, y->lt->elem) > 0) {
+		if(balance > 1 && TREE_COMPARE(tree, y->lt->rt->elem, y->lt->elem) > 0) {
 			avlRotateLeft(tree, y->lt);
 			avlRotateRight(tree, y);
+			TREE_COUNT(tree, doubleRotations, 1);
+			refreshHeights(tree, y);
 			return;
 		}
 	}
 }
 
 /*
- * Name function: refreshHeights
+ * Name function: wavlInsertFixUp
  * Return: void (it does not return a value)
- * Arguments: the tree, the node above which I am updating the heights
- * Purpose: update the height of nodes after an insertion
+ * Arguments: the tree and a new leaf
+ * Purpose: promote the nodes that got a child of their own rank, until one
+ * that can be fixed with a rotation or a double rotation
  */
-void refreshHeights(TTree *tree, TreeNode *copy) {
-	while(copy != NULL)   {
-		if(copy->lt == NULL && copy->rt == NULL) {
-			copy->height = 1;
-			copy = copy->pt;
-		} else {
-			//if there is no left subtree the height is given by the right subtree
-			if(copy->lt == NULL) {
-				copy->height = copy->rt->height + 1;
-				copy = copy->pt;
+void wavlInsertFixUp(TTree* tree, TreeNode* x) {
+	TreeNode *p = x->pt, *sibling, *inner;
+	int left;
+	while(p != NULL && p->height == x->height) {
+		left = (p->lt == x);
+		sibling = left ? p->rt : p->lt;
+		if(p->height - HEIGHT(sibling) == 1) {
+			p->height++;
+			x = p;
+			p = p->pt;
+			continue;
+		}
+		//the sibling is two ranks lower
+		inner = left ? x->rt : x->lt;
+		if(x->height - HEIGHT(inner) == 2) {
+			if(left) {
+				avlRotateRight(tree, p);
 			} else {
-				//if there is no right subtree the height is given by the left subtree
-				if(copy->rt == NULL) {
-					copy->height = copy->lt->height + 1;
-					copy = copy->pt;
-				} else {
-					copy->height = max(copy->lt->height, copy->rt->height) + 1;
-					copy = copy->pt;
-				}
+				avlRotateLeft(tree, p);
 			}
+			p->height--;
+		} else {
+			if(left) {
+				avlRotateLeft(tree, x);
+				avlRotateRight(tree, p);
+			} else {
+				avlRotateRight(tree, x);
+				avlRotateLeft(tree, p);
+			}
+			TREE_COUNT(tree, doubleRotations, 1);
+			inner->height++;
+			x->height--;
+			p->height--;
+		}
+		return;
+	}
+}
+
+/*
+ * Name function: dropCopies
+ * Return: the number of freed nodes
+ * Arguments: the tree and the first node of a key
+ * Purpose: free the duplicates of a key, so that only its first node is left
+ */
+long dropCopies(TTree* tree, TreeNode* head) {
+	TreeNode *node = head->next, *last = head->end, *next;
+	long count = 0;
+	if(head == last) {
+		return 0;
+	}
+	//take the copies out of the list first, then free them
+	head->next = last->next;
+	if(last->next != NULL) {
+		last->next->prev = head;
+	}
+	head->end = head;
+	while(1) {
+		next = node->next;
+		destroyTreeNode(tree, node);
+		count++;
+		if(node == last) {
+			return count;
 		}
+		node = next;
+	}
+}
+
+/*
+ * Name function: reviveKey
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the first node of a deleted key and a new node with
+ * the same key
+ * Purpose: insert into a key deleted by lazyDelete: its first node takes the
+ * info of the new node and is the only copy of the key again
+ */
+void reviveKey(TTree* tree, TreeNode* head, TreeNode* node) {
+	void *info;
+	tree->tombstones -= dropCopies(tree, head) + 1;
+	//an info inside a block of compact is overwritten where it is
+	if(head->arena != NULL && head->arena->infoSize != 0) {
+		memcpy(head->info, node->info, head->arena->infoSize);
+	} else {
+		info = head->info;
+		head->info = node->info;
+		node->info = info;
 	}
+	destroyTreeNode(tree, node);
+	head->count = 1;
+	tree->size++;
+	refreshCounts(head, NULL);
 }
 
 /*
@@ -434,18 +1198,24 @@ void insert(TTree* tree, void* elem, void* info) {
 	if(isEmpty(tree) != 0) {
 		tree->root = new_node;
 		tree->size = 1;
+		hashInsert(tree, new_node);
+		TREE_TRACK_HEIGHT(tree);
 	} else {
 		TreeNode *copy, *prev;
 		copy = tree->root;
 		//find the right place to insert the new node
 		while(copy != NULL) {
 			prev = copy;
-			if(tree->compare(copy->elem, elem) > 0) {
+			if(TREE_COMPARE(tree, copy->elem, elem) > 0) {
 				copy = copy->lt;
 			} else {  
-				if(tree->compare(copy->elem, elem) < 0) {
+				if(TREE_COMPARE(tree, copy->elem, elem) < 0) {
 					copy = copy->rt;
 				} else {
+					if(TOMBSTONE(copy)) {
+						reviveKey(tree, copy, new_node);
+						return;
+					}
 					//if the node already exists update links
 					new_node->next = copy->end->next;
 					new_node->prev = copy->end;
@@ -454,26 +1224,49 @@ void insert(TTree* tree, void* elem, void* info) {
 						new_node->next->prev = new_node;
 					}
 					copy->end = new_node;
+					copy->count++;
+					//every copy counts, like in delete and splitTree
+					tree->size++;
+					refreshCounts(copy, NULL);
 					return;
 				}
 			}
 		} 
 
 		//set the parent of the new node
-		if(tree->compare(prev->elem, elem)) {
+		if(TREE_COMPARE(tree, prev->elem, elem)) {
 			//check if it should be added in the left or right position
-			if(tree->compare(prev->elem, elem) > 0) {
+			if(TREE_COMPARE(tree, prev->elem, elem) > 0) {
+				//a new left leaf comes right before its parent in the list
 				new_node->pt = prev;
 				prev->lt = new_node;
-				new_node->prev = prev;
-				new_node->prev->next = new_node;
+				new_node->next = prev;
+				new_node->prev = prev->prev;
+				if(new_node->prev != NULL) {
+					new_node->prev->next = new_node;
+				}
+				prev->prev = new_node;
 			} else {
+				//a new right leaf comes right after the duplicates of its parent
 				new_node->pt = prev;
 				prev->rt = new_node;
 				new_node->prev = prev->end;
-				new_node->prev->end->next = new_node;
+				new_node->next = prev->end->next;
+				if(new_node->next != NULL) {
+					new_node->next->prev = new_node;
+				}
+				prev->end->next = new_node;
 			}
 			tree->size++;
+			hashInsert(tree, new_node);
+			if(tree->policy == TREE_WAVL) {
+				//a new leaf only raises the maximum counts of the keys
+				//deleted by lazyDelete
+				refreshCounts(prev, NULL);
+				wavlInsertFixUp(tree, new_node);
+				TREE_TRACK_HEIGHT(tree);
+				return;
+			}
 			copy = prev;
 			//change the height of each node
 			refreshHeights(tree, copy);
@@ -486,24 +1279,35 @@ void insert(TTree* tree, void* elem, void* info) {
 			copy = copy->pt;
 			balance = avlGetBalance(tree, copy);
 		}
-		if(balance > 1 && tree->compare(elem, copy->lt->elem) < 0) {
+		if(balance > 1 && TREE_COMPARE(tree, elem, copy->lt->elem) < 0) {
 			avlRotateRight(tree, copy);
+			refreshHeights(tree, copy);
+			TREE_TRACK_HEIGHT(tree);
 			return;
 		}
-		if(balance < -1 && tree->compare(elem, copy->rt->elem) > 0) {
+		if(balance < -1 && TREE_COMPARE(tree, elem, copy->rt->elem) > 0) {
 			avlRotateLeft(tree, copy);
+			refreshHeights(tree, copy);
+			TREE_TRACK_HEIGHT(tree);
 			return;
 		}
-		if(balance < -1 && tree->compare(elem, copy->rt->elem) < 0) {
+		if(balance < -1 && TREE_COMPARE(tree, elem, copy->rt->elem) < 0) {
 			avlRotateRight(tree, copy->rt);
 			avlRotateLeft(tree, copy);
+			TREE_COUNT(tree, doubleRotations, 1);
+			refreshHeights(tree, copy);
+			TREE_TRACK_HEIGHT(tree);
 			return;
 		}
-		if(balance > 1 && tree->compare(elem, copy->lt->elem) > 0) {
+		if(balance > 1 && TREE_COMPARE(tree, elem, copy->lt->elem) > 0) {
 			avlRotateLeft(tree, copy->lt);
 			avlRotateRight(tree, copy);
+			TREE_COUNT(tree, doubleRotations, 1);
+			refreshHeights(tree, copy);
+			TREE_TRACK_HEIGHT(tree);
 			return;
 		}
+		TREE_TRACK_HEIGHT(tree);
 	}
 }
 
@@ -511,28 +1315,174 @@ void insert(TTree* tree, void* elem, void* info) {
  * Name function: change
  * Return: void (it does not return a value)
  * Arguments: the tree, the node and its parent
- * Purpose: erase the link between the node and the parent
+ * Purpose: erase the link between the node and the parent; the heights are
+ * updated by the rebalancing that follows
  */
 void change(TTree* tree, TreeNode* node, TreeNode* parent) {
-	//if the leaf is a left child erase link and update heights
+	//if the leaf is a left child erase link
 	if(node == parent->lt) {
-		parent->lt == NULL;
-		if(parent->rt != NULL) {
-			parent->height = parent->rt->height + 1;
+		parent->lt = NULL;
+	} else {
+		//if the leaf is a right child erase link
+		parent->rt = NULL;
+	}
+}
+
+/*
+ * Name function: replaceChild
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the node and the node that takes its place
+ * Purpose: link the parent of a node (or the root) to another node
+ */
+void replaceChild(TTree* tree, TreeNode* node, TreeNode* other) {
+	if(other != NULL) {
+		other->pt = node->pt;
+	}
+	if(node->pt == NULL) {
+		tree->root = other;
+	} else {
+		if(node->pt->lt == node) {
+			node->pt->lt = other;
 		} else {
-			parent->height = 1;
+			node->pt->rt = other;
 		}
-	} else {
-		//if the leaf is a right child erase link and update heights
-		parent->rt == NULL;
-		if(parent->lt != NULL) {
-			parent->height = parent->lt->height + 1;
+	}
+}
+
+/*
+ * Name function: unlinkNode
+ * Return: void (it does not return a value)
+ * Arguments: a node without duplicates
+ * Purpose: take a node out of the list
+ */
+void unlinkNode(TreeNode* node) {
+	if(node->next != NULL) {
+		node->next->prev = node->prev;
+	}
+	if(node->prev != NULL) {
+		node->prev->next = node->next;
+	}
+}
+
+/*
+ * Name function: avlRebalance
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the lowest node that may be unbalanced
+ * Purpose: update the nodes up to the root and rotate every unbalanced one;
+ * after a deletion more than one rotation can be needed
+ */
+void avlRebalance(TTree* tree, TreeNode* node) {
+	int balance;
+	while(node != NULL) {
+		refreshNode(node);
+		balance = avlGetBalance(tree, node);
+		if(balance > 1) {
+			if(avlGetBalance(tree, node->lt) < 0) {
+				avlRotateLeft(tree, node->lt);
+				TREE_COUNT(tree, doubleRotations, 1);
+			}
+			avlRotateRight(tree, node);
+			node = node->pt;
+		} else {
+			if(balance < -1) {
+				if(avlGetBalance(tree, node->rt) > 0) {
+					avlRotateRight(tree, node->rt);
+					TREE_COUNT(tree, doubleRotations, 1);
+				}
+				avlRotateLeft(tree, node);
+				node = node->pt;
+			}
+		}
+		node = node->pt;
+	}
+}
+
+/*
+ * Name function: wavlDeleteFixUp
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the parent of the place where a node was taken out and
+ * the child that is there now (may be NULL)
+ * Purpose: demote the nodes that got a child three ranks lower, until one
+ * that can be fixed with a rotation or a double rotation
+ */
+void wavlDeleteFixUp(TTree* tree, TreeNode* p, TreeNode* x) {
+	TreeNode *sibling, *inner, *outer;
+	int left;
+	if(p == NULL) {
+		return;
+	}
+	//a leaf can't have rank 1
+	if(p->lt == NULL && p->rt == NULL && p->height == 2) {
+		p->height = 1;
+		x = p;
+		p = p->pt;
+	}
+	while(p != NULL && p->height - HEIGHT(x) == 3) {
+		//x is NULL only when p has one child, on the other side
+		left = (p->lt == x);
+		sibling = left ? p->rt : p->lt;
+		if(p->height - sibling->height == 2) {
+			p->height--;
+			x = p;
+			p = p->pt;
+			continue;
+		}
+		inner = left ? sibling->lt : sibling->rt;
+		outer = left ? sibling->rt : sibling->lt;
+		if(sibling->height - HEIGHT(inner) == 2 &&
+				sibling->height - HEIGHT(outer) == 2) {
+			p->height--;
+			sibling->height--;
+			x = p;
+			p = p->pt;
+			continue;
+		}
+		if(sibling->height - HEIGHT(outer) == 1) {
+			if(left) {
+				avlRotateLeft(tree, p);
+			} else {
+				avlRotateRight(tree, p);
+			}
+			sibling->height++;
+			p->height--;
+			if(p->lt == NULL && p->rt == NULL) {
+				p->height--;
+			}
 		} else {
-			parent->height = 1;
+			if(left) {
+				avlRotateRight(tree, sibling);
+				avlRotateLeft(tree, p);
+			} else {
+				avlRotateLeft(tree, sibling);
+				avlRotateRight(tree, p);
+			}
+			TREE_COUNT(tree, doubleRotations, 1);
+			inner->height += 2;
+			sibling->height--;
+			p->height -= 2;
 		}
+		return;
 	}
 }
 
+/*
+ * Name function: rebalanceDelete
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the parent of the place where a node was taken out,
+ * the child that is there now and the node that took the place of the deleted
+ * one (NULL if none did)
+ * Purpose: keep the tree balanced with its policy after a deletion
+ */
+void rebalanceDelete(TTree* tree, TreeNode* parent, TreeNode* child,
+		TreeNode* moved) {
+	if(tree->policy == TREE_WAVL) {
+		//the counts first, so that the rotations see the right ones
+		refreshCounts(parent, moved);
+		wavlDeleteFixUp(tree, parent, child);
+	} else {
+		avlRebalance(tree, parent);
+	}
+}
 
 /*
  * Name function: deleteLeaf
@@ -542,42 +1492,16 @@ void change(TTree* tree, TreeNode* node, TreeNode* parent) {
  */
 void deleteLeaf(TTree* tree, TreeNode* node) {
 	TreeNode *parent = node->pt;
+	//update the links of the list
+	unlinkNode(node);
+	hashRemove(tree, node);
 	//if it is the only node in the tree
 	if(parent == NULL) {
 		tree->root = NULL;
-		tree->size = 0;
 	} else {
-		//update the links of the list
-		if(node->end->next != NULL) {
-			node->end->next->prev = node->end->prev;
-		}
-		if(node->end->prev != NULL) {
-			node->end->prev->next = node->end->next;
-		}
-		node->end = node->end->prev;
-		tree->size--;
-
 		change(tree, node, parent);
-		if(node->pt->lt == node) {
-			node->pt->lt = NULL;
-		}
-		if(node->pt->rt == node) {
-			node->pt->rt = NULL;
-		}
-
 		//keeping the tree balanced
-		TreeNode *copy = parent;
-		refreshHeights(tree, copy->pt);
-		int balance;
-		balance = avlGetBalance(tree, parent);
-		copy = parent;
-		while(copy->pt != NULL && abs(balance) <= 1) {
-			copy = copy->pt;
-			balance = avlGetBalance(tree, copy);
-		}
-		if(abs(balance) > 1) {
-			avlFixUp(tree, copy, balance);
-		}
+		rebalanceDelete(tree, parent, NULL, NULL);
 	}
 	destroyTreeNode(tree, node);
 }
@@ -589,49 +1513,31 @@ void deleteLeaf(TTree* tree, TreeNode* node) {
  * Purpose: free the memory of a node that has two children and update the tree
  */
 void deleteSplitNode(TTree* tree, TreeNode* node) {
-	TreeNode *copy;
-	copy = successor(tree, node);
-	TreeNode *parent = copy->pt;
-	//update the links of the nodes
+	TreeNode *copy, *parent;
+	//the successor has no left child, so it can be taken out easily
+	copy = minimum(tree, node->rt);
+	parent = copy;
+	if(copy != node->rt) {
+		parent = copy->pt;
+		parent->lt = copy->rt;
+		if(copy->rt != NULL) {
+			copy->rt->pt = parent;
+		}
+		copy->rt = node->rt;
+		node->rt->pt = copy;
+	}
+	//the successor takes the place (and the rank) of the node
 	copy->lt = node->lt;
-	copy->rt = node->rt;
-	node->rt->pt = copy;
+	copy->height = node->height;
 	node->lt->pt = copy;
-	if(node->prev != NULL) {
-		node->prev->next = copy;
-		copy->prev = node->prev->end;
-	}
-
-	//erase the link between the node and the parent
-	if(copy->pt->lt == copy) {
-		copy->pt->lt = NULL;
-	} else {
-		copy->pt->rt = NULL;
-	}
+	replaceChild(tree, node, copy);
+	unlinkNode(node);
+	hashRemove(tree, node);
 
-	//update the parent
-	copy->pt = node->pt;
-	if(node == tree->root) {
-		tree->root = copy;
-	}
-
-	if(node->pt == NULL) {
-		copy->pt = NULL;
-	} else {
-		if(node->pt->lt == node) {
-			node->pt->lt = copy;
-		} else {
-			node->pt->rt = copy; 
-		}
-	}
 	//keeping the tree balanced
-	int balance;
-	balance = avlGetBalance(tree, parent);
-	if(abs(balance) > 1) {
-		avlFixUp(tree, parent, balance);
-	}
+	rebalanceDelete(tree, parent, (parent == copy) ? copy->rt : parent->lt,
+			copy);
 	destroyTreeNode(tree, node);
-	tree->size--;
 }
 
 /*
@@ -643,33 +1549,65 @@ void deleteSplitNode(TTree* tree, TreeNode* node) {
 void deleteOneChildNode(TTree* tree, TreeNode* node) {
 	//update the links
 	if(node->rt != NULL) {
-		node->rt->pt = node->pt;
-		if(node->pt == NULL) {
-			tree->root = node->rt;
-		} else {
-			if(node->pt->lt == node) {
-				node->pt->lt = node->rt;
-			} else {
-				node->pt->rt = node->rt; 
-			}
-		}
-		refreshHeights(tree, node->pt);
+		replaceChild(tree, node, node->rt);
+	} else {
+		replaceChild(tree, node, node->lt);
+	}
+	unlinkNode(node);
+	hashRemove(tree, node);
+	rebalanceDelete(tree, node->pt, (node->rt != NULL) ? node->rt : node->lt,
+			NULL);
+	destroyTreeNode(tree, node);
+}
+
+/*
+ * Name function: removeNode
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the first node of a key without duplicates
+ * Purpose: take a node out of the tree and the list, free it and keep the
+ * tree balanced; the size of the tree is left to the caller
+ */
+void removeNode(TTree* tree, TreeNode* node) {
+	// if the node is a leaf
+	if(node->lt == NULL && node->rt == NULL) {
+		deleteLeaf(tree, node);
 	} else {
-		node->lt->pt = node->pt;
-		if(node->pt == NULL) {
-			tree->root = node->lt;
+		//check for split nodes
+		if(node->lt != NULL && node->rt != NULL) {
+			deleteSplitNode(tree, node);
 		} else {
-			//change the links
-			if(node->pt->lt == node) {
-				node->pt->lt = node->lt;
-			} else {
-				node->pt->rt = node->lt; 
-			}
+			deleteOneChildNode(tree, node);
 		}
-		refreshHeights(tree, node->pt);
 	}
+}
+
+/*
+ * Name function: unlinkLastCopy
+ * Return: the last copy of the key
+ * Arguments: the first node of a key with duplicates
+ * Purpose: take the last copy of a key out of the list
+ */
+TreeNode* unlinkLastCopy(TreeNode* node) {
+	TreeNode *del = node->end;
+	if(del->next != NULL) {
+		del->next->prev = del->prev;
+	}
+	del->prev->next = del->next;
+	node->end = del->prev;
+	return del;
+}
+
+/*
+ * Name function: deleteLastCopy
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the first node of a key with duplicates
+ * Purpose: free the last copy of a key; the tree does not change its shape
+ */
+void deleteLastCopy(TTree* tree, TreeNode* node) {
+	destroyTreeNode(tree, unlinkLastCopy(node));
 	tree->size--;
-	destroyTreeNode(tree, node);
+	node->count--;
+	refreshCounts(node, NULL);
 }
 
 /*
@@ -687,49 +1625,1048 @@ void delete(TTree* tree, void* elem) {
 
 	//if the node has duplicates, update the links of the lists
 	if(node != node->end) {
-		if(node->end->next != NULL) {
-			node->end->next->prev = node->end->prev;
+		deleteLastCopy(tree, node);
+		return;
+	}
+	removeNode(tree, node);
+	tree->size--;
+}
+
+/*
+ * Name function: setPurgeRatio
+ * Return: 1 if the ratio was set, 0 otherwise
+ * Arguments: the tree and a share between 0 and 1
+ * Purpose: choose how many of the nodes can be deleted keys before the lazy
+ * deletions start purging them (TREE_PURGE_RATIO by default)
+ */
+int setPurgeRatio(TTree* tree, double ratio) {
+	if(tree == NULL || ratio < 0 || ratio >= 1) {
+		return 0;
+	}
+	tree->purgeRatio = ratio;
+	return 1;
+}
+
+/*
+ * Name function: purgeStep
+ * Return: 1 if the purge is not over, 0 otherwise
+ * Arguments: the tree and the number of nodes to visit now
+ * Purpose: go along the list a few keys at a time and take the deleted ones
+ * out of the tree for good; insert, delete and the queries can run between
+ * two steps, while split, join, union and deleteRange finish the purge first
+ */
+int purgeStep(TTree* tree, long budget) {
+	TreeNode *node;
+	if(tree == NULL || tree->root == NULL || tree->tombstones == 0) {
+		tree->purgeNext = NULL;
+		return 0;
+	}
+	if(tree->purgeNext == NULL) {
+		tree->purgeNext = minimum(tree, tree->root);
+	}
+	while(budget > 0 && tree->purgeNext != NULL && tree->tombstones > 0) {
+		node = tree->purgeNext;
+		budget--;
+		if(TOMBSTONE(node) == 0) {
+			tree->purgeNext = node->end->next;
+			continue;
 		}
-		if(node->end->prev != NULL) {
-			node->end->prev->next = node->end->next;
+		//the copies of a big key are freed over several steps
+		while(budget > 0 && node != node->end) {
+			destroyTreeNode(tree, unlinkLastCopy(node));
+			tree->tombstones--;
+			budget--;
 		}
+		if(node == node->end) {
+			tree->purgeNext = node->next;
+			tree->tombstones--;
+			removeNode(tree, node);
+		}
+	}
+	if(tree->purgeNext == NULL || tree->tombstones == 0) {
+		tree->purgeNext = NULL;
+		return 0;
+	}
+	return 1;
+}
 
-		TreeNode *del = node->end;
-		node->end = node->end->prev;
-		destroyTreeNode(tree, del);
-		tree->size--;
+/*
+ * Name function: purgeTombstones
+ * Return: void (it does not return a value)
+ * Arguments: the tree
+ * Purpose: take every key deleted by lazyDelete out of the tree now
+ */
+void purgeTombstones(TTree* tree) {
+	if(tree == NULL) {
 		return;
 	}
+	//a purge in progress has already passed some of the keys
+	tree->purgeNext = NULL;
+	while(purgeStep(tree, PURGE_STEP));
+}
 
-	// if the node is a leaf
-	if(node->lt == NULL && node->rt == NULL) {
-		deleteLeaf(tree, node);
+/*
+ * Name function: purgeDue
+ * Return: void (it does not return a value)
+ * Arguments: the tree
+ * Purpose: after a lazy deletion, go on with the purge in progress or start
+ * one when the deleted nodes are more than the ratio of the tree allows
+ */
+void purgeDue(TTree* tree) {
+	if(tree->purgeNext != NULL || tree->tombstones >
+			tree->purgeRatio * (tree->size + tree->tombstones)) {
+		purgeStep(tree, PURGE_STEP);
+	}
+}
+
+/*
+ * Name function: lazyDelete
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the elem to be deleted
+ * Purpose: erase one copy of elem like delete, without changing the shape of
+ * the tree: the last duplicate is unlinked from the list and the only copy of
+ * a key is marked as deleted (its count becomes 0). The searches, the cursors
+ * and the queries skip a deleted key and an insert brings it back; its node
+ * is taken out of the tree by the purge, PURGE_STEP nodes at a time, so every
+ * lazy deletion costs a descent and a bounded amount of work
+ */
+void lazyDelete(TTree* tree, void* elem) {
+	TreeNode *node;
+	if(tree == NULL) {
+		return;
+	}
+	node = search(tree, tree->root, elem);
+	if(node == NULL) {
+		return;
+	}
+	if(node != node->end) {
+		deleteLastCopy(tree, node);
 	} else {
-		//check for split nodes
-		if(node->lt != NULL && node->rt != NULL) {
-			deleteSplitNode(tree, node);
-		} else {
-			deleteOneChildNode(tree, node);
-		}
+		node->count = 0;
+		tree->size--;
+		tree->tombstones++;
+		refreshCounts(node, NULL);
 	}
+	purgeDue(tree);
 }
 
 /*
- * Name function: destroyTree
+ * Name function: lazyDeleteKey
  * Return: void (it does not return a value)
- * Arguments: the tree to be deleted
- * Purpose: free the memory of a tree
+ * Arguments: the tree and a key
+ * Purpose: erase every copy of a key at once, like lazyDelete: the key is
+ * marked as deleted and its nodes wait for the purge
  */
-void destroyTree(TTree* tree) {
+void lazyDeleteKey(TTree* tree, void* elem) {
+	TreeNode *node;
+	if(tree == NULL) {
+		return;
+	}
+	node = search(tree, tree->root, elem);
+	if(node == NULL) {
+		return;
+	}
+	tree->size -= node->count;
+	tree->tombstones += node->count;
+	node->count = 0;
+	refreshCounts(node, NULL);
+	purgeDue(tree);
+}
+/*
+ * Name function: enableHashIndex
+ * Return: 1 if the tree has a hash index, 0 otherwise
+ * Arguments: the tree and the hash function of its keys
+ * Purpose: build a hash index over the keys of a tree; from now on insert and
+ * delete keep it up to date and search uses it for exact lookups
+ */
+int enableHashIndex(TTree* tree, unsigned long (*hash)(void*)) {
+	HashIndex *index;
 	TreeNode *node;
+	if(tree == NULL || hash == NULL) {
+		return 0;
+	}
+	if(tree->hashIndex != NULL) {
+		return 1;
+	}
+	index = (HashIndex*)malloc(sizeof(HashIndex));
+	if(index == NULL) {
+		printf("Not enough memory\n");
+		return 0;
+	}
+	index->capacity = 16;
+	index->size = 0;
+	index->hash = hash;
+	index->slots = (TreeNode**)calloc(index->capacity, sizeof(TreeNode*));
+	if(index->slots == NULL) {
+		printf("Not enough memory\n");
+		free(index);
+		return 0;
+	}
+	tree->hashIndex = index;
+	//the first node of every key, in order
 	node = minimum(tree, tree->root);
-	while(node->next != NULL) {
-		node = node->next;
-		destroyTreeNode(tree, node->prev); 
+	while(node != NULL) {
+		hashInsert(tree, node);
+		node = node->end->next;
 	}
-	destroyTreeNode(tree, node);
-	free(tree);
+	return 1;
+}
+
+/*
+ * Name function: disableHashIndex
+ * Return: void (it does not return a value)
+ * Arguments: the tree
+ * Purpose: free the hash index of a tree
+ */
+void disableHashIndex(TTree* tree) {
+	if(tree == NULL || tree->hashIndex == NULL) {
+		return;
+	}
+	free(tree->hashIndex->slots);
+	free(tree->hashIndex);
+	tree->hashIndex = NULL;
+}
+
+/*
+ * Name function: setFlatSizes
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the sizes of a key and of an info
+ * Purpose: tell compact that the keys and the infos are flat blocks of these
+ * sizes (nothing to free inside them), so they can be copied next to their
+ * nodes; 0 leaves them where they are
+ */
+void setFlatSizes(TTree* tree, long elementSize, long infoSize) {
+	tree->elementSize = elementSize;
+	tree->infoSize = infoSize;
 }
 
+/*
+ * Name function: createArena
+ * Return: the memory address of the block, NULL if there is not enough memory
+ * Arguments: the number of nodes and the sizes of a key and of an info
+ * Purpose: allocate a block for compact; every entry is aligned like a node
+ */
+TreeArena* createArena(long capacity, long elementSize, long infoSize) {
+	long align = sizeof(void*);
+	long entrySize = sizeof(TreeNode) + (elementSize + align - 1) / align * align +
+			(infoSize + align - 1) / align * align;
+	TreeArena *arena = (TreeArena*)malloc(sizeof(TreeArena) +
+			capacity * entrySize);
+	if(arena == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	arena->live = 0;
+	arena->capacity = capacity;
+	arena->used = 0;
+	arena->elementSize = elementSize;
+	arena->infoSize = infoSize;
+	arena->entrySize = entrySize;
+	arena->entries = (char*)(arena + 1);
+	return arena;
+}
+
+/*
+ * Name function: hashReplace
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the first node of a key and the node that replaces it
+ * Purpose: point the slot of a key to the new place of its node
+ */
+void hashReplace(TTree* tree, TreeNode* node, TreeNode* copy) {
+	HashIndex *index = tree->hashIndex;
+	long mask, i;
+	if(index == NULL) {
+		return;
+	}
+	mask = index->capacity - 1;
+	i = index->hash(node->elem) & mask;
+	while(index->slots[i] != NULL && index->slots[i] != node) {
+		i = (i + 1) & mask;
+	}
+	if(index->slots[i] == node) {
+		index->slots[i] = copy;
+	}
+}
+
+/*
+ * Name function: moveNode
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the node
+ * Purpose: copy a node (and its key and info, if they are flat) into the next
+ * entry of the block being filled, make every link point to the copy and
+ * free the old place
+ */
+void moveNode(TTree* tree, TreeNode* node) {
+	TreeArena *arena = tree->compactArena;
+	char *entry = arena->entries + arena->used * arena->entrySize;
+	TreeNode *copy = (TreeNode*)entry;
+	long align = sizeof(void*);
+
+	*copy = *node;
+	copy->arena = arena;
+	arena->used++;
+	arena->live++;
+	if(arena->elementSize != 0) {
+		copy->elem = entry + sizeof(TreeNode);
+		memcpy(copy->elem, node->elem, arena->elementSize);
+	} else {
+		//a key that was in a block gets its own memory again
+		if(node->arena != NULL && node->arena->elementSize != 0) {
+			copy->elem = tree->createElement(node->elem);
+		}
+	}
+	if(arena->infoSize != 0) {
+		copy->info = entry + sizeof(TreeNode) +
+				(arena->elementSize + align - 1) / align * align;
+		memcpy(copy->info, node->info, arena->infoSize);
+	} else {
+		if(node->arena != NULL && node->arena->infoSize != 0) {
+			copy->info = tree->createInfo(node->info);
+		}
+	}
+
+	//the links of the list
+	if(node->prev != NULL) {
+		node->prev->next = copy;
+	}
+	if(tree->purgeNext == node) {
+		tree->purgeNext = copy;
+	}
+	if(node->next != NULL) {
+		node->next->prev = copy;
+	}
+	if(node->pt != NULL || node == tree->root) {
+		//the first node of a key is in the tree and in the hash index
+		replaceChild(tree, node, copy);
+		if(node->lt != NULL) {
+			node->lt->pt = copy;
+		}
+		if(node->rt != NULL) {
+			node->rt->pt = copy;
+		}
+		if(node->end == node) {
+			copy->end = copy;
+		}
+		hashReplace(tree, node, copy);
+		tree->compactHead = copy;
+	} else {
+		//a duplicate comes after the first node of its key, moved just before
+		if(tree->compactHead->end == node) {
+			tree->compactHead->end = copy;
+		}
+	}
+
+	//free the old place, but not what was moved from it
+	if(node->arena == NULL || node->arena->elementSize == 0) {
+		if(arena->elementSize != 0) {
+			tree->destroyElement(node->elem);
+		}
+	}
+	if(node->arena == NULL || node->arena->infoSize == 0) {
+		if(arena->infoSize != 0) {
+			tree->destroyInfo(node->info);
+		}
+	}
+	if(node->arena == NULL) {
+		free(node);
+	} else {
+		releaseArena(node->arena);
+	}
+}
+
+/*
+ * Name function: stopCompaction
+ * Return: void (it does not return a value)
+ * Arguments: the tree
+ * Purpose: end the compaction in progress; the nodes that were not moved yet
+ * stay where they are
+ */
+void stopCompaction(TTree* tree) {
+	if(tree->compactArena == NULL) {
+		return;
+	}
+	//the compaction itself kept the block alive
+	releaseArena(tree->compactArena);
+	tree->compactArena = NULL;
+	tree->compactNext = tree->compactHead = NULL;
+}
+
+/*
+ * Name function: compactStep
+ * Return: 1 if there are still nodes to move, 0 otherwise
+ * Arguments: the tree and the number of nodes to move now
+ * Purpose: move the nodes into one block in the order of the list, a few at a
+ * time; insert, delete and the queries can run between two steps, while
+ * split, join, union and deleteRange end the compaction
+ */
+int compactStep(TTree* tree, long budget) {
+	TreeNode *node;
+	if(tree == NULL || tree->root == NULL) {
+		return 0;
+	}
+	if(tree->compactArena == NULL) {
+		tree->compactArena = createArena(tree->size, tree->elementSize,
+				tree->infoSize);
+		if(tree->compactArena == NULL) {
+			return 0;
+		}
+		tree->compactArena->live = 1;
+		tree->compactNext = minimum(tree, tree->root);
+		tree->compactHead = NULL;
+	}
+	//the nodes inserted in the meantime may not fit; they stay where they are
+	while(budget > 0 && tree->compactNext != NULL &&
+			tree->compactArena->used < tree->compactArena->capacity) {
+		node = tree->compactNext;
+		tree->compactNext = node->next;
+		moveNode(tree, node);
+		budget--;
+	}
+	if(tree->compactNext == NULL ||
+			tree->compactArena->used == tree->compactArena->capacity) {
+		stopCompaction(tree);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Name function: compact
+ * Return: void (it does not return a value)
+ * Arguments: the tree
+ * Purpose: move every node into contiguous memory in the order of the list,
+ * so that the walks along the list read the memory sequentially
+ */
+void compact(TTree* tree) {
+	if(tree == NULL) {
+		return;
+	}
+	//a block started by compactStep may be too small for the nodes of now
+	stopCompaction(tree);
+	while(compactStep(tree, COMPACT_STEP));
+}
+
+/*
+ * Name function: destroyTree
+ * Return: void (it does not return a value)
+ * Arguments: the tree to be deleted
+ * Purpose: free the memory of a tree
+ */
+void destroyTree(TTree* tree) {
+	TreeNode *node;
+	disableHashIndex(tree);
+	stopCompaction(tree);
+	if(tree->root == NULL) {
+		free(tree);
+		return;
+	}
+	node = minimum(tree, tree->root);
+	while(node->next != NULL) {
+		node = node->next;
+		destroyTreeNode(tree, node->prev); 
+	}
+	destroyTreeNode(tree, node);
+	free(tree);
+}
+
+/*
+ * Name function: linkNode
+ * Return: the memory address of the new subtree
+ * Arguments: the left subtree, the node and the right subtree
+ * Purpose: make a subtree out of a node and two subtrees
+ */
+TreeNode* linkNode(TreeNode* l, TreeNode* k, TreeNode* r) {
+	k->lt = l;
+	k->rt = r;
+	k->pt = NULL;
+	if(l != NULL) {
+		l->pt = k;
+	}
+	if(r != NULL) {
+		r->pt = k;
+	}
+	refreshNode(k);
+	return k;
+}
+
+/*
+ * Name function: rotateSubtreeLeft
+ * Return: the new root of the subtree
+ * Arguments: the root of a detached subtree
+ * Purpose: rotate a subtree to the left without knowing the tree it belongs to
+ */
+TreeNode* rotateSubtreeLeft(TreeNode* x) {
+	TreeNode *pivot = x->rt, *parent = x->pt;
+	linkNode(x->lt, x, pivot->lt);
+	linkNode(x, pivot, pivot->rt);
+	pivot->pt = parent;
+	return pivot;
+}
+
+/*
+ * Name function: rotateSubtreeRight
+ * Return: the new root of the subtree
+ * Arguments: the root of a detached subtree
+ * Purpose: rotate a subtree to the right without knowing the tree it belongs to
+ */
+TreeNode* rotateSubtreeRight(TreeNode* y) {
+	TreeNode *pivot = y->lt, *parent = y->pt;
+	linkNode(pivot->rt, y, y->rt);
+	linkNode(pivot->lt, pivot, y);
+	pivot->pt = parent;
+	return pivot;
+}
+
+/*
+ * Name function: balanceSubtree
+ * Return: the new root of the subtree
+ * Arguments: the root of a detached subtree whose children are at most two
+ * levels apart
+ * Purpose: rotate a subtree like avlRebalance does; a join needs this when
+ * its result grew, and with the WAVL policy also when it shrank, because
+ * linkNode gives a node with both children two ranks lower one rank less
+ */
+TreeNode* balanceSubtree(TreeNode* x) {
+	if(HEIGHT(x->lt) > HEIGHT(x->rt) + 1) {
+		if(HEIGHT(x->lt->lt) < HEIGHT(x->lt->rt)) {
+			x->lt = rotateSubtreeLeft(x->lt);
+		}
+		return rotateSubtreeRight(x);
+	}
+	if(HEIGHT(x->rt) > HEIGHT(x->lt) + 1) {
+		if(HEIGHT(x->rt->rt) < HEIGHT(x->rt->lt)) {
+			x->rt = rotateSubtreeRight(x->rt);
+		}
+		return rotateSubtreeLeft(x);
+	}
+	return x;
+}
+
+/*
+ * Name function: joinRight
+ * Return: the root of the joined subtree
+ * Arguments: the left subtree, the middle node and the right subtree
+ * Purpose: join when the left subtree is higher, going down its right spine
+ */
+TreeNode* joinRight(TreeNode* tl, TreeNode* k, TreeNode* tr) {
+	TreeNode *l = tl->lt, *c = tl->rt, *t;
+
+	if(HEIGHT(c) <= HEIGHT(tr) + 1) {
+		t = linkNode(c, k, tr);
+	} else {
+		t = joinRight(c, k, tr);
+	}
+	return balanceSubtree(linkNode(l, tl, t));
+}
+
+/*
+ * Name function: joinLeft
+ * Return: the root of the joined subtree
+ * Arguments: the left subtree, the middle node and the right subtree
+ * Purpose: join when the right subtree is higher, going down its left spine
+ */
+TreeNode* joinLeft(TreeNode* tl, TreeNode* k, TreeNode* tr) {
+	TreeNode *r = tr->rt, *c = tr->lt, *t;
+
+	if(HEIGHT(c) <= HEIGHT(tl) + 1) {
+		t = linkNode(tl, k, c);
+	} else {
+		t = joinLeft(tl, k, c);
+	}
+	return balanceSubtree(linkNode(t, tr, r));
+}
+
+/*
+ * Name function: joinNodes
+ * Return: the root of the joined subtree
+ * Arguments: the left subtree, the middle node and the right subtree
+ * Purpose: build a balanced subtree out of two subtrees and a node that is
+ * greater than every key on the left and smaller than every key on the right
+ */
+TreeNode* joinNodes(TreeNode* tl, TreeNode* k, TreeNode* tr) {
+	TreeNode *root;
+
+	if(HEIGHT(tl) > HEIGHT(tr) + 1) {
+		root = joinRight(tl, k, tr);
+	} else {
+		if(HEIGHT(tr) > HEIGHT(tl) + 1) {
+			root = joinLeft(tl, k, tr);
+		} else {
+			root = linkNode(tl, k, tr);
+		}
+	}
+	root->pt = NULL;
+	return root;
+}
+
+/*
+ * Name function: splitNode
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the root of a subtree, the key and the three results
+ * Purpose: split a subtree in the keys smaller than elem, the node equal to
+ * elem (if there is one) and the keys greater than elem; the lists are not
+ * changed
+ */
+void splitNode(TTree* tree, TreeNode* t, void* elem, TreeNode** l,
+		TreeNode** m, TreeNode** r) {
+	TreeNode *tl, *tr, *part;
+	int cmp;
+
+	if(t == NULL) {
+		*l = *m = *r = NULL;
+		return;
+	}
+	tl = t->lt;
+	tr = t->rt;
+	if(tl != NULL) {
+		tl->pt = NULL;
+	}
+	if(tr != NULL) {
+		tr->pt = NULL;
+	}
+	cmp = TREE_COMPARE(tree, t->elem, elem);
+	if(cmp == 0) {
+		*l = tl;
+		*r = tr;
+		*m = linkNode(NULL, t, NULL);
+	} else {
+		if(cmp > 0) {
+			splitNode(tree, tl, elem, l, m, &part);
+			*r = joinNodes(part, t, tr);
+		} else {
+			splitNode(tree, tr, elem, &part, m, r);
+			*l = joinNodes(tl, t, part);
+		}
+	}
+}
+
+/*
+ * Name function: splitLast
+ * Return: the subtree without its maximum
+ * Arguments: the root of a subtree and the address where the maximum is saved
+ * Purpose: take out the maximum of a subtree and keep the rest balanced
+ */
+TreeNode* splitLast(TreeNode* t, TreeNode** last) {
+	TreeNode *rest;
+
+	if(t->rt == NULL) {
+		*last = t;
+		if(t->lt != NULL) {
+			t->lt->pt = NULL;
+		}
+		return t->lt;
+	}
+	t->rt->pt = NULL;
+	rest = splitLast(t->rt, last);
+	return joinNodes(t->lt, t, rest);
+}
+
+/*
+ * Name function: splitFirst
+ * Return: the subtree without its minimum
+ * Arguments: the root of a subtree and the address where the minimum is saved
+ * Purpose: take out the minimum of a subtree and keep the rest balanced
+ */
+TreeNode* splitFirst(TreeNode* t, TreeNode** first) {
+	TreeNode *rest;
+
+	if(t->lt == NULL) {
+		*first = t;
+		if(t->rt != NULL) {
+			t->rt->pt = NULL;
+		}
+		return t->rt;
+	}
+	t->lt->pt = NULL;
+	rest = splitFirst(t->lt, first);
+	return joinNodes(rest, t, t->rt);
+}
+
+/*
+ * Name function: cutLists
+ * Return: void (it does not return a value)
+ * Arguments: the root of a subtree
+ * Purpose: end the list of a subtree at its minimum and maximum
+ */
+void cutLists(TreeNode* t) {
+	TreeNode *node;
+
+	if(t == NULL) {
+		return;
+	}
+	node = minimum(NULL, t);
+	if(node->prev != NULL) {
+		node->prev->next = NULL;
+		node->prev = NULL;
+	}
+	node = maximum(NULL, t)->end;
+	if(node->next != NULL) {
+		node->next->prev = NULL;
+		node->next = NULL;
+	}
+}
+
+/*
+ * Name function: joinLists
+ * Return: the root of the joined subtree
+ * Arguments: the left subtree, the middle node and the right subtree
+ * Purpose: join two subtrees and a node and also link their lists
+ */
+TreeNode* joinLists(TreeNode* tl, TreeNode* k, TreeNode* tr) {
+	TreeNode *node;
+
+	if(tl != NULL) {
+		node = maximum(NULL, tl)->end;
+		node->next = k;
+		k->prev = node;
+	}
+	if(tr != NULL) {
+		node = minimum(NULL, tr);
+		k->end->next = node;
+		node->prev = k->end;
+	}
+	return joinNodes(tl, k, tr);
+}
+
+/*
+ * Name function: joinPair
+ * Return: the root of the joined subtree
+ * Arguments: the left subtree and the right subtree
+ * Purpose: join two subtrees (and their lists) when there is no middle node
+ */
+TreeNode* joinPair(TreeNode* tl, TreeNode* tr) {
+	TreeNode *last, *rest;
+
+	if(tl == NULL) {
+		return tr;
+	}
+	if(tr == NULL) {
+		return tl;
+	}
+	rest = splitLast(tl, &last);
+	return joinLists(rest, last, tr);
+}
+
+/*
+ * Name function: countList
+ * Return: the number of nodes in a list
+ * Arguments: the first node of the list
+ * Purpose: count the nodes (duplicates included) until the end of a list
+ */
+long countList(TreeNode* node) {
+	long count = 0;
+
+	while(node != NULL) {
+		count++;
+		node = node->next;
+	}
+	return count;
+}
+
+/*
+ * Name function: destroyList
+ * Return: the number of freed nodes
+ * Arguments: the tree and the first node of the list
+ * Purpose: free every node until the end of a list
+ */
+long destroyList(TTree* tree, TreeNode* node) {
+	TreeNode *next;
+	long count = 0;
+
+	while(node != NULL) {
+		next = node->next;
+		hashRemove(tree, node);
+		destroyTreeNode(tree, node);
+		node = next;
+		count++;
+	}
+	return count;
+}
+
+/*
+ * Name function: splitTree
+ * Return: the memory address of a new tree with the keys greater or equal
+ * to elem
+ * Arguments: the tree and the key
+ * Purpose: split a tree in two; the keys smaller than elem stay in the tree
+ */
+TTree* splitTree(TTree* tree, void* elem) {
+	TTree *right;
+	TreeNode *l, *m, *r;
+
+	if(tree == NULL) {
+		return NULL;
+	}
+	stopCompaction(tree);
+	purgeTombstones(tree);
+	right = createTree(tree->createElement, tree->destroyElement,
+			tree->createInfo, tree->destroyInfo, tree->compare);
+	if(right == NULL) {
+		return NULL;
+	}
+	setFlatSizes(right, tree->elementSize, tree->infoSize);
+	right->policy = tree->policy;
+	right->purgeRatio = tree->purgeRatio;
+	splitNode(tree, tree->root, elem, &l, &m, &r);
+	cutLists(l);
+	if(m != NULL) {
+		r = joinNodes(NULL, m, r);
+	}
+	tree->root = l;
+	right->root = r;
+	//the size of the new tree is recounted along its list
+	if(r != NULL) {
+		right->size = countList(minimum(right, r));
+	}
+	//the keys that moved also move to the hash index of the new tree
+	if(tree->hashIndex != NULL) {
+		for(m = minimum(right, r); m != NULL; m = m->end->next) {
+			hashRemove(tree, m);
+		}
+		enableHashIndex(right, tree->hashIndex->hash);
+	}
+	tree->size -= right->size;
+	return right;
+}
+
+/*
+ * Name function: unionNodes
+ * Return: the root of the union
+ * Arguments: the tree and the roots of two subtrees with separate lists
+ * Purpose: merge two subtrees; equal keys get their lists of duplicates
+ * concatenated
+ */
+TreeNode* unionNodes(TTree* tree, TreeNode* t1, TreeNode* t2) {
+	TreeNode *l1, *b, *r1, *l2, *r2, *k, *tl, *tr;
+
+	if(t1 == NULL) {
+		return t2;
+	}
+	if(t2 == NULL) {
+		return t1;
+	}
+	//take the root of the second subtree apart
+	k = t2;
+	l2 = k->lt;
+	r2 = k->rt;
+	if(l2 != NULL) {
+		l2->pt = NULL;
+	}
+	if(r2 != NULL) {
+		r2->pt = NULL;
+	}
+	cutLists(l2);
+	cutLists(r2);
+
+	splitNode(tree, t1, k->elem, &l1, &b, &r1);
+	cutLists(l1);
+	cutLists(r1);
+	if(b != NULL) {
+		b->prev = NULL;
+		b->end->next = NULL;
+	}
+
+	tl = unionNodes(tree, l1, l2);
+	tr = unionNodes(tree, r1, r2);
+
+	//the duplicates of the second tree go after the ones of the first tree
+	if(b != NULL) {
+		b->end->next = k;
+		k->prev = b->end;
+		b->end = k->end;
+		b->count += k->count;
+		k->end = k;
+		k->lt = k->rt = k->pt = NULL;
+		k = b;
+	}
+	return joinLists(tl, k, tr);
+}
+
+/*
+ * Name function: hashMerge
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the tree that is going to be merged into it
+ * Purpose: add to the hash index of tree the keys of other that it does not
+ * have; the nodes of these keys stay the first of their lists after a union
+ */
+void hashMerge(TTree* tree, TTree* other) {
+	TreeNode *node;
+	if(tree->hashIndex != NULL) {
+		for(node = minimum(other, other->root); node != NULL;
+				node = node->end->next) {
+			if(hashSearch(tree, node->elem) == NULL) {
+				hashInsert(tree, node);
+			}
+		}
+	}
+	disableHashIndex(other);
+}
+
+/*
+ * Name function: joinTrees
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the tree that is added to it
+ * Purpose: move every node of other into tree and free other; if the keys of
+ * other are not all greater than the ones of tree, a union is made instead
+ */
+void joinTrees(TTree* tree, TTree* other) {
+	TreeNode *first, *rest;
+
+	if(tree == NULL || other == NULL) {
+		return;
+	}
+	stopCompaction(tree);
+	stopCompaction(other);
+	purgeTombstones(tree);
+	purgeTombstones(other);
+	//an AVL tree is also a WAVL tree, so with a WAVL one the result is WAVL
+	tree->policy = MAX(tree->policy, other->policy);
+	hashMerge(tree, other);
+	if(tree->root == NULL) {
+		tree->root = other->root;
+	} else {
+		if(other->root != NULL) {
+			first = minimum(other, other->root);
+			if(TREE_COMPARE(tree, maximum(tree, tree->root)->elem, first->elem) < 0) {
+				//the minimum of the second tree becomes the middle node
+				rest = splitFirst(other->root, &first);
+				tree->root = joinLists(tree->root, first, rest);
+			} else {
+				tree->root = unionNodes(tree, tree->root, other->root);
+			}
+		}
+	}
+	tree->size += other->size;
+	free(other);
+}
+
+/*
+ * Name function: unionTrees
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the tree that is merged into it
+ * Purpose: move every node of other into tree, keeping duplicates together,
+ * and free other
+ */
+void unionTrees(TTree* tree, TTree* other) {
+	if(tree == NULL || other == NULL) {
+		return;
+	}
+	stopCompaction(tree);
+	stopCompaction(other);
+	purgeTombstones(tree);
+	purgeTombstones(other);
+	//an AVL tree is also a WAVL tree, so with a WAVL one the result is WAVL
+	tree->policy = MAX(tree->policy, other->policy);
+	hashMerge(tree, other);
+	tree->root = unionNodes(tree, tree->root, other->root);
+	tree->size += other->size;
+	free(other);
+}
+
+/*
+ * Name function: deleteRange
+ * Return: void (it does not return a value)
+ * Arguments: the tree and the two keys q, p
+ * Purpose: erase every node (duplicates included) with a key between q and p
+ */
+void deleteRange(TTree* tree, void* q, void* p) {
+	TreeNode *l, *mq, *mid, *mp, *r;
+
+	if(tree == NULL || tree->root == NULL || TREE_COMPARE(tree, q, p) > 0) {
+		return;
+	}
+	stopCompaction(tree);
+	purgeTombstones(tree);
+	splitNode(tree, tree->root, q, &l, &mq, &mid);
+	splitNode(tree, mid, p, &mid, &mp, &r);
+	cutLists(l);
+	cutLists(r);
+
+	//the nodes in the interval form a separate list now, free all of them
+	if(mq != NULL) {
+		tree->size -= destroyList(tree, mq);
+	} else {
+		if(mid != NULL) {
+			tree->size -= destroyList(tree, minimum(tree, mid));
+		} else {
+			if(mp != NULL) {
+				tree->size -= destroyList(tree, mp);
+			}
+		}
+	}
+	tree->root = joinPair(l, r);
+}
+
+#ifdef TREE_STATS
+/*
+ * Name function: treeStatsSnapshot
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the functions that measure a key and an info (NULL
+ * if they are not counted) and the address where the statistics are saved
+ * Purpose: copy the counters of a tree and walk its list for the height, the
+ * memory and the lengths of the lists of duplicates
+ */
+void treeStatsSnapshot(TTree* tree, long (*elementBytes)(void*),
+		long (*infoBytes)(void*), TreeStats* stats) {
+	TreeNode *node, *copy;
+	long copies;
+	int bucket;
+
+	*stats = tree->stats;
+	stats->height = HEIGHT(tree->root);
+	stats->maxHeight = MAX(stats->maxHeight, stats->height);
+	node = (tree->root != NULL) ? minimum(tree, tree->root) : NULL;
+	for(; node != NULL; node = node->end->next) {
+		copies = 0;
+		for(copy = node; ; copy = copy->next) {
+			copies++;
+			if(elementBytes != NULL) {
+				stats->keyBytes += elementBytes(copy->elem);
+			}
+			if(infoBytes != NULL) {
+				stats->infoBytes += infoBytes(copy->info);
+			}
+			if(copy == node->end) {
+				break;
+			}
+		}
+		for(bucket = 0; bucket < TREE_STATS_BUCKETS - 1 &&
+				(copies >> (bucket + 1)) != 0; bucket++);
+		stats->chains[bucket]++;
+		stats->nodes += copies;
+		stats->keys++;
+	}
+	stats->nodeBytes = stats->nodes * sizeof(TreeNode);
+}
+
+/*
+ * Name function: dumpTreeStats
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the functions that measure a key and an info (NULL
+ * if they are not counted) and the file I write to
+ * Purpose: write the statistics of a tree, one "name value" pair per line
+ */
+void dumpTreeStats(TTree* tree, long (*elementBytes)(void*),
+		long (*infoBytes)(void*), FILE* out) {
+	TreeStats stats;
+	int i;
+
+	treeStatsSnapshot(tree, elementBytes, infoBytes, &stats);
+	fprintf(out, "compares %ld\nrotations %ld\ndoubleRotations %ld\n",
+			stats.compares, stats.rotations, stats.doubleRotations);
+	fprintf(out, "nodesAllocated %ld\nnodesFreed %ld\n",
+			stats.nodesAllocated, stats.nodesFreed);
+	fprintf(out, "height %ld\nmaxHeight %ld\nnodes %ld\nkeys %ld\n",
+			stats.height, stats.maxHeight, stats.nodes, stats.keys);
+	fprintf(out, "keyBytes %ld\ninfoBytes %ld\nnodeBytes %ld\n",
+			stats.keyBytes, stats.infoBytes, stats.nodeBytes);
+	//chains with 2^i .. 2^(i + 1) - 1 copies, from i = 0
+	fprintf(out, "chains");
+	for(i = 0; i < TREE_STATS_BUCKETS; i++) {
+		fprintf(out, " %ld", stats.chains[i]);
+	}
+	fprintf(out, "\n");
+}
+#endif
 
 #endif /* AVLTREE_H_ */
@@ -0,0 +1,893 @@
+//clock_gettime needs POSIX on top of c9x
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "Dictionary.h"
+#include "FrontCoding.h"
+#include "LSMTree.h"
+#include "DocStore.h"
+
+/*
+ * The benchmarks of the tree: a corpus with Zipfian word frequencies is made
+ * from a seed, so every run measures the same text, and every result is a
+ * JSON object on its own line. The words use the characters of the
+ * tokenizer and are separated like in text.txt.
+ *
+ * Bench [words] [vocabulary] [seed]
+ */
+#define BENCH_WORDS 100000
+#define BENCH_VOCABULARY 5000
+#define BENCH_SEED 1
+#define BENCH_MAX_LENGTH 10
+#define BENCH_ZIPF 1.0
+#define BENCH_RUNS 5
+#define BENCH_QUERIES 2000
+//the percent of updates in the write heavy and in the read heavy mix
+#define BENCH_WRITE_HEAVY 90
+#define BENCH_READ_HEAVY 10
+#define BENCH_CORPUS "bench_corpus.txt"
+//the memtable of the LSM tree is this part of the corpus
+#define BENCH_LSM_PARTS 16
+#define BENCH_STORE "bench_corpus.store"
+#define BENCH_ALPHABET "abcdefghijklmnopqrstuvwxyz-:"
+
+/*
+ * Name function: benchRandom
+ * Return: the next pseudo-random number
+ * Arguments: the state of the generator
+ * Purpose: xorshift64*, the same numbers on every machine for a seed
+ */
+unsigned long long benchRandom(unsigned long long* state) {
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+/*
+ * Name function: benchUniform
+ * Return: a number in [0, 1)
+ * Arguments: the state of the generator
+ * Purpose: uniform samples for the Zipf distribution
+ */
+double benchUniform(unsigned long long* state) {
+	return (benchRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * Name function: benchNow
+ * Return: the time of the monotonic clock in nanoseconds
+ * Arguments: none
+ * Purpose: time the benchmarks
+ */
+long benchNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/*
+ * Name function: makeVocabulary
+ * Return: the words, NULL if there is not enough memory
+ * Arguments: the state of the generator and the number of words
+ * Purpose: make random words of 1 .. BENCH_MAX_LENGTH characters of the
+ * tokenizer; the word of rank i is the i-th most frequent one
+ */
+char** makeVocabulary(unsigned long long* state, int count) {
+	char **words = (char**)malloc(sizeof(char*) * count);
+	int alphabet = strlen(BENCH_ALPHABET), i, j, length;
+	if(words == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	for(i = 0; i < count; i++) {
+		length = 1 + benchRandom(state) % BENCH_MAX_LENGTH;
+		words[i] = (char*)malloc(length + 1);
+		if(words[i] == NULL) {
+			printf("Not enough memory\n");
+			while(i > 0) {
+				free(words[--i]);
+			}
+			free(words);
+			return NULL;
+		}
+		for(j = 0; j < length; j++) {
+			words[i][j] = BENCH_ALPHABET[benchRandom(state) % alphabet];
+		}
+		words[i][length] = 0;
+	}
+	return words;
+}
+
+/*
+ * Name function: makeZipf
+ * Return: the cumulative distribution, NULL if there is not enough memory
+ * Arguments: the number of words and the exponent
+ * Purpose: the word of rank i has a frequency proportional to 1 / i^s
+ */
+double* makeZipf(int count, double s) {
+	double *cdf = (double*)malloc(sizeof(double) * count), sum = 0;
+	int i;
+	if(cdf == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	for(i = 0; i < count; i++) {
+		sum += 1.0 / pow(i + 1, s);
+		cdf[i] = sum;
+	}
+	for(i = 0; i < count; i++) {
+		cdf[i] /= sum;
+	}
+	return cdf;
+}
+
+/*
+ * Name function: sampleZipf
+ * Return: the rank of a word
+ * Arguments: the cumulative distribution, its size and the state of the
+ * generator
+ * Purpose: draw a word with a binary search in the distribution
+ */
+int sampleZipf(double* cdf, int count, unsigned long long* state) {
+	double u = benchUniform(state);
+	int low = 0, high = count - 1, middle;
+	while(low < high) {
+		middle = (low + high) / 2;
+		if(cdf[middle] < u) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+ * Name function: writeCorpus
+ * Return: the size of the file, -1 if it can't be written
+ * Arguments: the file, the words, their distribution and number, the number
+ * of words of the corpus and the state of the generator
+ * Purpose: write the corpus; the words are separated by " ", ", " or ".\n"
+ * and the last one is followed by ".\n", so the tokenizer keeps every word
+ */
+long writeCorpus(char* fileName, char** words, double* cdf, int count,
+		long n, unsigned long long* state) {
+	FILE *out = fopen(fileName, "wt");
+	long i, size;
+	int separator;
+	if(out == NULL) {
+		printf("ERROR: Can't open file %s\n", fileName);
+		return -1;
+	}
+	for(i = 0; i < n; i++) {
+		fputs(words[sampleZipf(cdf, count, state)], out);
+		separator = benchRandom(state) % 10;
+		if(i == n - 1 || separator == 0) {
+			fputs(".\n", out);
+		} else {
+			fputs(separator == 1 ? ", " : " ", out);
+		}
+	}
+	size = ftell(out);
+	fclose(out);
+	return size;
+}
+
+/*
+ * Name function: compareLatencies
+ * Return: a negative number, 0 or a positive number, like strcmp
+ * Arguments: two latencies
+ * Purpose: sort the latencies for the percentiles
+ */
+int compareLatencies(const void* a, const void* b) {
+	long x = *(const long*)a, y = *(const long*)b;
+	return (x < y) ? -1 : (x > y);
+}
+
+/*
+ * Name function: reportLatencies
+ * Return: void (it does not return a value)
+ * Arguments: the name of the benchmark, the latencies and their number
+ * Purpose: write the mean, the percentiles and the maximum of the latencies
+ */
+void reportLatencies(char* name, long* latencies, int n) {
+	long total = 0;
+	int i;
+	qsort(latencies, n, sizeof(long), compareLatencies);
+	for(i = 0; i < n; i++) {
+		total += latencies[i];
+	}
+	printf("{\"bench\": \"%s\", \"queries\": %d, \"mean_ns\": %ld, "
+			"\"p50_ns\": %ld, \"p99_ns\": %ld, \"p999_ns\": %ld, "
+			"\"max_ns\": %ld}\n", name, n, total / n, latencies[n / 2],
+			latencies[(int)(n * 0.99)], latencies[(int)(n * 0.999)],
+			latencies[n - 1]);
+}
+
+/*
+ * Name function: benchBuild
+ * Return: void (it does not return a value)
+ * Arguments: the corpus, its size and its number of words
+ * Purpose: the throughput of buildTreeFromFile, from the median of
+ * BENCH_RUNS builds
+ */
+void benchBuild(char* fileName, long size, long n) {
+	long times[BENCH_RUNS], start;
+	TTree *tree;
+	double seconds;
+	int i;
+	for(i = 0; i < BENCH_RUNS; i++) {
+		start = benchNow();
+		tree = buildTreeFromFile(fileName);
+		times[i] = benchNow() - start;
+		destroyTree(tree);
+	}
+	qsort(times, BENCH_RUNS, sizeof(long), compareLatencies);
+	seconds = times[BENCH_RUNS / 2] / 1e9;
+	printf("{\"bench\": \"build\", \"bytes\": %ld, \"words\": %ld, "
+			"\"runs\": %d, \"seconds\": %.6f, \"mb_per_s\": %.3f, "
+			"\"words_per_s\": %.0f}\n", size, n, BENCH_RUNS, seconds,
+			size / seconds / 1e6, n / seconds);
+}
+
+/*
+ * Name function: reportRate
+ * Return: void (it does not return a value)
+ * Arguments: the name of the benchmark, the number of operations and the
+ * time they took in nanoseconds
+ * Purpose: write the operations per second
+ */
+void reportRate(char* name, long n, long time) {
+	printf("{\"bench\": \"%s\", \"ops\": %ld, \"seconds\": %.6f, "
+			"\"ops_per_s\": %.0f}\n", name, n, time / 1e9, n / (time / 1e9));
+}
+
+/*
+ * Name function: benchUpdates
+ * Return: void (it does not return a value)
+ * Arguments: the words, their distribution and number, the number of
+ * operations and the state of the generator
+ * Purpose: the rates of insert, search and delete on a tree of Zipfian keys;
+ * every key is deleted once for every time it was inserted
+ */
+void benchUpdates(char** words, double* cdf, int count, long n,
+		unsigned long long* state) {
+	TTree *tree = createTree(createStrElement, destroyStrElement,
+			createIndexInfo, destroyIndexInfo, compareStrElem);
+	char **keys = (char**)malloc(sizeof(char*) * n);
+	Posting posting = {0, 0, 0};
+	long i, start, found = 0;
+
+	if(tree == NULL || keys == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		free(keys);
+		return;
+	}
+	for(i = 0; i < n; i++) {
+		keys[i] = words[sampleZipf(cdf, count, state)];
+	}
+	start = benchNow();
+	for(i = 0; i < n; i++) {
+		posting.offset = i;
+		posting.position = i;
+		insert(tree, keys[i], &posting);
+	}
+	reportRate("insert", n, benchNow() - start);
+
+	//the keys are the first characters of the words, like in the tree
+	for(i = 0; i < n; i++) {
+		keys[i] = createStrElement(keys[i]);
+	}
+	start = benchNow();
+	for(i = 0; i < n; i++) {
+		found += search(tree, tree->root, keys[i]) != NULL;
+	}
+	reportRate("search", n, benchNow() - start);
+
+	start = benchNow();
+	for(i = 0; i < n; i++) {
+		delete(tree, keys[i]);
+	}
+	reportRate("delete", n, benchNow() - start);
+	if(found != n || tree->root != NULL) {
+		printf("ERROR: the tree lost keys\n");
+	}
+	for(i = 0; i < n; i++) {
+		destroyStrElement(keys[i]);
+	}
+	free(keys);
+	destroyTree(tree);
+}
+
+/*
+ * Name function: queryPrefix
+ * Return: void (it does not return a value)
+ * Arguments: a word, the state of the generator and the address where the
+ * prefix is saved
+ * Purpose: take the first 1 .. ELEMENT_TREE_LENGTH characters of a word
+ */
+void queryPrefix(char* word, unsigned long long* state, char* prefix) {
+	int length = 1 + benchRandom(state) % ELEMENT_TREE_LENGTH;
+	strncpy(prefix, word, length);
+	prefix[length] = 0;
+}
+
+/*
+ * Name function: benchQueries
+ * Return: void (it does not return a value)
+ * Arguments: the corpus, the words, their distribution and number and the
+ * state of the generator
+ * Purpose: the latencies of prefix and interval queries on the tree of the
+ * corpus, for prefixes of Zipfian words
+ */
+void benchQueries(char* fileName, char** words, double* cdf, int count,
+		unsigned long long* state) {
+	TTree *tree = buildTreeFromFile(fileName);
+	long *latencies = (long*)malloc(sizeof(long) * BENCH_QUERIES), start;
+	char q[ELEMENT_TREE_LENGTH + 1], p[ELEMENT_TREE_LENGTH + 1];
+	char swap[ELEMENT_TREE_LENGTH + 1];
+	Range *range;
+	int i;
+
+	if(tree == NULL || latencies == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		free(latencies);
+		return;
+	}
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		queryPrefix(words[sampleZipf(cdf, count, state)], state, q);
+		start = benchNow();
+		range = singleKeyRangeQuery(tree, q);
+		latencies[i] = benchNow() - start;
+		destroyRange(range);
+	}
+	reportLatencies("prefix", latencies, BENCH_QUERIES);
+
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		queryPrefix(words[sampleZipf(cdf, count, state)], state, q);
+		queryPrefix(words[sampleZipf(cdf, count, state)], state, p);
+		if(strcmp(q, p) > 0) {
+			strcpy(swap, q);
+			strcpy(q, p);
+			strcpy(p, swap);
+		}
+		start = benchNow();
+		range = multiKeyRangeQuery(tree, q, p);
+		latencies[i] = benchNow() - start;
+		destroyRange(range);
+	}
+	reportLatencies("interval", latencies, BENCH_QUERIES);
+	free(latencies);
+	destroyTree(tree);
+}
+
+/*
+ * Name function: scanTree
+ * Return: the time of the walk in nanoseconds
+ * Arguments: the tree and the address where the sum of the offsets is saved
+ * Purpose: walk every node of the list once, touching its key and its info
+ */
+long scanTree(TTree* tree, long* sum) {
+	long start = benchNow();
+	TreeNode *node;
+	for(node = minimum(tree, tree->root); node != NULL; node = node->next) {
+		*sum += ((Posting*)node->info)->offset + *(char*)node->elem;
+	}
+	return benchNow() - start;
+}
+
+/*
+ * Name function: reportScan
+ * Return: void (it does not return a value)
+ * Arguments: the name of the benchmark, the tree and its number of nodes
+ * Purpose: the nodes per second of a full walk, from the median of
+ * BENCH_RUNS walks
+ */
+void reportScan(char* name, TTree* tree, long n) {
+	long times[BENCH_RUNS], sum = 0;
+	int i;
+	for(i = 0; i < BENCH_RUNS; i++) {
+		times[i] = scanTree(tree, &sum);
+	}
+	qsort(times, BENCH_RUNS, sizeof(long), compareLatencies);
+	printf("{\"bench\": \"%s\", \"nodes\": %ld, \"runs\": %d, "
+			"\"seconds\": %.6f, \"nodes_per_s\": %.0f, \"checksum\": %ld}\n",
+			name, n, BENCH_RUNS, times[BENCH_RUNS / 2] / 1e9,
+			n / (times[BENCH_RUNS / 2] / 1e9), sum);
+}
+
+/*
+ * Name function: benchScan
+ * Return: void (it does not return a value)
+ * Arguments: the corpus and the state of the generator
+ * Purpose: the speed of a walk over the tree of the corpus after its words
+ * were deleted and inserted again in a random order, which scatters the
+ * nodes, and then after compact
+ */
+void benchScan(char* fileName, unsigned long long* state) {
+	TTree *tree = buildTreeFromFile(fileName);
+	char (*keys)[ELEMENT_TREE_LENGTH + 1] = NULL;
+	Posting *postings = NULL, swapPosting;
+	char swapKey[ELEMENT_TREE_LENGTH + 1];
+	TreeNode *node;
+	long n = 0, i, j, start;
+
+	if(tree != NULL) {
+		keys = malloc(sizeof(*keys) * tree->size);
+		postings = (Posting*)malloc(sizeof(Posting) * tree->size);
+	}
+	if(keys == NULL || postings == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		free(keys);
+		free(postings);
+		return;
+	}
+	for(node = minimum(tree, tree->root); node != NULL; node = node->next) {
+		strcpy(keys[n], (char*)node->elem);
+		postings[n++] = *(Posting*)node->info;
+	}
+	for(i = n - 1; i > 0; i--) {
+		j = benchRandom(state) % (i + 1);
+		strcpy(swapKey, keys[i]);
+		strcpy(keys[i], keys[j]);
+		strcpy(keys[j], swapKey);
+		swapPosting = postings[i];
+		postings[i] = postings[j];
+		postings[j] = swapPosting;
+	}
+	for(i = 0; i < n; i++) {
+		delete(tree, keys[i]);
+		insert(tree, keys[i], &postings[i]);
+	}
+	reportScan("scan_scattered", tree, n);
+	start = benchNow();
+	compact(tree);
+	reportRate("compact", n, benchNow() - start);
+	reportScan("scan_compacted", tree, n);
+	free(keys);
+	free(postings);
+	destroyTree(tree);
+}
+
+/*
+ * Name function: benchMix
+ * Return: the time of the operations in nanoseconds
+ * Arguments: the balancing policy, the keys, their number and the kinds of
+ * the operations (0 for a search)
+ * Purpose: run a mix of updates and searches; the first half of the keys is
+ * inserted before, then an update inserts its key or deletes the oldest key
+ * that is left (one after the other), so the tree keeps its size
+ */
+long benchMix(int policy, char** keys, long n, char* kinds) {
+	TTree *tree = createTree(createStrElement, destroyStrElement,
+			createIndexInfo, destroyIndexInfo, compareStrElem);
+	Posting posting = {0, 0, 0};
+	long i, oldest = 0, start;
+	int update = 0;
+
+	if(tree == NULL) {
+		return 0;
+	}
+	setTreePolicy(tree, policy);
+	for(i = 0; i < n / 2; i++) {
+		insert(tree, keys[i], &posting);
+	}
+	start = benchNow();
+	for(i = n / 2; i < n; i++) {
+		if(kinds[i] == 0) {
+			search(tree, tree->root, keys[i]);
+		} else {
+			if(update++ % 2 == 0) {
+				insert(tree, keys[i], &posting);
+			} else {
+				delete(tree, keys[oldest++]);
+			}
+		}
+	}
+	start = benchNow() - start;
+	destroyTree(tree);
+	return start;
+}
+
+/*
+ * Name function: benchPolicies
+ * Return: void (it does not return a value)
+ * Arguments: the words, their number, the number of operations and the
+ * state of the generator
+ * Purpose: the write heavy and the read heavy mixes of uniform words, with
+ * the same operations for the AVL and the WAVL policy; the policies take
+ * turns, so that neither always runs on the heap the other one left, and
+ * the median of BENCH_RUNS runs is reported
+ */
+void benchPolicies(char** words, int count, long n,
+		unsigned long long* state) {
+	char **keys = (char**)malloc(sizeof(char*) * n);
+	char *kinds = (char*)malloc(n);
+	char *names[2] = {"mix_write", "mix_read"}, *policies[2] = {"avl", "wavl"};
+	int writes[2] = {BENCH_WRITE_HEAVY, BENCH_READ_HEAVY}, mix, policy, first, i;
+	long times[2][BENCH_RUNS], j, ops = n - n / 2;
+	double seconds;
+
+	if(keys == NULL || kinds == NULL) {
+		printf("Not enough memory\n");
+		free(keys);
+		free(kinds);
+		return;
+	}
+	//the keys are the first characters of the words, like in the tree
+	for(j = 0; j < n; j++) {
+		keys[j] = createStrElement(words[benchRandom(state) % count]);
+	}
+	for(mix = 0; mix < 2; mix++) {
+		for(j = 0; j < n; j++) {
+			kinds[j] = benchRandom(state) % 100 < (unsigned)writes[mix];
+		}
+		for(i = 0; i < BENCH_RUNS; i++) {
+			first = (i % 2) ? TREE_WAVL : TREE_AVL;
+			times[first][i] = benchMix(first, keys, n, kinds);
+			times[1 - first][i] = benchMix(1 - first, keys, n, kinds);
+		}
+		for(policy = TREE_AVL; policy <= TREE_WAVL; policy++) {
+			qsort(times[policy], BENCH_RUNS, sizeof(long), compareLatencies);
+			seconds = times[policy][BENCH_RUNS / 2] / 1e9;
+			printf("{\"bench\": \"%s\", \"policy\": \"%s\", "
+					"\"writes_pct\": %d, \"ops\": %ld, \"runs\": %d, "
+					"\"seconds\": %.6f, \"ops_per_s\": %.0f}\n", names[mix],
+					policies[policy], writes[mix], ops, BENCH_RUNS, seconds,
+					ops / seconds);
+		}
+	}
+	for(j = 0; j < n; j++) {
+		destroyStrElement(keys[j]);
+	}
+	free(keys);
+	free(kinds);
+}
+
+/*
+ * Name function: benchDeleteKeys
+ * Return: void (it does not return a value)
+ * Arguments: the tree, its keys in the order they are deleted, their number,
+ * whether the deletions are lazy and the name of the benchmark
+ * Purpose: the latencies of erasing every copy of the keys, one key at a
+ * time: delete is called until the key is gone, lazyDeleteKey once
+ */
+void benchDeleteKeys(TTree* tree, char** keys, long n, int lazy, char* name) {
+	long *latencies = (long*)malloc(sizeof(long) * n), i, start;
+
+	if(latencies == NULL) {
+		printf("Not enough memory\n");
+		return;
+	}
+	for(i = 0; i < n; i++) {
+		start = benchNow();
+		if(lazy) {
+			lazyDeleteKey(tree, keys[i]);
+		} else {
+			while(search(tree, tree->root, keys[i]) != NULL) {
+				delete(tree, keys[i]);
+			}
+		}
+		latencies[i] = benchNow() - start;
+	}
+	reportLatencies(name, latencies, n);
+	free(latencies);
+}
+
+/*
+ * Name function: benchDeletes
+ * Return: void (it does not return a value)
+ * Arguments: the corpus and the state of the generator
+ * Purpose: a burst that erases every key of the tree of the corpus in a
+ * random order, with delete and with lazyDeleteKey; the purge that is left
+ * after the lazy burst is timed apart
+ */
+void benchDeletes(char* fileName, unsigned long long* state) {
+	TTree *tree = buildTreeFromFile(fileName), *lazy = buildTreeFromFile(fileName);
+	TreeNode *node;
+	char **keys, *key;
+	long n = 0, i, j, start;
+
+	keys = (tree != NULL) ? (char**)malloc(sizeof(char*) * tree->size) : NULL;
+	if(tree == NULL || lazy == NULL || keys == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		destroyTree(lazy);
+		free(keys);
+		return;
+	}
+	for(node = minimum(tree, tree->root); node != NULL; node = node->end->next) {
+		keys[n++] = createStrElement(node->elem);
+	}
+	//Fisher-Yates
+	for(i = n - 1; i > 0; i--) {
+		j = benchRandom(state) % (i + 1);
+		key = keys[i];
+		keys[i] = keys[j];
+		keys[j] = key;
+	}
+	benchDeleteKeys(tree, keys, n, 0, "delete_key");
+	benchDeleteKeys(lazy, keys, n, 1, "lazy_delete_key");
+	start = benchNow();
+	purgeTombstones(lazy);
+	reportRate("purge", n, benchNow() - start);
+	if(tree->root != NULL || lazy->root != NULL) {
+		printf("ERROR: the tree kept keys\n");
+	}
+	for(i = 0; i < n; i++) {
+		destroyStrElement(keys[i]);
+	}
+	free(keys);
+	destroyTree(tree);
+	destroyTree(lazy);
+}
+
+/*
+ * Name function: createWordElement
+ * Return: the memory address of the key
+ * Arguments: a word
+ * Purpose: keep the whole word as the key, not only its first characters
+ */
+void* createWordElement(void* str) {
+	char *word = (char*)malloc(strlen((char*)str) + 1);
+	if(word != NULL) {
+		strcpy(word, (char*)str);
+	}
+	return word;
+}
+
+/*
+ * Name function: benchFrontCoding
+ * Return: void (it does not return a value)
+ * Arguments: the words, their distribution and number and the state of the
+ * generator
+ * Purpose: the memory of the whole words of the vocabulary in a tree and
+ * front coded, and the latencies of prefix queries on both
+ */
+void benchFrontCoding(char** words, double* cdf, int count,
+		unsigned long long* state) {
+	TTree *tree = createTree(createWordElement, destroyStrElement,
+			createIndexInfo, destroyIndexInfo, compareStrElem);
+	long *latencies = (long*)malloc(sizeof(long) * BENCH_QUERIES * 2);
+	long keyBytes = 0, keys = 0, start;
+	char q[BENCH_MAX_LENGTH + 1], *word;
+	Posting posting = {0, 0, 0};
+	Range *range, *front;
+	FrontDict *dict;
+	TreeNode *node;
+	int i, length, wrong = 0;
+
+	if(tree == NULL || latencies == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		free(latencies);
+		return;
+	}
+	for(i = 0; i < count; i++) {
+		posting.offset = i;
+		insert(tree, words[i], &posting);
+	}
+	//the bytes that the tree asks malloc for its keys
+	for(node = minimum(tree, tree->root); node != NULL; node = node->end->next) {
+		keyBytes += strlen(node->elem) + 1;
+		keys++;
+	}
+	dict = buildFrontDict(tree);
+	if(dict == NULL) {
+		destroyTree(tree);
+		free(latencies);
+		return;
+	}
+	printf("{\"bench\": \"front_coding\", \"keys\": %ld, \"key_bytes\": %ld, "
+			"\"front_bytes\": %ld, \"ratio\": %.2f}\n", keys, keyBytes,
+			frontDictBytes(dict), (double)keyBytes / frontDictBytes(dict));
+
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		word = words[sampleZipf(cdf, count, state)];
+		length = 1 + benchRandom(state) % strlen(word);
+		memcpy(q, word, length);
+		q[length] = 0;
+		start = benchNow();
+		range = singleKeyRangeQuery(tree, q);
+		latencies[i] = benchNow() - start;
+		start = benchNow();
+		front = frontPrefixQuery(dict, q);
+		latencies[BENCH_QUERIES + i] = benchNow() - start;
+		wrong += range->size != front->size;
+		destroyRange(range);
+		destroyRange(front);
+	}
+	reportLatencies("word_prefix", latencies, BENCH_QUERIES);
+	reportLatencies("front_prefix", latencies + BENCH_QUERIES, BENCH_QUERIES);
+	if(wrong != 0) {
+		printf("ERROR: the front coded words are not the words of the tree\n");
+	}
+	destroyFrontDict(dict);
+	destroyTree(tree);
+	free(latencies);
+}
+
+/*
+ * Name function: benchLSM
+ * Return: void (it does not return a value)
+ * Arguments: the corpus, its number of words, the words, their distribution
+ * and number and the state of the generator
+ * Purpose: the rate of inserting the corpus in an LSM tree whose memtable
+ * holds 1 / BENCH_LSM_PARTS of it, and the latencies of lookups and prefix
+ * queries that merge its runs
+ */
+void benchLSM(char* fileName, long n, char** words, double* cdf, int count,
+		unsigned long long* state) {
+	TTree *tree = buildTreeFromFile(fileName);
+	LSMTree *lsm = createLSMTree(".", n / BENCH_LSM_PARTS + 1, 1);
+	long *latencies = (long*)malloc(sizeof(long) * BENCH_QUERIES), start;
+	char q[ELEMENT_TREE_LENGTH + 1];
+	Range *range, *merged;
+	int i, wrong = 0;
+
+	if(tree == NULL || lsm == NULL || latencies == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		destroyLSMTree(lsm);
+		free(latencies);
+		return;
+	}
+	start = benchNow();
+	lsmAddFile(lsm, fileName, 0);
+	reportRate("lsm_insert", tree->size, benchNow() - start);
+
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		queryPrefix(words[sampleZipf(cdf, count, state)], state, q);
+		start = benchNow();
+		merged = lsmLookup(lsm, q);
+		latencies[i] = benchNow() - start;
+		destroyRange(merged);
+	}
+	reportLatencies("lsm_lookup", latencies, BENCH_QUERIES);
+	printf("{\"bench\": \"lsm_bloom\", \"probes\": %ld, \"skips\": %ld}\n",
+			lsm->probes, lsm->skips);
+
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		queryPrefix(words[sampleZipf(cdf, count, state)], state, q);
+		start = benchNow();
+		merged = lsmPrefixQuery(lsm, q);
+		latencies[i] = benchNow() - start;
+		range = singleKeyRangeQuery(tree, q);
+		wrong += range->size != merged->size;
+		destroyRange(range);
+		destroyRange(merged);
+	}
+	reportLatencies("lsm_prefix", latencies, BENCH_QUERIES);
+	if(wrong != 0) {
+		printf("ERROR: the LSM tree has other words than the tree\n");
+	}
+	destroyLSMTree(lsm);
+	destroyTree(tree);
+	free(latencies);
+}
+
+/*
+ * Name function: benchDocStore
+ * Return: void (it does not return a value)
+ * Arguments: the corpus, its size, the words, their distribution and number
+ * and the state of the generator
+ * Purpose: the size of the compressed corpus and the latencies of reading the
+ * lines of the hits of prefix queries from it and from the text
+ */
+void benchDocStore(char* fileName, long size, char** words, double* cdf,
+		int count, unsigned long long* state) {
+	TTree *tree = buildTreeFromFile(fileName);
+	long *latencies = (long*)malloc(sizeof(long) * BENCH_QUERIES * 2), start;
+	long stored = 0;
+	char q[ELEMENT_TREE_LENGTH + 1], line[BUFLEN + 1];
+	FILE *text = fopen(fileName, "r"), *file;
+	DocStore *store = NULL;
+	Range *range;
+	int i, j;
+
+	start = benchNow();
+	if(buildDocStore(fileName, BENCH_STORE)) {
+		start = benchNow() - start;
+		store = openDocStore(BENCH_STORE);
+	}
+	if(tree == NULL || latencies == NULL || text == NULL || store == NULL) {
+		printf("Not enough memory\n");
+		destroyTree(tree);
+		free(latencies);
+		if(text != NULL) {
+			fclose(text);
+		}
+		closeDocStore(store);
+		remove(BENCH_STORE);
+		return;
+	}
+	file = fopen(BENCH_STORE, "rb");
+	if(file != NULL) {
+		fseek(file, 0, SEEK_END);
+		stored = ftell(file);
+		fclose(file);
+	}
+	printf("{\"bench\": \"doc_store\", \"bytes\": %ld, \"stored_bytes\": %ld, "
+			"\"ratio\": %.2f, \"mb_per_s\": %.3f}\n", size, stored,
+			(double)size / stored, size / (start / 1e9) / 1e6);
+
+	for(i = 0; i < BENCH_QUERIES; i++) {
+		queryPrefix(words[sampleZipf(cdf, count, state)], state, q);
+		range = singleKeyRangeQuery(tree, q);
+		start = benchNow();
+		for(j = 0; j < range->size; j++) {
+			fseek(text, range->index[j], SEEK_SET);
+			if(fgets(line, BUFLEN, text) != NULL) {
+				strtok(line, " .,\n");
+			}
+		}
+		latencies[i] = benchNow() - start;
+		start = benchNow();
+		destroyDocWords(docStoreWords(store, range));
+		latencies[BENCH_QUERIES + i] = benchNow() - start;
+		destroyRange(range);
+	}
+	reportLatencies("file_hits", latencies, BENCH_QUERIES);
+	reportLatencies("store_hits", latencies + BENCH_QUERIES, BENCH_QUERIES);
+	printf("{\"bench\": \"doc_cache\", \"hits\": %ld, \"misses\": %ld}\n",
+			store->hits, store->misses);
+	fclose(text);
+	closeDocStore(store);
+	remove(BENCH_STORE);
+	destroyTree(tree);
+	free(latencies);
+}
+
+int main(int argc, char* argv[]) {
+	long n = (argc > 1) ? atol(argv[1]) : BENCH_WORDS, size;
+	int count = (argc > 2) ? atoi(argv[2]) : BENCH_VOCABULARY;
+	unsigned long long seed = (argc > 3) ? strtoull(argv[3], NULL, 10) :
+			BENCH_SEED, state;
+	char **words;
+	double *cdf;
+	int i;
+
+	if(n <= 0 || count <= 0) {
+		printf("Usage: Bench [words] [vocabulary] [seed]\n");
+		return 1;
+	}
+	//xorshift can't start from 0
+	state = seed ? seed : BENCH_SEED;
+	words = makeVocabulary(&state, count);
+	cdf = makeZipf(count, BENCH_ZIPF);
+	if(words == NULL || cdf == NULL) {
+		free(cdf);
+		return 1;
+	}
+	size = writeCorpus(BENCH_CORPUS, words, cdf, count, n, &state);
+	if(size >= 0) {
+		printf("{\"bench\": \"config\", \"words\": %ld, \"vocabulary\": %d, "
+				"\"seed\": %llu, \"zipf\": %.2f, \"bytes\": %ld}\n", n, count,
+				seed, BENCH_ZIPF, size);
+		benchBuild(BENCH_CORPUS, size, n);
+		benchUpdates(words, cdf, count, n, &state);
+		benchQueries(BENCH_CORPUS, words, cdf, count, &state);
+		benchScan(BENCH_CORPUS, &state);
+		benchPolicies(words, count, n, &state);
+		benchDeletes(BENCH_CORPUS, &state);
+		benchFrontCoding(words, cdf, count, &state);
+		benchLSM(BENCH_CORPUS, n, words, cdf, count, &state);
+		benchDocStore(BENCH_CORPUS, size, words, cdf, count, &state);
+		remove(BENCH_CORPUS);
+	}
+	for(i = 0; i < count; i++) {
+		free(words[i]);
+	}
+	free(words);
+	free(cdf);
+	return size >= 0 ? 0 : 1;
+}
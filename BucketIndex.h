@@ -0,0 +1,320 @@
+#ifndef BUCKETINDEX_H_
+#define BUCKETINDEX_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dictionary.h"
+
+/*
+ * The keys are at most ELEMENT_TREE_LENGTH characters from '-', ':', 'a'-'z'.
+ * Giving the end of a key the digit 0 and the characters the digits 1..28 in
+ * ASCII order, every key is a number in base 29 and the numbers are ordered
+ * like the keys. So every possible key has its own slot in a dense array and
+ * a prefix or an interval is a contiguous run of slots.
+ */
+#define BUCKET_RADIX 29
+
+typedef struct BucketIndex{
+	long slots;
+	//the postings of slot i are postings[start[i]] .. postings[start[i + 1] - 1]
+	long *start;
+	Posting *postings;
+}BucketIndex;
+
+typedef struct BucketBuilder{
+	long *slot;
+	Posting *postings;
+	long size;
+	long capacity;
+}BucketBuilder;
+
+/*
+ * Name function: bucketDigit
+ * Return: the digit of a character, -1 if it can't be part of a key
+ * Arguments: a character
+ * Purpose: map the characters of the keys to 1..28 in ASCII order
+ */
+int bucketDigit(char c) {
+	if(c == '-') {
+		return 1;
+	}
+	if(c == ':') {
+		return 2;
+	}
+	if(c >= 'a' && c <= 'z') {
+		return c - 'a' + 3;
+	}
+	return -1;
+}
+
+/*
+ * Name function: nextBucketDigit
+ * Return: the digit of the smallest key character greater than c, -1 if
+ * there is none
+ * Arguments: a character that can't be part of a key
+ * Purpose: place a character that is not in the alphabet between the others
+ */
+int nextBucketDigit(char c) {
+	if(c < '-') {
+		return 1;
+	}
+	if(c < ':') {
+		return 2;
+	}
+	if(c < 'a') {
+		return 3;
+	}
+	return -1;
+}
+
+/*
+ * Name function: bucketPower
+ * Return: BUCKET_RADIX to the power n
+ * Arguments: n
+ * Purpose: get the number of slots of n digits
+ */
+long bucketPower(int n) {
+	long power = 1;
+	while(n-- > 0) {
+		power *= BUCKET_RADIX;
+	}
+	return power;
+}
+
+/*
+ * Name function: bucketBound
+ * Return: the first slot of a key that is not before s
+ * Arguments: a string and whether the keys that start with s are before it
+ * Purpose: with prefix 0, the first slot of a key >= s; with prefix 1, the
+ * first slot of a key whose first strlen(s) characters are > s
+ */
+long bucketBound(char* s, int prefix) {
+	long code = 0;
+	int i, digit;
+	for(i = 0; i < ELEMENT_TREE_LENGTH; i++) {
+		if(s[i] == 0) {
+			//the keys that start with s come right after it
+			return (code + prefix) * bucketPower(ELEMENT_TREE_LENGTH - i);
+		}
+		digit = bucketDigit(s[i]);
+		if(digit < 0) {
+			digit = nextBucketDigit(s[i]);
+			if(digit < 0) {
+				return (code + 1) * bucketPower(ELEMENT_TREE_LENGTH - i);
+			}
+			return (code * BUCKET_RADIX + digit) *
+				bucketPower(ELEMENT_TREE_LENGTH - i - 1);
+		}
+		code = code * BUCKET_RADIX + digit;
+	}
+	//the key made of the first characters of s is smaller than a longer s
+	return (s[i] == 0 && prefix == 0) ? code : code + 1;
+}
+
+/*
+ * Name function: bucketSlot
+ * Return: the slot of a key, -1 if it is not a possible key
+ * Arguments: a key
+ * Purpose: turn a key into its number in base BUCKET_RADIX
+ */
+long bucketSlot(char* key) {
+	long code = 0;
+	int i, digit;
+	for(i = 0; i < ELEMENT_TREE_LENGTH && key[i] != 0; i++) {
+		digit = bucketDigit(key[i]);
+		if(digit < 0) {
+			return -1;
+		}
+		code = code * BUCKET_RADIX + digit;
+	}
+	if(key[i] != 0) {
+		return -1;
+	}
+	return code * bucketPower(ELEMENT_TREE_LENGTH - i);
+}
+
+/*
+ * Name function: addToBuilder
+ * Return: void (it does not return a value)
+ * Arguments: the builder (as the context of a tokenizer), the word and its
+ * posting
+ * Purpose: save a word found by a tokenizer together with its slot
+ */
+void addToBuilder(void* context, char* word, Posting* posting) {
+	BucketBuilder *builder = (BucketBuilder*)context;
+	if(builder->size == builder->capacity) {
+		long capacity = builder->capacity ? builder->capacity * 2 : BUFLEN;
+		long *slot = (long*)realloc(builder->slot, sizeof(long) * capacity);
+		Posting *postings = (Posting*)realloc(builder->postings,
+				sizeof(Posting) * capacity);
+		if(slot != NULL) {
+			builder->slot = slot;
+		}
+		if(postings != NULL) {
+			builder->postings = postings;
+		}
+		if(slot == NULL || postings == NULL) {
+			printf("Not enough memory\n");
+			return;
+		}
+		builder->capacity = capacity;
+	}
+	builder->slot[builder->size] = bucketSlot(word);
+	builder->postings[builder->size] = *posting;
+	builder->size++;
+}
+
+/*
+ * Name function: buildBucketIndexFromCorpus
+ * Return: the memory address of the index
+ * Arguments: the files that I read from and their number
+ * Purpose: index the words of every file in a dense array of slots; the
+ * postings are placed with a counting sort, so every slot keeps them in the
+ * order of the files, like the lists of duplicates of the tree
+ */
+BucketIndex* buildBucketIndexFromCorpus(char** fileNames, int count) {
+	BucketBuilder builder = {NULL, NULL, 0, 0};
+	Tokenizer tokenizer;
+	BucketIndex *index;
+	char *buffer;
+	long size, i;
+
+	for(int doc = 0; doc < count; doc++) {
+		buffer = readFile(fileNames[doc], &size);
+		if(buffer == NULL) {
+			printf("\n");
+			continue;
+		}
+		initTokenizer(&tokenizer, doc, addToBuilder, &builder);
+		tokenize(&tokenizer, buffer, size, 0);
+		finishTokenizer(&tokenizer);
+		free(buffer);
+	}
+
+	index = (BucketIndex*)malloc(sizeof(BucketIndex));
+	if(index == NULL) {
+		printf("Not enough memory\n");
+		free(builder.slot);
+		free(builder.postings);
+		return NULL;
+	}
+	index->slots = bucketPower(ELEMENT_TREE_LENGTH);
+	index->start = (long*)calloc(index->slots + 1, sizeof(long));
+	index->postings = (Posting*)malloc(sizeof(Posting) * (builder.size + 1));
+	if(index->start == NULL || index->postings == NULL) {
+		printf("Not enough memory\n");
+		free(index->start);
+		free(index->postings);
+		free(index);
+		free(builder.slot);
+		free(builder.postings);
+		return NULL;
+	}
+	for(i = 0; i < builder.size; i++) {
+		index->start[builder.slot[i] + 1]++;
+	}
+	for(i = 0; i < index->slots; i++) {
+		index->start[i + 1] += index->start[i];
+	}
+	//start[slot] moves to the end of the slot while it is filled
+	for(i = 0; i < builder.size; i++) {
+		index->postings[index->start[builder.slot[i]]++] = builder.postings[i];
+	}
+	for(i = index->slots; i > 0; i--) {
+		index->start[i] = index->start[i - 1];
+	}
+	index->start[0] = 0;
+	free(builder.slot);
+	free(builder.postings);
+	return index;
+}
+
+/*
+ * Name function: buildBucketIndexFromFile
+ * Return: the memory address of the index
+ * Arguments: the file that I read from
+ * Purpose: index the words of a file in a dense array of slots
+ */
+BucketIndex* buildBucketIndexFromFile(char* fileName) {
+	return buildBucketIndexFromCorpus(&fileName, 1);
+}
+
+/*
+ * Name function: destroyBucketIndex
+ * Return: void (it does not return a value)
+ * Arguments: the index
+ * Purpose: free the memory of an index
+ */
+void destroyBucketIndex(BucketIndex* index) {
+	if(index == NULL) {
+		return;
+	}
+	free(index->start);
+	free(index->postings);
+	free(index);
+}
+
+/*
+ * Name function: bucketSlice
+ * Return: the memory address of the words
+ * Arguments: the index and the slots [first, last)
+ * Purpose: copy the postings of a run of slots into a range
+ */
+Range* bucketSlice(BucketIndex* index, long first, long last) {
+	Range *words = createRange();
+	long i;
+	if(words == NULL || index == NULL) {
+		return words;
+	}
+	if(first < 0) {
+		first = 0;
+	}
+	if(last > index->slots) {
+		last = index->slots;
+	}
+	for(i = (first < last) ? index->start[first] : 0;
+			first < last && i < index->start[last]; i++) {
+		addToRange(words, &index->postings[i]);
+	}
+	return words;
+}
+
+/*
+ * Name function: bucketLookup
+ * Return: the memory address of the words
+ * Arguments: the index and a word
+ * Purpose: find the words with the same key as a word in O(1)
+ */
+Range* bucketLookup(BucketIndex* index, char* word) {
+	char *key = createStrElement(word);
+	long slot = bucketSlot(key);
+	destroyStrElement(key);
+	if(slot < 0) {
+		return createRange();
+	}
+	return bucketSlice(index, slot, slot + 1);
+}
+
+/*
+ * Name function: bucketPrefixQuery
+ * Return: the memory address of the words
+ * Arguments: the index and the given string
+ * Purpose: the same words as singleKeyRangeQuery, without any comparison
+ */
+Range* bucketPrefixQuery(BucketIndex* index, char* q) {
+	return bucketSlice(index, bucketBound(q, 0), bucketBound(q, 1));
+}
+
+/*
+ * Name function: bucketIntervalQuery
+ * Return: the memory address of the words
+ * Arguments: the index and the two strings q, p
+ * Purpose: the same words as multiKeyRangeQuery, without any comparison
+ */
+Range* bucketIntervalQuery(BucketIndex* index, char* q, char* p) {
+	return bucketSlice(index, bucketBound(q, 0), bucketBound(p, 1));
+}
+
+#endif /* BUCKETINDEX_H_ */
@@ -0,0 +1,796 @@
+#ifndef DICTIONARY_H_
+#define DICTIONARY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define BUFLEN 1024
+#define ELEMENT_TREE_LENGTH 3
+
+#include "AVLTree.h"
+#include "Trace.h"
+
+/*
+ * The info of every node is a posting: where a word was found. The offset is
+ * kept first so that code reading the info as a long still gets the offset;
+ * position is the number of words before it in the same document.
+ */
+typedef struct Posting{
+	long offset;
+	int doc;
+	long position;
+}Posting;
+
+typedef struct Range{
+	int *index;
+	int *doc;
+	int size;
+	int capacity;
+}Range;
+
+void printFile(char* fileName){
+	if(fileName == NULL) return;
+	FILE * file = fopen(fileName,"r");
+	if (file == NULL) return;
+	char *buf = (char*) malloc(BUFLEN+1);
+	while(fgets(buf,BUFLEN,file) != NULL){
+		printf("%s",buf);
+	}
+	printf("\n");
+	free(buf);
+	fclose(file);
+}
+
+void printWordsInRangeFromFile(Range* range, char* fileName){
+	TRACE_BEGIN(span);
+	if(fileName == NULL || range == NULL) return;
+	FILE * file = fopen(fileName,"r");
+	if (file == NULL) return;
+	char *buf = (char*) malloc(BUFLEN+1);
+	for(int i = 0; i < range->size;i++){
+		fseek(file,range->index[i],SEEK_SET);
+		if(fgets(buf,BUFLEN,file) != NULL){
+			char* token = strtok(buf," .,\n");
+			printf("%d. %s:%d\n",i+1, token, range->index[i]);
+		}
+	}
+	printf("\n");
+	free(buf);
+	fclose(file);
+	TRACE_PHASE(TRACE_PRINT, TRACE_IO, span);
+	TRACE_END(TRACE_PRINT, span);
+}
+
+void printTreeInOrderHelper(TTree* tree, TreeNode* node){
+	if(node != NULL){
+		printTreeInOrderHelper(tree, node->lt);
+		TreeNode* begin = node;
+		//a key deleted by lazyDelete has nothing to print
+		TreeNode* end = TOMBSTONE(node) ? node : node->end->next;
+		while(begin != end){
+			printf("%ld:%s  ",((Posting*)begin->info)->offset,((char*)begin->elem));
+			begin = begin->next;
+		}
+		printTreeInOrderHelper(tree, node->rt);
+	}
+}
+
+void printTreeInOrder(TTree* tree){
+	if(tree == NULL) return;
+	printTreeInOrderHelper(tree, tree->root);
+}
+
+
+void* createStrElement(void* str){
+	char *c = malloc((ELEMENT_TREE_LENGTH + 1) * sizeof(char));
+	strncpy(c, (char*) (str), ELEMENT_TREE_LENGTH);
+	c[ELEMENT_TREE_LENGTH] = 0;
+	return c;
+}
+
+void destroyStrElement(void* elem){
+	free((char*)elem);
+}
+
+
+void* createIndexInfo(void* index){
+	Posting *i = malloc(sizeof(Posting));
+	*i = *((Posting*)index);
+	return i; 
+}
+
+void destroyIndexInfo(void* index){
+	free((Posting*)index);
+}
+
+#ifdef TREE_STATS
+//the memory of a key and of an info, for treeStatsSnapshot
+long strElementBytes(void* elem){
+	return (ELEMENT_TREE_LENGTH + 1) * sizeof(char);
+}
+
+long indexInfoBytes(void* index){
+	return sizeof(Posting);
+}
+#endif
+
+int compareStrElem(void* str1, void* str2){
+	if(strcmp((char*)str1, (char*)str2) < 0) {
+		return -1;
+	}
+	if(strcmp((char*)str1, (char*)str2) > 0) {
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Name function: hashStrElement
+ * Return: the hash of a key
+ * Arguments: the key
+ * Purpose: FNV-1a hash of a string, for the hash index of the tree
+ */
+unsigned long hashStrElement(void* str){
+	unsigned long hash = 14695981039346656037ul;
+	for(unsigned char *c = (unsigned char*)str; *c != 0; c++) {
+		hash ^= *c;
+		hash *= 1099511628211ul;
+	}
+	return hash;
+}
+
+/*
+ * Name function: createRange
+ * Return: the memory address of an empty range
+ * Arguments: none
+ * Purpose: allocate the arrays of indexes and documents of a range
+ */
+Range* createRange(void) {
+	Range *words;
+	words = (Range*)malloc(sizeof(Range));
+	if(words == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	words->index = (int*)malloc(sizeof(int) * BUFLEN);
+	words->doc = (int*)malloc(sizeof(int) * BUFLEN);
+	if(words->index == NULL || words->doc == NULL) {
+		printf("Not enough memory\n");
+		free(words->index);
+		free(words->doc);
+		free(words);
+		return NULL;
+	}
+	words->capacity = BUFLEN;
+	words->size = 0;
+	return words;
+}
+
+/*
+ * Name function: destroyRange
+ * Return: void (it does not return a value)
+ * Arguments: the range
+ * Purpose: free the memory of a range
+ */
+void destroyRange(Range* words) {
+	if(words == NULL) {
+		return;
+	}
+	free(words->index);
+	free(words->doc);
+	free(words);
+}
+
+/*
+ * Name function: addToRange
+ * Return: void (it does not return a value)
+ * Arguments: the range and a posting
+ * Purpose: append a posting to a range, doubling the arrays when they are full
+ */
+void addToRange(Range* words, Posting* posting) {
+	if(words->size == words->capacity) {
+		TRACE_MARK(span);
+		int *index = (int*)realloc(words->index,
+				sizeof(int) * words->capacity * 2);
+		int *doc = (int*)realloc(words->doc, sizeof(int) * words->capacity * 2);
+		if(index != NULL) {
+			words->index = index;
+		}
+		if(doc != NULL) {
+			words->doc = doc;
+		}
+		if(index == NULL || doc == NULL) {
+			printf("Not enough memory\n");
+			return;
+		}
+		words->capacity *= 2;
+		TRACE_PHASE(TRACE_NONE, TRACE_GROW, span);
+	}
+	words->index[words->size] = posting->offset;
+	words->doc[words->size] = posting->doc;
+	words->size++;
+}
+
+/*
+ * The tokenizer splits a text in words that are made of 'a'-'z', '-' and ':'.
+ * It can be fed the text in pieces: a ',' at the end of a piece waits for the
+ * first character of the next one. Only the first ELEMENT_TREE_LENGTH
+ * characters of a word are kept, which is all the tree needs.
+ */
+typedef struct Tokenizer{
+	char word[ELEMENT_TREE_LENGTH + 1];
+	long length;
+	long comma;
+	long pending;
+	Posting posting;
+	void (*emit)(void*, char*, Posting*);
+	void *context;
+}Tokenizer;
+
+/*
+ * Name function: readFile
+ * Return: the memory address of the text, NULL if it can't be read
+ * Arguments: the file and the address where its size is saved
+ * Purpose: read a whole file in a buffer ended by 0
+ */
+char* readFile(char* fileName, long* size){
+	//open the file I am going to read from
+	FILE *in = fopen(fileName, "rt");
+	long fl_size;
+	char *buffer;
+	if (in == NULL) {
+		printf("ERROR: Can't open file %s", fileName);
+		return NULL;
+	}
+
+	//get the size of the file
+	fseek(in, 0, SEEK_END);
+	fl_size = ftell(in);
+	rewind(in);
+
+	//read in a buffer the whole file
+	buffer = (char*)malloc(sizeof(char) * (fl_size + 1));
+	if(buffer == NULL) {
+		printf("Not enough memory\n");
+		fclose(in);
+		return NULL;
+	}
+	//read everything in a buffer
+	fread(buffer, 1, fl_size, in);
+	buffer[fl_size] = 0;
+	fclose(in);
+	*size = fl_size;
+	return buffer;
+}
+
+/*
+ * Name function: initTokenizer
+ * Return: void (it does not return a value)
+ * Arguments: the tokenizer, the id of the document, the function that gets
+ * every word and its context
+ * Purpose: prepare a tokenizer for a new document
+ */
+void initTokenizer(Tokenizer* tokenizer, int doc,
+		void (*emit)(void*, char*, Posting*), void* context) {
+	tokenizer->length = 0;
+	tokenizer->comma = 0;
+	tokenizer->pending = -1;
+	tokenizer->posting.doc = doc;
+	tokenizer->posting.position = 0;
+	tokenizer->emit = emit;
+	tokenizer->context = context;
+}
+
+/*
+ * Name function: flushWord
+ * Return: void (it does not return a value)
+ * Arguments: the tokenizer and the offset of the character after the word
+ * Purpose: give the current word, if there is one, to the emit function
+ */
+void flushWord(Tokenizer* tokenizer, long i) {
+	if(tokenizer->length != 0) {
+		tokenizer->word[MIN(tokenizer->length, ELEMENT_TREE_LENGTH)] = 0;
+		//determining the index of the string and substracting the commas
+		tokenizer->posting.offset = i - tokenizer->length - tokenizer->comma;
+		tokenizer->emit(tokenizer->context, tokenizer->word,
+				&tokenizer->posting);
+		tokenizer->posting.position++;
+		tokenizer->length = 0;
+	}
+}
+
+/*
+ * Name function: tokenize
+ * Return: void (it does not return a value)
+ * Arguments: the tokenizer, a piece of text, its size and the offset of its
+ * first character in the document
+ * Purpose: find the words of a piece of text
+ */
+void tokenize(Tokenizer* tokenizer, char* buffer, long size, long base) {
+	long i;
+	char c;
+	for(i = 0; i < size; i++) {
+		c = buffer[i];
+		//a ',' from the previous piece followed by a space is a comma
+		if(tokenizer->pending >= 0) {
+			if(c == ' ') {
+				tokenizer->comma++;
+			} else {
+				flushWord(tokenizer, tokenizer->pending);
+			}
+			tokenizer->pending = -1;
+		}
+		if(c >= 'a' && c <= 'z' || c == '-' || c == ':') {
+			if(tokenizer->length < ELEMENT_TREE_LENGTH) {
+				tokenizer->word[tokenizer->length] = c;
+			}
+			tokenizer->length++;
+		} else {
+			//calculating the comman
+			if(c == ',') {
+				if(i + 1 == size) {
+					tokenizer->pending = base + i;
+				} else {
+					if(buffer[i + 1] == ' ') {
+						tokenizer->comma++;
+					} else {
+						flushWord(tokenizer, base + i);
+					}
+				}
+			} else {
+				flushWord(tokenizer, base + i);
+			}
+		}
+	}
+}
+
+/*
+ * Name function: finishTokenizer
+ * Return: void (it does not return a value)
+ * Arguments: the tokenizer
+ * Purpose: end a document; like before, a word that is not followed by
+ * anything is not a word
+ */
+void finishTokenizer(Tokenizer* tokenizer) {
+	if(tokenizer->pending >= 0) {
+		flushWord(tokenizer, tokenizer->pending);
+		tokenizer->pending = -1;
+	}
+}
+
+/*
+ * Name function: insertWord
+ * Return: void (it does not return a value)
+ * Arguments: the tree (as the context of a tokenizer), the word and its posting
+ * Purpose: add a word found by a tokenizer into the tree
+ */
+void insertWord(void* tree, char* word, Posting* posting) {
+	insert((TTree*)tree, word, posting);
+}
+
+/*
+ * Name function: addFileToTree
+ * Return: 1 if the file was indexed, 0 otherwise
+ * Arguments: the tree, the file that I read from and the id of the document
+ * Purpose: insert the words of a file in a tree, concerning the index, the
+ * document and the string
+ */
+int addFileToTree(TTree* tree, char* fileName, int doc){
+	Tokenizer tokenizer;
+	long fl_size;
+	TRACE_MARK(span);
+	char *buffer = readFile(fileName, &fl_size);
+	if(buffer == NULL) {
+		return 0;
+	}
+	TRACE_PHASE(TRACE_BUILD, TRACE_IO, span);
+	initTokenizer(&tokenizer, doc, insertWord, tree);
+	tokenize(&tokenizer, buffer, fl_size, 0);
+	finishTokenizer(&tokenizer);
+	free(buffer);
+	TRACE_PHASE(TRACE_BUILD, TRACE_INSERT, span);
+	return 1;
+}
+
+/*
+ * Name function: createWordTree
+ * Return: the memory address of the tree, NULL if there is not enough memory
+ * Arguments: none
+ * Purpose: an empty tree of words and postings; both are flat, so compact can
+ * copy them next to their nodes
+ */
+TTree* createWordTree(void){
+	TTree *tree = createTree(createStrElement, destroyStrElement,
+			createIndexInfo, destroyIndexInfo, compareStrElem);
+	if(tree != NULL) {
+		setFlatSizes(tree, (ELEMENT_TREE_LENGTH + 1) * sizeof(char),
+				sizeof(Posting));
+	}
+	return tree;
+}
+
+/*
+ * Name function: buildTreeFromFile
+ * Return: the memory address of the tree
+ * Arguments: the file that I read from
+ * Purpose: form a tree with the given words from a file, concerning the index,
+ * and the string
+ */
+TTree* buildTreeFromFile(char* fileName){
+	TRACE_BEGIN(span);
+	//create the tree
+	TTree *tree = createWordTree();
+	if(tree == NULL) {
+		return NULL;
+	}
+	if(addFileToTree(tree, fileName, 0) == 0) {
+		destroyTree(tree);
+		return NULL;
+	}
+	TRACE_END(TRACE_BUILD, span);
+	return tree;
+}
+
+/*
+ * Name function: buildTreeFromCorpus
+ * Return: the memory address of the tree
+ * Arguments: the files that I read from and their number
+ * Purpose: form a single tree with the words of every file; the id of a
+ * document is its position in fileNames, so files that can't be read are
+ * skipped without changing the ids of the others
+ */
+TTree* buildTreeFromCorpus(char** fileNames, int count){
+	TRACE_BEGIN(span);
+	TTree *tree = createWordTree();
+	if(tree == NULL) {
+		return NULL;
+	}
+	for(int doc = 0; doc < count; doc++) {
+		if(addFileToTree(tree, fileNames[doc], doc) == 0) {
+			printf("\n");
+		}
+	}
+	TRACE_END(TRACE_BUILD, span);
+	return tree;
+}
+
+/*
+ * Name function: inDocs
+ * Return: 1 if the posting belongs to the set of documents, 0 otherwise
+ * Arguments: the posting and the set of documents (NULL means every document)
+ * Purpose: filter the postings of a query by document
+ */
+int inDocs(Posting* posting, char* docs) {
+	return docs == NULL || docs[posting->doc] != 0;
+}
+
+/*
+ * Name function: walkKey
+ * Return: the first node of the next key
+ * Arguments: the first node of a key, the set of documents and the words
+ * Purpose: add the copies of a key to the words, none if it was deleted
+ */
+TreeNode* walkKey(TreeNode* node, char* docs, Range* words) {
+	TreeNode *end = node->end->next;
+	if(TOMBSTONE(node)) {
+		return end;
+	}
+	for(; node != end; node = node->next) {
+		if(inDocs(node->info, docs)) {
+			addToRange(words, node->info);
+		}
+	}
+	return end;
+}
+
+/*
+ * Name function: walkPrefix
+ * Return: void (it does not return a value)
+ * Arguments: the first node of the first key to look at, the given string,
+ * the set of documents and the words
+ * Purpose: go along the list while the keys start with q, without visiting the
+ * keys before the first match
+ */
+void walkPrefix(TreeNode* node, char* q, char* docs, Range* words) {
+	int length = strlen(q);
+	while(node != NULL && strncmp(node->elem, q, length) == 0) {
+		node = walkKey(node, docs, words);
+	}
+}
+
+/*
+ * Name function: walkInterval
+ * Return: void (it does not return a value)
+ * Arguments: the first node of the first key that is not before q, the
+ * string p, the set of documents and the words
+ * Purpose: go along the list while the keys are not after p (the first
+ * strlen(p) characters are compared)
+ */
+void walkInterval(TreeNode* node, char* p, char* docs, Range* words) {
+	int length = strlen(p);
+	while(node != NULL && strncmp(p, node->elem, length) >= 0) {
+		node = walkKey(node, docs, words);
+	}
+}
+
+/*
+ * Name function: singleKeyRangeQueryBatch
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the strings, their number and an array for the results
+ * Purpose: answer many prefix queries; the descents to the first key of every
+ * query are interleaved by lowerBoundBatch
+ */
+void singleKeyRangeQueryBatch(TTree* tree, char** qs, int n, Range** out){
+	TreeNode **first = (TreeNode**)malloc(sizeof(TreeNode*) * (n + 1));
+	int i;
+	if(first == NULL) {
+		printf("Not enough memory\n");
+		return;
+	}
+	lowerBoundBatch(tree, (void**)qs, n, first);
+	for(i = 0; i < n; i++) {
+		out[i] = createRange();
+		if(out[i] != NULL) {
+			walkPrefix(first[i], qs[i], NULL, out[i]);
+		}
+	}
+	free(first);
+}
+
+/*
+ * Name function: multiKeyRangeQueryBatch
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the strings q and p of every query, their number and
+ * an array for the results
+ * Purpose: answer many interval queries, interleaving the descents
+ */
+void multiKeyRangeQueryBatch(TTree* tree, char** qs, char** ps, int n,
+		Range** out){
+	TreeNode **first = (TreeNode**)malloc(sizeof(TreeNode*) * (n + 1));
+	int i;
+	if(first == NULL) {
+		printf("Not enough memory\n");
+		return;
+	}
+	lowerBoundBatch(tree, (void**)qs, n, first);
+	for(i = 0; i < n; i++) {
+		out[i] = createRange();
+		if(out[i] != NULL) {
+			walkInterval(first[i], ps[i], NULL, out[i]);
+		}
+	}
+	free(first);
+}
+
+/*
+ * Name function: singleKeyRangeQueryInDocs
+ * Return: the address of the words
+ * Arguments: the tree, the given string and the set of documents, given as
+ * one byte per document id (NULL means every document)
+ * Purpose: find the words that start with the given string in some documents
+ * and form an array of indexes
+ */
+Range* singleKeyRangeQueryInDocs(TTree* tree, char* q, char* docs){
+	TRACE_BEGIN(span);
+	Range *words = createRange();
+	if(words == NULL) {
+		return NULL;
+	}
+	TRACE_PHASE(TRACE_PREFIX, TRACE_GROW, span);
+	//the words with the prefix start at the first key >= q
+	TreeNode *first = lowerBoundNode(tree, q);
+	TRACE_PHASE(TRACE_PREFIX, TRACE_DESCENT, span);
+	walkPrefix(first, q, docs, words);
+	TRACE_PHASE(TRACE_PREFIX, TRACE_WALK, span);
+	TRACE_END(TRACE_PREFIX, span);
+	return words;
+}
+
+/*
+ * Name function: singleKeyRangeQuery
+ * Return: the address of the words
+ * Arguments: the tree and the given string
+ * Purpose: find the words that start with the given string and form an array
+ * of indexes
+ */
+Range* singleKeyRangeQuery(TTree* tree, char* q){
+	return singleKeyRangeQueryInDocs(tree, q, NULL);
+}
+
+/*
+ * Name function: isWorse
+ * Return: 1 if the first key ranks after the second one, 0 otherwise
+ * Arguments: two heads of keys
+ * Purpose: rank keys by count and, for equal counts, alphabetically
+ */
+int isWorse(TreeNode* a, TreeNode* b) {
+	if(a->count != b->count) {
+		return a->count < b->count;
+	}
+	return compareStrElem(a->elem, b->elem) > 0;
+}
+
+/*
+ * Name function: siftWorst
+ * Return: void (it does not return a value)
+ * Arguments: the heap of the best keys so far, its size and a position
+ * Purpose: keep the worst of the best keys on top of the heap
+ */
+void siftWorst(TreeNode** heap, int size, int i) {
+	TreeNode *aux;
+	int child;
+	while((child = 2 * i + 1) < size) {
+		if(child + 1 < size && isWorse(heap[child + 1], heap[child])) {
+			child++;
+		}
+		if(!isWorse(heap[child], heap[i])) {
+			break;
+		}
+		aux = heap[i];
+		heap[i] = heap[child];
+		heap[child] = aux;
+		i = child;
+	}
+}
+
+/*
+ * Name function: topKHelper
+ * Return: void (it does not return a value)
+ * Arguments: a node, the prefix, the heap of the best keys, its size and k
+ * Purpose: visit the subtrees that have keys with the prefix and can still
+ * beat the k-th best count, the one with the bigger count first
+ */
+void topKHelper(TreeNode* node, char* q, TreeNode** heap, int* size, int k) {
+	int cmp, i;
+	TreeNode *first, *second;
+
+	if(node == NULL) {
+		return;
+	}
+	if(*size == k && node->maxCount < heap[0]->count) {
+		return;
+	}
+	cmp = strncmp(node->elem, q, strlen(q));
+	//a key deleted by lazyDelete has count 0
+	if(cmp == 0 && node->count > 0) {
+		if(*size < k) {
+			//add the key and move it up to its place
+			i = (*size)++;
+			heap[i] = node;
+			while(i > 0 && isWorse(heap[i], heap[(i - 1) / 2])) {
+				first = heap[i];
+				heap[i] = heap[(i - 1) / 2];
+				heap[(i - 1) / 2] = first;
+				i = (i - 1) / 2;
+			}
+		} else {
+			if(isWorse(heap[0], node)) {
+				heap[0] = node;
+				siftWorst(heap, *size, 0);
+			}
+		}
+	}
+	first = (cmp >= 0) ? node->lt : NULL;
+	second = (cmp <= 0) ? node->rt : NULL;
+	if(MAXCOUNT(second) > MAXCOUNT(first)) {
+		topKHelper(second, q, heap, size, k);
+		topKHelper(first, q, heap, size, k);
+	} else {
+		topKHelper(first, q, heap, size, k);
+		topKHelper(second, q, heap, size, k);
+	}
+}
+
+/*
+ * Name function: topKPrefix
+ * Return: the number of keys that were found (at most k)
+ * Arguments: the tree, the prefix, k and an array of k heads for the result
+ * Purpose: find the k most frequent words that start with q, the most frequent
+ * first; a subtree is skipped when its maximum count can't beat the k-th best
+ */
+int topKPrefix(TTree* tree, char* q, int k, TreeNode** out) {
+	int size = 0, i;
+	TreeNode *aux;
+
+	if(tree == NULL || k <= 0) {
+		return 0;
+	}
+	topKHelper(tree->root, q, out, &size, k);
+	//the heap has the worst key on top, so it is sorted from the end
+	for(i = size - 1; i > 0; i--) {
+		aux = out[0];
+		out[0] = out[i];
+		out[i] = aux;
+		siftWorst(out, i, 0);
+	}
+	return size;
+}
+
+/*
+ * Name function: multiKeyRangeQueryInDocs
+ * Return: the memory address of words
+ * Arguments: the tree, the two strings q, p and the set of documents, given
+ * as one byte per document id (NULL means every document)
+ * Purpose: find the words that are located between the two strings in some
+ * documents and form an array of indexes
+ */
+Range* multiKeyRangeQueryInDocs(TTree* tree, char* q, char* p, char* docs){
+	TRACE_BEGIN(span);
+	Range *words = createRange();
+	if(words == NULL) {
+		return NULL;
+	}
+	TRACE_PHASE(TRACE_INTERVAL, TRACE_GROW, span);
+	//the words that are not before q start at the first key >= q
+	TreeNode *first = lowerBoundNode(tree, q);
+	TRACE_PHASE(TRACE_INTERVAL, TRACE_DESCENT, span);
+	walkInterval(first, p, docs, words);
+	TRACE_PHASE(TRACE_INTERVAL, TRACE_WALK, span);
+	TRACE_END(TRACE_INTERVAL, span);
+	return words;
+}
+
+/*
+ * Name function: multiKeyRangeQuery
+ * Return: the memory address of words
+ * Arguments: the tree, the two strings q, p
+ * Purpose: find the words that are located between the two strings and form 
+ * an array of indexes
+ */
+Range* multiKeyRangeQuery(TTree* tree, char* q, char* p){
+	return multiKeyRangeQueryInDocs(tree, q, p, NULL);
+}
+
+/*
+ * Name function: printWordsInRangeFromCorpus
+ * Return: void (it does not return a value)
+ * Arguments: the range, the files of the corpus and their number
+ * Purpose: print the words of a range grouped by document, so that every file
+ * is opened only once
+ */
+void printWordsInRangeFromCorpus(Range* range, char** fileNames, int count){
+	if(fileNames == NULL || range == NULL) return;
+	int *start = (int*)calloc(count + 1, sizeof(int));
+	int *order = (int*)malloc(sizeof(int) * (range->size + 1));
+	char *buf = (char*) malloc(BUFLEN+1);
+	if(start == NULL || order == NULL || buf == NULL) {
+		printf("Not enough memory\n");
+		free(start);
+		free(order);
+		free(buf);
+		return;
+	}
+	//counting sort of the hits by document, keeping their order
+	for(int i = 0; i < range->size; i++) {
+		start[range->doc[i] + 1]++;
+	}
+	for(int doc = 0; doc < count; doc++) {
+		start[doc + 1] += start[doc];
+	}
+	for(int i = 0; i < range->size; i++) {
+		order[start[range->doc[i]]++] = i;
+	}
+	//start[doc] is now the end of the hits of doc
+	int i = 0;
+	for(int doc = 0; doc < count; doc++) {
+		if(i == start[doc]) continue;
+		FILE * file = fopen(fileNames[doc],"r");
+		printf("%s:\n", fileNames[doc]);
+		for(; i < start[doc]; i++) {
+			int hit = order[i];
+			if(file == NULL) continue;
+			fseek(file,range->index[hit],SEEK_SET);
+			if(fgets(buf,BUFLEN,file) != NULL){
+				char* token = strtok(buf," .,\n");
+				printf("%d. %s:%d\n",hit+1, token, range->index[hit]);
+			}
+		}
+		if(file != NULL) fclose(file);
+	}
+	printf("\n");
+	free(start);
+	free(order);
+	free(buf);
+}
+
+#endif /* DICTIONARY_H_ */
@@ -0,0 +1,617 @@
+#ifndef DOCSTORE_H_
+#define DOCSTORE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dictionary.h"
+
+/*
+ * A compressed copy of a document, so the words of a range can be printed
+ * without the text. The text is cut in blocks of DOC_BLOCK characters and
+ * every block is compressed on its own with an LZ77 code in the style of
+ * LZ4: a sequence is a token (the number of literals in its high 4 bits and
+ * the length of the match minus DOC_MIN_MATCH in its low 4 bits, 15 meaning
+ * that bytes of 255 and a last byte follow), the literals, and the distance
+ * of the match in 2 bytes. A block that doesn't get smaller is kept as it is.
+ * The file has a header, the offset of every block (the map from an offset
+ * of the text to its block is a division) and the blocks. Printing a word
+ * decompresses only its block, and the last DOC_CACHE blocks stay in memory.
+ */
+#define DOC_BLOCK 16384
+#define DOC_CACHE 8
+#define DOC_HASH_BITS 12
+#define DOC_MIN_MATCH 4
+#define DOC_CHAIN 16
+//the size of a block that did not get smaller, with its tokens
+#define DOC_BOUND (DOC_BLOCK + DOC_BLOCK / 255 + 16)
+
+typedef struct DocStoreHeader{
+	long size;
+	long blocks;
+	long blockSize;
+}DocStoreHeader;
+
+typedef struct DocCacheEntry{
+	//-1 for an empty entry
+	long block;
+	long used;
+	unsigned char data[DOC_BLOCK];
+}DocCacheEntry;
+
+typedef struct DocStore{
+	FILE *file;
+	DocStoreHeader header;
+	//block i is at start[i] .. start[i + 1] - 1 of the file
+	long *start;
+	unsigned char *compressed;
+	DocCacheEntry cache[DOC_CACHE];
+	long clock;
+	//the blocks found in the cache and the ones decompressed
+	long hits, misses;
+}DocStore;
+
+typedef struct DocHit{
+	long offset;
+	//the position of the hit in its range
+	int hit;
+}DocHit;
+
+typedef struct DocWords{
+	//the word of hit i starts at text[at[i]], at[i] is -1 if it has none
+	char *text;
+	long *at;
+	long capacity;
+	int size;
+}DocWords;
+
+/*
+ * Name function: putLength
+ * Return: the number of bytes written
+ * Arguments: the place where they are written and the part of a length that
+ * did not fit in its 4 bits
+ * Purpose: write the rest of a length as bytes of 255 and a last byte
+ */
+long putLength(unsigned char* out, long length) {
+	long n = 0;
+	while(length >= 255) {
+		out[n++] = 255;
+		length -= 255;
+	}
+	out[n++] = (unsigned char)length;
+	return n;
+}
+
+/*
+ * Name function: getLength
+ * Return: the length
+ * Arguments: the 4 bits of the token, the address of the place where the
+ * rest is read, which is moved after it, and the end of the block
+ * Purpose: read a length written by putLength
+ */
+long getLength(long length, unsigned char** in, unsigned char* end) {
+	if(length == 15) {
+		while(*in < end && **in == 255) {
+			length += 255;
+			(*in)++;
+		}
+		if(*in < end) {
+			length += **in;
+			(*in)++;
+		}
+	}
+	return length;
+}
+
+/*
+ * Name function: putSequence
+ * Return: the number of bytes written
+ * Arguments: the place where they are written, the literals, their number,
+ * the distance of the match and its length (0 for the last sequence)
+ * Purpose: write one sequence of a compressed block
+ */
+long putSequence(unsigned char* out, unsigned char* literals, long count,
+		long distance, long length) {
+	long n = 1, match = length ? length - DOC_MIN_MATCH : 0;
+	out[0] = (unsigned char)((MIN(count, 15) << 4) | MIN(match, 15));
+	if(count >= 15) {
+		n += putLength(out + n, count - 15);
+	}
+	memcpy(out + n, literals, count);
+	n += count;
+	if(length) {
+		out[n++] = (unsigned char)(distance & 255);
+		out[n++] = (unsigned char)(distance >> 8);
+		if(match >= 15) {
+			n += putLength(out + n, match - 15);
+		}
+	}
+	return n;
+}
+
+/*
+ * Name function: hashFour
+ * Return: the bucket of the 4 characters at a place
+ * Arguments: the place
+ * Purpose: find the last place with the same 4 characters
+ */
+int hashFour(unsigned char* s) {
+	unsigned int x = s[0] | (s[1] << 8) | (s[2] << 16) | ((unsigned int)s[3] << 24);
+	return (x * 2654435761u) >> (32 - DOC_HASH_BITS);
+}
+
+/*
+ * Name function: compressBlock
+ * Return: the size of the compressed block
+ * Arguments: a block, its size (at most DOC_BLOCK) and a place of DOC_BOUND
+ * bytes for the result
+ * Purpose: greedy LZ77: the places with the same first 4 characters are
+ * chained, and the longest of the last DOC_CHAIN matches is taken
+ */
+long compressBlock(unsigned char* in, long size, unsigned char* out) {
+	//the place + 1 of the last 4 characters of every bucket, 0 for none, and
+	//the place + 1 before every place in the same bucket
+	int last[1 << DOC_HASH_BITS], before[DOC_BLOCK];
+	long pos = 0, anchor = 0, match, length, best, distance = 0, n = 0, i;
+	int h, tries;
+
+	memset(last, 0, sizeof(last));
+	while(pos + DOC_MIN_MATCH <= size) {
+		best = 0;
+		for(match = last[hashFour(in + pos)] - 1, tries = 0;
+				match >= 0 && tries < DOC_CHAIN; match = before[match] - 1, tries++) {
+			for(length = 0; pos + length < size &&
+					in[match + length] == in[pos + length]; length++);
+			if(length > best) {
+				best = length;
+				distance = pos - match;
+			}
+		}
+		length = (best >= DOC_MIN_MATCH) ? best : 1;
+		//every place of a match is chained too
+		for(i = pos; i < pos + length && i + DOC_MIN_MATCH <= size; i++) {
+			h = hashFour(in + i);
+			before[i] = last[h];
+			last[h] = i + 1;
+		}
+		if(best >= DOC_MIN_MATCH) {
+			n += putSequence(out + n, in + anchor, pos - anchor, distance, best);
+			anchor = pos + best;
+		}
+		pos += length;
+	}
+	//a block that ends with a match has no last sequence
+	if(anchor < size) {
+		n += putSequence(out + n, in + anchor, size - anchor, 0, 0);
+	}
+	return n;
+}
+
+/*
+ * Name function: decompressBlock
+ * Return: 1 if the block was decompressed, 0 if it is damaged
+ * Arguments: a compressed block, its size, the place of the text and its size
+ * Purpose: copy the literals and the matches of every sequence; a match can
+ * overlap the characters it writes
+ */
+int decompressBlock(unsigned char* in, long size, unsigned char* out,
+		long length) {
+	unsigned char *end = in + size, *to = out, *from, token;
+	long count, distance, match;
+
+	while(to < out + length) {
+		if(in >= end) {
+			return 0;
+		}
+		token = *in++;
+		count = getLength(token >> 4, &in, end);
+		match = token & 15;
+		if(count > end - in || count > out + length - to) {
+			return 0;
+		}
+		memcpy(to, in, count);
+		to += count;
+		in += count;
+		if(to == out + length) {
+			break;
+		}
+		if(end - in < 2) {
+			return 0;
+		}
+		distance = in[0] | (in[1] << 8);
+		in += 2;
+		match = getLength(match, &in, end) + DOC_MIN_MATCH;
+		if(distance == 0 || distance > to - out || match > out + length - to) {
+			return 0;
+		}
+		from = to - distance;
+		if(distance >= match) {
+			memcpy(to, from, match);
+			to += match;
+			continue;
+		}
+		//a match that overlaps repeats its first distance characters
+		for(; match > 0; match--) {
+			*to++ = *from++;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Name function: buildDocStore
+ * Return: 1 if the store was written, 0 otherwise
+ * Arguments: the text file and the file of the store
+ * Purpose: compress a text block by block; the text is read one block at a
+ * time, so it does not have to fit in memory
+ */
+int buildDocStore(char* fileName, char* storeName) {
+	FILE *in = fopen(fileName, "rb"), *out = NULL;
+	DocStoreHeader header = {0, 0, DOC_BLOCK};
+	unsigned char *text = (unsigned char*)malloc(DOC_BLOCK);
+	unsigned char *compressed = (unsigned char*)malloc(DOC_BOUND);
+	long *start = NULL, i, size, n;
+	int failed = 0;
+
+	if(in == NULL) {
+		printf("ERROR: Can't open file %s\n", fileName);
+		free(text);
+		free(compressed);
+		return 0;
+	}
+	fseek(in, 0, SEEK_END);
+	header.size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	header.blocks = (header.size + DOC_BLOCK - 1) / DOC_BLOCK;
+	start = (long*)malloc(sizeof(long) * (header.blocks + 1));
+	if(text == NULL || compressed == NULL || start == NULL) {
+		printf("Not enough memory\n");
+		fclose(in);
+		free(text);
+		free(compressed);
+		free(start);
+		return 0;
+	}
+	out = fopen(storeName, "wb");
+	if(out == NULL) {
+		printf("ERROR: Can't open file %s\n", storeName);
+		fclose(in);
+		free(text);
+		free(compressed);
+		free(start);
+		return 0;
+	}
+	//the map of the blocks is written again once it is known
+	start[0] = sizeof(DocStoreHeader) + sizeof(long) * (header.blocks + 1);
+	fwrite(&header, sizeof(DocStoreHeader), 1, out);
+	fwrite(start, sizeof(long), header.blocks + 1, out);
+	for(i = 0; i < header.blocks && !failed; i++) {
+		size = MIN(DOC_BLOCK, header.size - i * DOC_BLOCK);
+		if(fread(text, 1, size, in) != (size_t)size) {
+			failed = 1;
+			break;
+		}
+		n = compressBlock(text, size, compressed);
+		//a block that did not get smaller is kept as it is
+		if(n >= size) {
+			fwrite(text, 1, size, out);
+			n = size;
+		} else {
+			fwrite(compressed, 1, n, out);
+		}
+		start[i + 1] = start[i] + n;
+	}
+	fseek(out, sizeof(DocStoreHeader), SEEK_SET);
+	fwrite(start, sizeof(long), header.blocks + 1, out);
+	failed |= ferror(out) != 0;
+	failed |= fclose(out) != 0;
+	fclose(in);
+	free(text);
+	free(compressed);
+	free(start);
+	if(failed) {
+		printf("ERROR: Can't write file %s\n", storeName);
+		remove(storeName);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Name function: closeDocStore
+ * Return: void (it does not return a value)
+ * Arguments: the store
+ * Purpose: close a store and free its memory
+ */
+void closeDocStore(DocStore* store) {
+	if(store == NULL) {
+		return;
+	}
+	if(store->file != NULL) {
+		fclose(store->file);
+	}
+	free(store->start);
+	free(store->compressed);
+	free(store);
+}
+
+/*
+ * Name function: openDocStore
+ * Return: the memory address of the store, NULL if it can't be read
+ * Arguments: the file of the store
+ * Purpose: read the header and the map of the blocks; the blocks are read
+ * when they are needed
+ */
+DocStore* openDocStore(char* storeName) {
+	DocStore *store = (DocStore*)calloc(1, sizeof(DocStore));
+	int i;
+
+	if(store == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	store->file = fopen(storeName, "rb");
+	if(store->file == NULL || fread(&store->header, sizeof(DocStoreHeader), 1,
+			store->file) != 1 || store->header.blockSize != DOC_BLOCK) {
+		printf("ERROR: Can't open file %s\n", storeName);
+		closeDocStore(store);
+		return NULL;
+	}
+	store->start = (long*)malloc(sizeof(long) * (store->header.blocks + 1));
+	store->compressed = (unsigned char*)malloc(DOC_BOUND);
+	if(store->start == NULL || store->compressed == NULL) {
+		printf("Not enough memory\n");
+		closeDocStore(store);
+		return NULL;
+	}
+	if(fread(store->start, sizeof(long), store->header.blocks + 1,
+			store->file) != (size_t)(store->header.blocks + 1)) {
+		printf("ERROR: Can't open file %s\n", storeName);
+		closeDocStore(store);
+		return NULL;
+	}
+	for(i = 0; i < DOC_CACHE; i++) {
+		store->cache[i].block = -1;
+	}
+	return store;
+}
+
+/*
+ * Name function: loadBlock
+ * Return: the text of a block, NULL if it can't be read
+ * Arguments: the store and the number of the block
+ * Purpose: take a block from the cache, or decompress it in place of the
+ * block that was used the longest time ago
+ */
+unsigned char* loadBlock(DocStore* store, long block) {
+	DocCacheEntry *entry = &store->cache[0];
+	long size = MIN(DOC_BLOCK, store->header.size - block * DOC_BLOCK);
+	long stored = store->start[block + 1] - store->start[block];
+	int i;
+
+	store->clock++;
+	for(i = 0; i < DOC_CACHE; i++) {
+		if(store->cache[i].block == block) {
+			store->cache[i].used = store->clock;
+			store->hits++;
+			return store->cache[i].data;
+		}
+		if(store->cache[i].used < entry->used) {
+			entry = &store->cache[i];
+		}
+	}
+	store->misses++;
+	entry->block = -1;
+	if(stored > DOC_BOUND || fseek(store->file, store->start[block], SEEK_SET) ||
+			fread(store->compressed, 1, stored, store->file) != (size_t)stored) {
+		printf("ERROR: Can't read the block %ld\n", block);
+		return NULL;
+	}
+	//a block of the same size as its text is not compressed
+	if(stored == size) {
+		memcpy(entry->data, store->compressed, size);
+	} else if(!decompressBlock(store->compressed, stored, entry->data, size)) {
+		printf("ERROR: Can't read the block %ld\n", block);
+		return NULL;
+	}
+	entry->block = block;
+	entry->used = store->clock;
+	return entry->data;
+}
+
+/*
+ * Name function: docStoreLine
+ * Return: the line, NULL if the offset is after the end of the text
+ * Arguments: the store, an offset of the text, a buffer and its size
+ * Purpose: the same characters as fseek and fgets on the text: up to the end
+ * of the line, at most size - 1 of them
+ */
+char* docStoreLine(DocStore* store, long offset, char* line, int size) {
+	unsigned char *data;
+	long block, i, end;
+	int n = 0;
+
+	if(offset < 0 || offset >= store->header.size || size < 2) {
+		return NULL;
+	}
+	while(n < size - 1 && offset < store->header.size) {
+		block = offset / DOC_BLOCK;
+		data = loadBlock(store, block);
+		if(data == NULL) {
+			return NULL;
+		}
+		end = MIN(DOC_BLOCK, store->header.size - block * DOC_BLOCK);
+		for(i = offset % DOC_BLOCK; i < end && n < size - 1; i++) {
+			line[n++] = data[i];
+			if(data[i] == '\n') {
+				line[n] = 0;
+				return line;
+			}
+		}
+		offset = block * DOC_BLOCK + i;
+	}
+	line[n] = 0;
+	return line;
+}
+
+/*
+ * Name function: docStoreWord
+ * Return: the word, NULL if the offset is after the end of the text
+ * Arguments: the store, an offset of the text, a buffer and its size
+ * Purpose: the first word of the line that docStoreLine reads, like
+ * strtok(line, " .,\n"), without reading the rest of the line; a line
+ * without a word gives an empty word
+ */
+char* docStoreWord(DocStore* store, long offset, char* word, int size) {
+	unsigned char *data;
+	long block, i, end;
+	int n = 0, read = 0;
+	char c;
+
+	if(offset < 0 || offset >= store->header.size || size < 2) {
+		return NULL;
+	}
+	while(read < size - 1 && offset < store->header.size) {
+		block = offset / DOC_BLOCK;
+		data = loadBlock(store, block);
+		if(data == NULL) {
+			return NULL;
+		}
+		end = MIN(DOC_BLOCK, store->header.size - block * DOC_BLOCK);
+		for(i = offset % DOC_BLOCK; i < end && read < size - 1; i++, read++) {
+			c = data[i];
+			if(c == 0 || c == '\n' || ((c == ' ' || c == '.' || c == ',') &&
+					n > 0)) {
+				word[n] = 0;
+				return word;
+			}
+			if(c != ' ' && c != '.' && c != ',') {
+				word[n++] = c;
+			}
+		}
+		offset = block * DOC_BLOCK + i;
+	}
+	word[n] = 0;
+	return word;
+}
+
+/*
+ * Name function: compareDocHits
+ * Return: a negative number, 0 or a positive number, like strcmp
+ * Arguments: two hits
+ * Purpose: order the hits by their offset in the text
+ */
+int compareDocHits(const void* a, const void* b) {
+	const DocHit *x = (const DocHit*)a, *y = (const DocHit*)b;
+	if(x->offset != y->offset) {
+		return (x->offset < y->offset) ? -1 : 1;
+	}
+	return x->hit - y->hit;
+}
+
+/*
+ * Name function: destroyDocWords
+ * Return: void (it does not return a value)
+ * Arguments: the words
+ * Purpose: free the words read from a store
+ */
+void destroyDocWords(DocWords* words) {
+	if(words == NULL) {
+		return;
+	}
+	free(words->text);
+	free(words->at);
+	free(words);
+}
+
+/*
+ * Name function: docStoreWords
+ * Return: the memory address of the words, NULL if there is not enough memory
+ * Arguments: the store and a range of its document
+ * Purpose: read the word at every offset of a range with docStoreWord; the
+ * hits are read in the order of their offsets, so every block is
+ * decompressed once
+ */
+DocWords* docStoreWords(DocStore* store, Range* range) {
+	DocWords *words = (DocWords*)calloc(1, sizeof(DocWords));
+	DocHit *hits = (DocHit*)malloc(sizeof(DocHit) * (range->size + 1));
+	char word[BUFLEN + 1], *text;
+	long used = 0, length;
+	int i;
+
+	if(words != NULL) {
+		words->size = range->size;
+		words->at = (long*)malloc(sizeof(long) * (range->size + 1));
+		words->capacity = BUFLEN;
+		words->text = (char*)malloc(words->capacity);
+	}
+	if(words == NULL || hits == NULL || words->at == NULL ||
+			words->text == NULL) {
+		printf("Not enough memory\n");
+		destroyDocWords(words);
+		free(hits);
+		return NULL;
+	}
+	for(i = 0; i < range->size; i++) {
+		hits[i].offset = range->index[i];
+		hits[i].hit = i;
+	}
+	qsort(hits, range->size, sizeof(DocHit), compareDocHits);
+	for(i = 0; i < range->size; i++) {
+		words->at[hits[i].hit] = -1;
+		if(docStoreWord(store, hits[i].offset, word, BUFLEN) == NULL) {
+			continue;
+		}
+		length = strlen(word);
+		if(used + length + 1 > words->capacity) {
+			text = (char*)realloc(words->text, MAX(words->capacity * 2,
+					used + length + 1));
+			if(text == NULL) {
+				printf("Not enough memory\n");
+				continue;
+			}
+			words->text = text;
+			words->capacity = MAX(words->capacity * 2, used + length + 1);
+		}
+		memcpy(words->text + used, word, length + 1);
+		words->at[hits[i].hit] = used;
+		used += length + 1;
+	}
+	free(hits);
+	return words;
+}
+
+/*
+ * Name function: printWordsInRangeFromStore
+ * Return: void (it does not return a value)
+ * Arguments: the range and the store of its document
+ * Purpose: print the same lines as printWordsInRangeFromFile, without the text
+ */
+void printWordsInRangeFromStore(Range* range, DocStore* store) {
+	DocWords *words;
+	int i;
+	if(store == NULL || range == NULL) {
+		return;
+	}
+	words = docStoreWords(store, range);
+	if(words == NULL) {
+		return;
+	}
+	for(i = 0; i < range->size; i++) {
+		if(words->at[i] < 0) {
+			continue;
+		}
+		//strtok finds no word on that line and glibc prints its NULL like this
+		if(words->text[words->at[i]] == 0) {
+			printf("%d. (null):%d\n", i + 1, range->index[i]);
+		} else {
+			printf("%d. %s:%d\n", i + 1, words->text + words->at[i],
+					range->index[i]);
+		}
+	}
+	printf("\n");
+	destroyDocWords(words);
+}
+
+#endif /* DOCSTORE_H_ */
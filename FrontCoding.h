@@ -0,0 +1,349 @@
+#ifndef FRONTCODING_H_
+#define FRONTCODING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dictionary.h"
+
+/*
+ * A read-only copy of a dictionary tree that keeps its keys front coded. The
+ * sorted keys are cut in blocks of FRONT_BLOCK keys; the first key of a block
+ * is written whole and every other key only as the length of the prefix it
+ * shares with the key before it and the characters after that prefix. When
+ * both lengths are small they share one byte (shared * 16 + suffix), otherwise
+ * the byte is FRONT_ESCAPE * 16 and the two lengths follow as varints. The
+ * offsets of the blocks are the sampled index: a search compares the first
+ * keys of the blocks with a binary search and then decodes one block.
+ * Unlike StaticIndex, the keys can have any length.
+ */
+#define FRONT_BLOCK 32
+#define FRONT_ESCAPE 15
+
+typedef struct FrontDict{
+	//number of distinct keys
+	long size;
+	long blocks;
+	//block b is data[blockStart[b]] .. data[blockStart[b + 1] - 1]
+	long *blockStart;
+	unsigned char *data;
+	//the length of the longest key, for the buffers of the decoder
+	int longest;
+	//the postings of key i are postings[start[i]] .. postings[start[i + 1] - 1]
+	long *start;
+	Posting *postings;
+}FrontDict;
+
+/*
+ * Name function: putVarint
+ * Return: the number of bytes written
+ * Arguments: the place where the number is written (NULL to only count the
+ * bytes) and the number
+ * Purpose: write a number 7 bits at a time, the last byte without its high bit
+ */
+int putVarint(unsigned char* out, long value) {
+	int n = 0;
+	while(value >= 0x80) {
+		if(out != NULL) {
+			out[n] = (unsigned char)(value | 0x80);
+		}
+		value >>= 7;
+		n++;
+	}
+	if(out != NULL) {
+		out[n] = (unsigned char)value;
+	}
+	return n + 1;
+}
+
+/*
+ * Name function: getVarint
+ * Return: the number
+ * Arguments: the address of the place where the number is read, which is
+ * moved after it
+ * Purpose: read a number written by putVarint
+ */
+long getVarint(unsigned char** in) {
+	long value = 0;
+	int shift = 0;
+	while(**in & 0x80) {
+		value |= (long)(**in & 0x7f) << shift;
+		shift += 7;
+		(*in)++;
+	}
+	value |= (long)**in << shift;
+	(*in)++;
+	return value;
+}
+
+/*
+ * Name function: encodeKey
+ * Return: the number of bytes of the coded key
+ * Arguments: the place where it is written (NULL to only count the bytes), the
+ * key before it ("" for the first key of a block) and the key
+ * Purpose: write a key as the prefix it shares with the key before and the
+ * rest of its characters
+ */
+long encodeKey(unsigned char* out, char* before, char* key) {
+	int shared = 0, suffix, n;
+	while(before[shared] != 0 && before[shared] == key[shared]) {
+		shared++;
+	}
+	suffix = strlen(key + shared);
+	if(shared < FRONT_ESCAPE && suffix < 16) {
+		if(out != NULL) {
+			out[0] = (unsigned char)(shared * 16 + suffix);
+		}
+		n = 1;
+	} else {
+		if(out != NULL) {
+			out[0] = FRONT_ESCAPE * 16;
+		}
+		n = 1 + putVarint(out ? out + 1 : NULL, shared);
+		n += putVarint(out ? out + n : NULL, suffix);
+	}
+	if(out != NULL) {
+		memcpy(out + n, key + shared, suffix);
+	}
+	return n + suffix;
+}
+
+/*
+ * Name function: decodeKey
+ * Return: the place after the coded key
+ * Arguments: a coded key and the key before it, which is overwritten with it
+ * Purpose: rebuild a key from its shared prefix and the rest of its characters
+ */
+unsigned char* decodeKey(unsigned char* in, char* key) {
+	long shared = *in >> 4, suffix = *in & 15;
+	in++;
+	if(shared == FRONT_ESCAPE) {
+		shared = getVarint(&in);
+		suffix = getVarint(&in);
+	}
+	memcpy(key + shared, in, suffix);
+	key[shared + suffix] = 0;
+	return in + suffix;
+}
+
+/*
+ * Name function: destroyFrontDict
+ * Return: void (it does not return a value)
+ * Arguments: the dictionary
+ * Purpose: free the memory of a dictionary
+ */
+void destroyFrontDict(FrontDict* dict) {
+	if(dict == NULL) {
+		return;
+	}
+	free(dict->blockStart);
+	free(dict->data);
+	free(dict->start);
+	free(dict->postings);
+	free(dict);
+}
+
+/*
+ * Name function: buildFrontDict
+ * Return: the memory address of the dictionary
+ * Arguments: a dictionary tree
+ * Purpose: copy the keys of a tree in front coded blocks and their postings
+ * after them; the postings of a key keep the order of its list of duplicates
+ */
+FrontDict* buildFrontDict(TTree* tree) {
+	FrontDict *dict = (FrontDict*)calloc(1, sizeof(FrontDict));
+	TreeNode *node, *copy;
+	char *before = "";
+	long count = 0, bytes = 0, t = 0;
+
+	if(dict == NULL || tree == NULL) {
+		printf("Not enough memory\n");
+		free(dict);
+		return NULL;
+	}
+	//the list of the tree is sorted; the keys deleted by lazyDelete are left out
+	for(node = tree->root ? minimum(tree, tree->root) : NULL; node != NULL;
+			node = node->end->next) {
+		if(TOMBSTONE(node)) {
+			continue;
+		}
+		bytes += encodeKey(NULL, (dict->size % FRONT_BLOCK) ? before : "",
+				node->elem);
+		dict->longest = MAX(dict->longest, (int)strlen(node->elem));
+		before = node->elem;
+		dict->size++;
+		count += node->count;
+	}
+	dict->blocks = (dict->size + FRONT_BLOCK - 1) / FRONT_BLOCK;
+	dict->blockStart = (long*)malloc(sizeof(long) * (dict->blocks + 1));
+	dict->data = (unsigned char*)malloc(bytes + 1);
+	dict->start = (long*)malloc(sizeof(long) * (dict->size + 1));
+	dict->postings = (Posting*)malloc(sizeof(Posting) * (count + 1));
+	if(dict->blockStart == NULL || dict->data == NULL || dict->start == NULL ||
+			dict->postings == NULL) {
+		printf("Not enough memory\n");
+		destroyFrontDict(dict);
+		return NULL;
+	}
+
+	count = 0;
+	bytes = 0;
+	for(node = tree->root ? minimum(tree, tree->root) : NULL; node != NULL;
+			node = node->end->next) {
+		if(TOMBSTONE(node)) {
+			continue;
+		}
+		if(t % FRONT_BLOCK == 0) {
+			dict->blockStart[t / FRONT_BLOCK] = bytes;
+			before = "";
+		}
+		bytes += encodeKey(dict->data + bytes, before, node->elem);
+		before = node->elem;
+		dict->start[t++] = count;
+		for(copy = node; copy != node->end->next; copy = copy->next) {
+			dict->postings[count++] = *((Posting*)copy->info);
+		}
+	}
+	dict->blockStart[dict->blocks] = bytes;
+	dict->start[t] = count;
+	return dict;
+}
+
+/*
+ * Name function: frontDictBytes
+ * Return: the number of bytes of the keys and of the index of the blocks
+ * Arguments: the dictionary
+ * Purpose: the memory the front coding takes for the keys
+ */
+long frontDictBytes(FrontDict* dict) {
+	return dict->blockStart[dict->blocks] + sizeof(long) * (dict->blocks + 1);
+}
+
+/*
+ * Name function: frontAfter
+ * Return: 1 if the key is at or after the bound, 0 otherwise
+ * Arguments: a key, a string, the number of characters compared and whether
+ * only the keys after the string count
+ * Purpose: the order of the keys for frontBound
+ */
+int frontAfter(char* key, char* s, int length, int after) {
+	int cmp = strncmp(key, s, length);
+	return cmp > 0 || (cmp == 0 && !after);
+}
+
+/*
+ * Name function: frontBound
+ * Return: the position of the first key whose first length characters are
+ * >= s (> s if after is 1), size if there is none
+ * Arguments: the dictionary, a string, the number of characters compared
+ * (strlen(s) + 1 compares the whole key) and whether the equal keys are
+ * skipped
+ * Purpose: a binary search on the first keys of the blocks, then a walk
+ * through the block before the first one that is at or after the bound
+ */
+long frontBound(FrontDict* dict, char* s, int length, int after) {
+	char key[dict->longest + 1];
+	unsigned char *in;
+	long low = 0, high = dict->blocks, middle, t;
+
+	while(low < high) {
+		middle = (low + high) / 2;
+		decodeKey(dict->data + dict->blockStart[middle], key);
+		if(frontAfter(key, s, length, after)) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+	if(low == 0) {
+		return 0;
+	}
+	//the first key of block low - 1 is before the bound, the answer is after it
+	t = (low - 1) * FRONT_BLOCK;
+	in = decodeKey(dict->data + dict->blockStart[low - 1], key);
+	for(t++; t < MIN(low * FRONT_BLOCK, dict->size); t++) {
+		in = decodeKey(in, key);
+		if(frontAfter(key, s, length, after)) {
+			return t;
+		}
+	}
+	return t;
+}
+
+/*
+ * Name function: frontKey
+ * Return: void (it does not return a value)
+ * Arguments: the dictionary, the position of a key and a buffer of at least
+ * longest + 1 characters
+ * Purpose: decode the key at a position, from the start of its block
+ */
+void frontKey(FrontDict* dict, long t, char* key) {
+	unsigned char *in = dict->data + dict->blockStart[t / FRONT_BLOCK];
+	long i;
+	for(i = t - t % FRONT_BLOCK; i <= t; i++) {
+		in = decodeKey(in, key);
+	}
+}
+
+/*
+ * Name function: frontSlice
+ * Return: the memory address of the words
+ * Arguments: the dictionary and the keys [first, last) of the sorted order
+ * Purpose: copy the postings of a run of keys into a range
+ */
+Range* frontSlice(FrontDict* dict, long first, long last) {
+	Range *words = createRange();
+	long i;
+	if(words == NULL || dict == NULL || first >= last) {
+		return words;
+	}
+	for(i = dict->start[first]; i < dict->start[last]; i++) {
+		addToRange(words, &dict->postings[i]);
+	}
+	return words;
+}
+
+/*
+ * Name function: frontLookup
+ * Return: the memory address of the words
+ * Arguments: the dictionary and a key
+ * Purpose: find the words of a key
+ */
+Range* frontLookup(FrontDict* dict, char* key) {
+	char found[dict->longest + 1];
+	long first = frontBound(dict, key, strlen(key) + 1, 0);
+	if(first < dict->size) {
+		frontKey(dict, first, found);
+		if(strcmp(found, key) == 0) {
+			return frontSlice(dict, first, first + 1);
+		}
+	}
+	return createRange();
+}
+
+/*
+ * Name function: frontPrefixQuery
+ * Return: the memory address of the words
+ * Arguments: the dictionary and the given string
+ * Purpose: the same words as singleKeyRangeQuery
+ */
+Range* frontPrefixQuery(FrontDict* dict, char* q) {
+	int length = strlen(q);
+	return frontSlice(dict, frontBound(dict, q, length + 1, 0),
+			frontBound(dict, q, length, 1));
+}
+
+/*
+ * Name function: frontIntervalQuery
+ * Return: the memory address of the words
+ * Arguments: the dictionary and the two strings q, p
+ * Purpose: the same words as multiKeyRangeQuery: the keys not before q whose
+ * first strlen(p) characters are not after p
+ */
+Range* frontIntervalQuery(FrontDict* dict, char* q, char* p) {
+	return frontSlice(dict, frontBound(dict, q, strlen(q) + 1, 0),
+			frontBound(dict, p, strlen(p), 1));
+}
+
+#endif /* FRONTCODING_H_ */
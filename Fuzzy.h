@@ -0,0 +1,117 @@
+#ifndef FUZZY_H_
+#define FUZZY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dictionary.h"
+
+/*
+ * Searching the keys that are at most a number of edits (insertions,
+ * deletions, substitutions) away from a word. The keys are visited in
+ * sorted order, so a key shares a prefix with the one before it and the
+ * Levenshtein rows of that prefix are kept: row d is the distance between
+ * the first d characters of the key and every prefix of the word. When the
+ * smallest value of a row is over the limit, no key with that prefix can be
+ * close enough, and the search jumps to the first key after the prefix.
+ */
+
+/*
+ * Name function: fillFuzzyRow
+ * Return: the smallest value of the new row
+ * Arguments: the row before, the new row, the word, its length and the
+ * character of the key that the new row adds
+ * Purpose: compute one row of the Levenshtein table
+ */
+int fillFuzzyRow(int* before, int* row, char* word, int length, char c) {
+	int j, best;
+	row[0] = before[0] + 1;
+	best = row[0];
+	for(j = 1; j <= length; j++) {
+		row[j] = MIN(MIN(before[j] + 1, row[j - 1] + 1),
+				before[j - 1] + (word[j - 1] != c));
+		best = MIN(best, row[j]);
+	}
+	return best;
+}
+
+/*
+ * Name function: skipPrefix
+ * Return: void (it does not return a value)
+ * Arguments: a cursor, a key and the length of its prefix
+ * Purpose: move the cursor over every key that starts with the first length
+ * characters of key
+ */
+void skipPrefix(TreeCursor* cursor, char* key, int length) {
+	char after[ELEMENT_TREE_LENGTH + 1];
+	memcpy(after, key, length);
+	after[length] = 0;
+	//no key character is the biggest char, so this can't overflow
+	after[length - 1]++;
+	cursorSeek(cursor, after);
+}
+
+/*
+ * Name function: fuzzySearch
+ * Return: the memory address of the words
+ * Arguments: the tree, a word and the maximum number of edits
+ * Purpose: find the words whose key is at most maxEdits edits away from the
+ * key of the given word, in the order of the keys
+ */
+Range* fuzzySearch(TTree* tree, char* word, int maxEdits) {
+	int rows[ELEMENT_TREE_LENGTH + 1][ELEMENT_TREE_LENGTH + 1];
+	char before[ELEMENT_TREE_LENGTH + 1] = "", *key, *q;
+	Range *words = createRange();
+	TreeCursor cursor;
+	TreeNode *node;
+	int length, depth, shared, j, pruned;
+
+	if(words == NULL || tree == NULL || tree->root == NULL) {
+		return words;
+	}
+	//the keys only keep the first characters of a word
+	q = createStrElement(word);
+	if(q == NULL) {
+		return words;
+	}
+	length = strlen(q);
+	for(j = 0; j <= length; j++) {
+		rows[0][j] = j;
+	}
+
+	cursor = cursorFirst(tree);
+	while(cursor.node != NULL) {
+		key = cursor.head->elem;
+		//the rows of the prefix shared with the key before are still right
+		for(shared = 0; key[shared] != 0 && key[shared] == before[shared];
+				shared++);
+		pruned = 0;
+		for(depth = shared + 1; key[depth - 1] != 0; depth++) {
+			if(fillFuzzyRow(rows[depth - 1], rows[depth], q, length,
+					key[depth - 1]) > maxEdits) {
+				pruned = 1;
+				break;
+			}
+		}
+		if(pruned) {
+			//only the rows of the shorter prefix stay right for the next key
+			memcpy(before, key, depth - 1);
+			before[depth - 1] = 0;
+			skipPrefix(&cursor, key, depth);
+			continue;
+		}
+		strcpy(before, key);
+		if(rows[depth - 1][length] <= maxEdits) {
+			for(node = cursor.head; node != cursor.head->end->next;
+					node = node->next) {
+				addToRange(words, node->info);
+			}
+		}
+		cursorNextKey(&cursor);
+	}
+	destroyStrElement(q);
+	return words;
+}
+
+#endif /* FUZZY_H_ */
@@ -0,0 +1,347 @@
+#ifndef INGEST_H_
+#define INGEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "Dictionary.h"
+
+/*
+ * Building the tree in three stages that run at the same time: a reader
+ * thread reads the documents in pieces into a ring of buffers, a tokenizer
+ * thread finds the words of the buffer before it and puts them in batches,
+ * and the calling thread inserts the batches in the tree. Between two stages
+ * there is a bounded queue, so a stage that is ahead waits instead of using
+ * more memory; the empty buffers and batches go back to the stage before.
+ */
+#define INGEST_BUFFERS 4
+#define INGEST_CHUNK (64 * BUFLEN)
+#define INGEST_BATCHES 4
+#define INGEST_TOKENS BUFLEN
+
+typedef struct IngestQueue{
+	void **items;
+	int capacity;
+	int first, count;
+	int closed;
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty, notFull;
+}IngestQueue;
+
+typedef struct IngestBuffer{
+	char data[INGEST_CHUNK];
+	long size;
+	//the offset of the first character in its document
+	long base;
+	int doc;
+	//whether it is the end of its document
+	int last;
+}IngestBuffer;
+
+typedef struct IngestToken{
+	char word[ELEMENT_TREE_LENGTH + 1];
+	Posting posting;
+}IngestToken;
+
+typedef struct IngestBatch{
+	IngestToken tokens[INGEST_TOKENS];
+	int size;
+}IngestBatch;
+
+typedef struct Ingest{
+	char **fileNames;
+	int count;
+	//full and empty buffers, full and empty batches
+	IngestQueue buffers, freeBuffers;
+	IngestQueue batches, freeBatches;
+	//the batch that the tokenizer is filling
+	IngestBatch *batch;
+	//where the tokenizer gives the words
+	void (*emit)(void*, char*, Posting*);
+	void *context;
+}Ingest;
+
+/*
+ * Name function: initQueue
+ * Return: 1 if the queue was made, 0 otherwise
+ * Arguments: the queue and its capacity
+ * Purpose: prepare an empty bounded queue
+ */
+int initQueue(IngestQueue* queue, int capacity) {
+	queue->items = (void**)malloc(sizeof(void*) * capacity);
+	if(queue->items == NULL) {
+		printf("Not enough memory\n");
+		return 0;
+	}
+	queue->capacity = capacity;
+	queue->first = 0;
+	queue->count = 0;
+	queue->closed = 0;
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->notEmpty, NULL);
+	pthread_cond_init(&queue->notFull, NULL);
+	return 1;
+}
+
+/*
+ * Name function: destroyQueue
+ * Return: void (it does not return a value)
+ * Arguments: the queue and whether the items left have to be freed
+ * Purpose: free a queue
+ */
+void destroyQueue(IngestQueue* queue, int items) {
+	if(queue->items == NULL) {
+		return;
+	}
+	while(items && queue->count > 0) {
+		free(queue->items[queue->first]);
+		queue->first = (queue->first + 1) % queue->capacity;
+		queue->count--;
+	}
+	free(queue->items);
+	queue->items = NULL;
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->notEmpty);
+	pthread_cond_destroy(&queue->notFull);
+}
+
+/*
+ * Name function: putQueue
+ * Return: void (it does not return a value)
+ * Arguments: the queue and an item
+ * Purpose: add an item at the end of a queue, waiting while it is full
+ */
+void putQueue(IngestQueue* queue, void* item) {
+	pthread_mutex_lock(&queue->lock);
+	while(queue->count == queue->capacity) {
+		pthread_cond_wait(&queue->notFull, &queue->lock);
+	}
+	queue->items[(queue->first + queue->count) % queue->capacity] = item;
+	queue->count++;
+	pthread_cond_signal(&queue->notEmpty);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+/*
+ * Name function: getQueue
+ * Return: the first item, NULL if the queue is closed and empty
+ * Arguments: the queue
+ * Purpose: take the first item of a queue, waiting while it is empty
+ */
+void* getQueue(IngestQueue* queue) {
+	void *item = NULL;
+	pthread_mutex_lock(&queue->lock);
+	while(queue->count == 0 && queue->closed == 0) {
+		pthread_cond_wait(&queue->notEmpty, &queue->lock);
+	}
+	if(queue->count > 0) {
+		item = queue->items[queue->first];
+		queue->first = (queue->first + 1) % queue->capacity;
+		queue->count--;
+		pthread_cond_signal(&queue->notFull);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return item;
+}
+
+/*
+ * Name function: closeQueue
+ * Return: void (it does not return a value)
+ * Arguments: the queue
+ * Purpose: tell the stage after a queue that nothing else will come
+ */
+void closeQueue(IngestQueue* queue) {
+	pthread_mutex_lock(&queue->lock);
+	queue->closed = 1;
+	pthread_cond_broadcast(&queue->notEmpty);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+/*
+ * Name function: readStage
+ * Return: NULL
+ * Arguments: the pipeline
+ * Purpose: read every document in pieces, filling the empty buffers
+ */
+void* readStage(void* argument) {
+	Ingest *ingest = (Ingest*)argument;
+	IngestBuffer *buffer;
+	FILE *in;
+	long base;
+
+	for(int doc = 0; doc < ingest->count; doc++) {
+		in = fopen(ingest->fileNames[doc], "rt");
+		if(in == NULL) {
+			//like buildTreeFromCorpus, the other documents keep their ids
+			printf("ERROR: Can't open file %s\n", ingest->fileNames[doc]);
+			continue;
+		}
+		base = 0;
+		do {
+			buffer = (IngestBuffer*)getQueue(&ingest->freeBuffers);
+			buffer->size = fread(buffer->data, 1, INGEST_CHUNK, in);
+			buffer->base = base;
+			buffer->doc = doc;
+			buffer->last = buffer->size < INGEST_CHUNK;
+			base += buffer->size;
+			putQueue(&ingest->buffers, buffer);
+		} while(buffer->last == 0);
+		fclose(in);
+	}
+	closeQueue(&ingest->buffers);
+	return NULL;
+}
+
+/*
+ * Name function: addToBatch
+ * Return: void (it does not return a value)
+ * Arguments: the pipeline (as the context of a tokenizer), the word and its
+ * posting
+ * Purpose: save a word in the current batch and send the batch to the
+ * inserter when it is full
+ */
+void addToBatch(void* context, char* word, Posting* posting) {
+	Ingest *ingest = (Ingest*)context;
+	IngestToken *token;
+	if(ingest->batch == NULL) {
+		ingest->batch = (IngestBatch*)getQueue(&ingest->freeBatches);
+		ingest->batch->size = 0;
+	}
+	token = &ingest->batch->tokens[ingest->batch->size++];
+	strcpy(token->word, word);
+	token->posting = *posting;
+	if(ingest->batch->size == INGEST_TOKENS) {
+		putQueue(&ingest->batches, ingest->batch);
+		ingest->batch = NULL;
+	}
+}
+
+/*
+ * Name function: tokenizeStage
+ * Return: NULL
+ * Arguments: the pipeline
+ * Purpose: find the words of the full buffers and give the buffers back
+ */
+void* tokenizeStage(void* argument) {
+	Ingest *ingest = (Ingest*)argument;
+	IngestBuffer *buffer;
+	Tokenizer tokenizer;
+
+	while((buffer = (IngestBuffer*)getQueue(&ingest->buffers)) != NULL) {
+		if(buffer->base == 0) {
+			initTokenizer(&tokenizer, buffer->doc, ingest->emit,
+					ingest->context);
+		}
+		tokenize(&tokenizer, buffer->data, buffer->size, buffer->base);
+		if(buffer->last) {
+			finishTokenizer(&tokenizer);
+		}
+		putQueue(&ingest->freeBuffers, buffer);
+	}
+	if(ingest->batch != NULL) {
+		putQueue(&ingest->batches, ingest->batch);
+		ingest->batch = NULL;
+	}
+	closeQueue(&ingest->batches);
+	return NULL;
+}
+
+/*
+ * Name function: destroyIngest
+ * Return: void (it does not return a value)
+ * Arguments: the pipeline
+ * Purpose: free the queues and the buffers and batches that are in them
+ */
+void destroyIngest(Ingest* ingest) {
+	destroyQueue(&ingest->buffers, 1);
+	destroyQueue(&ingest->freeBuffers, 1);
+	destroyQueue(&ingest->batches, 1);
+	destroyQueue(&ingest->freeBatches, 1);
+}
+
+/*
+ * Name function: ingestIntoTree
+ * Return: 1 if the pipeline ran, 0 otherwise
+ * Arguments: the tree, the files that I read from and their number
+ * Purpose: insert the words of every file in a tree, reading, tokenizing and
+ * inserting at the same time; the tree is the same as with addFileToTree
+ */
+int ingestIntoTree(TTree* tree, char** fileNames, int count) {
+	Ingest ingest;
+	IngestBatch *batch;
+	pthread_t reader, tokenizer;
+	void *item;
+	int i, threads = 1;
+
+	memset(&ingest, 0, sizeof(Ingest));
+	ingest.fileNames = fileNames;
+	ingest.count = count;
+	ingest.emit = addToBatch;
+	ingest.context = &ingest;
+	if(initQueue(&ingest.buffers, INGEST_BUFFERS) == 0 ||
+			initQueue(&ingest.freeBuffers, INGEST_BUFFERS) == 0 ||
+			initQueue(&ingest.batches, INGEST_BATCHES) == 0 ||
+			initQueue(&ingest.freeBatches, INGEST_BATCHES) == 0) {
+		destroyIngest(&ingest);
+		return 0;
+	}
+	for(i = 0; i < INGEST_BUFFERS + INGEST_BATCHES; i++) {
+		item = (i < INGEST_BUFFERS) ? malloc(sizeof(IngestBuffer)) :
+				malloc(sizeof(IngestBatch));
+		if(item == NULL) {
+			printf("Not enough memory\n");
+			destroyIngest(&ingest);
+			return 0;
+		}
+		putQueue((i < INGEST_BUFFERS) ? &ingest.freeBuffers :
+				&ingest.freeBatches, item);
+	}
+
+	if(pthread_create(&reader, NULL, readStage, &ingest) != 0) {
+		destroyIngest(&ingest);
+		return 0;
+	}
+	if(pthread_create(&tokenizer, NULL, tokenizeStage, &ingest) != 0) {
+		//without a second thread, the words go straight to the tree
+		threads = 0;
+		ingest.emit = insertWord;
+		ingest.context = tree;
+		tokenizeStage(&ingest);
+	}
+
+	//the calling thread is the inserter
+	while((batch = (IngestBatch*)getQueue(&ingest.batches)) != NULL) {
+		for(i = 0; i < batch->size; i++) {
+			insert(tree, batch->tokens[i].word, &batch->tokens[i].posting);
+		}
+		putQueue(&ingest.freeBatches, batch);
+	}
+	pthread_join(reader, NULL);
+	if(threads) {
+		pthread_join(tokenizer, NULL);
+	}
+	destroyIngest(&ingest);
+	return 1;
+}
+
+/*
+ * Name function: ingestCorpus
+ * Return: the memory address of the tree
+ * Arguments: the files that I read from and their number
+ * Purpose: the same tree as buildTreeFromCorpus, built by the pipeline
+ */
+TTree* ingestCorpus(char** fileNames, int count) {
+	TTree *tree = createWordTree();
+	if(tree == NULL) {
+		return NULL;
+	}
+	if(ingestIntoTree(tree, fileNames, count) == 0) {
+		destroyTree(tree);
+		return NULL;
+	}
+	return tree;
+}
+
+#endif /* INGEST_H_ */
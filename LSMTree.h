@@ -0,0 +1,914 @@
+#ifndef LSMTREE_H_
+#define LSMTREE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "Dictionary.h"
+
+/*
+ * An index that can be bigger than the memory. The words go in a tree, the
+ * memtable; when it has the number of words of its limit, it is written to a
+ * file as a sorted run and a new memtable is started. A run never changes:
+ * the file has its postings, then its table of keys (every key with the index
+ * of its first posting) and a Bloom filter of its keys, and only the filter
+ * and every LSM_INDEX_STEP-th key of the table are kept in memory.
+ * The runs are tiered: a flush makes a run of tier 0, and LSM_FANOUT runs of
+ * the same tier that are next to each other are merged into one run of the
+ * tier above, by a compaction thread or at the end of the flush.
+ * The runs are kept from the oldest to the newest and a query merges them and
+ * the memtable key by key, so the postings of a key stay in the order they
+ * were inserted in and the results are the ones of a single tree.
+ */
+#define LSM_MEMTABLE 65536
+#define LSM_FANOUT 4
+#define LSM_INDEX_STEP 64
+#define LSM_BLOOM_BITS 10
+#define LSM_BLOOM_HASHES 7
+#define LSM_KEY (ELEMENT_TREE_LENGTH + 1)
+#define LSM_NAME 4096
+
+typedef struct RunKey{
+	char key[LSM_KEY];
+	//the index of its first posting
+	long start;
+}RunKey;
+
+typedef struct RunHeader{
+	long keys;
+	long postings;
+	long bloomBits;
+}RunHeader;
+
+typedef struct SortedRun{
+	char fileName[LSM_NAME];
+	FILE *file;
+	int tier;
+	RunHeader header;
+	unsigned char *bloom;
+	//the keys LSM_INDEX_STEP * i of the table
+	RunKey *samples;
+	struct SortedRun *next;
+}SortedRun;
+
+typedef struct RunWriter{
+	FILE *out;
+	RunKey *keys;
+	long size, capacity;
+	long postings;
+}RunWriter;
+
+typedef struct RunCursor{
+	SortedRun *run;
+	FILE *file;
+	//the position of a key in the table and the piece of the table around it;
+	//one more key is read, for the end of the postings of the last one
+	long position;
+	RunKey chunk[LSM_INDEX_STEP + 1];
+	long chunkStart;
+}RunCursor;
+
+typedef struct LSMTree{
+	//shorter than LSM_NAME, so there is room for the name of a run
+	char directory[LSM_NAME - 32];
+	TTree *memtable;
+	long limit;
+	//from the oldest to the newest
+	SortedRun *runs;
+	long nextRun;
+	//the runs that lookups read and the ones their Bloom filters skipped
+	long probes, skips;
+	int background, stop;
+	pthread_t compactor;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+}LSMTree;
+
+/*
+ * Name function: bloomBit
+ * Return: the bit of a key for one of the hash functions
+ * Arguments: the key, the number of the hash function and the number of bits
+ * Purpose: double hashing, h1 + i * h2, from the two halves of one hash
+ */
+long bloomBit(char* key, int i, long bits) {
+	unsigned long hash = hashStrElement(key);
+	return (long)((hash + i * ((hash >> 32) | 1)) % bits);
+}
+
+/*
+ * Name function: bloomAdd
+ * Return: void (it does not return a value)
+ * Arguments: the filter, its number of bits and a key
+ * Purpose: set the bits of a key
+ */
+void bloomAdd(unsigned char* bloom, long bits, char* key) {
+	long bit;
+	int i;
+	for(i = 0; i < LSM_BLOOM_HASHES; i++) {
+		bit = bloomBit(key, i, bits);
+		bloom[bit / 8] |= 1 << (bit % 8);
+	}
+}
+
+/*
+ * Name function: bloomMayContain
+ * Return: 0 if the key is surely not in the run, 1 otherwise
+ * Arguments: the filter, its number of bits and a key
+ * Purpose: skip the runs that don't have a key without reading them
+ */
+int bloomMayContain(unsigned char* bloom, long bits, char* key) {
+	long bit;
+	int i;
+	for(i = 0; i < LSM_BLOOM_HASHES; i++) {
+		bit = bloomBit(key, i, bits);
+		if((bloom[bit / 8] & (1 << (bit % 8))) == 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Name function: readRun
+ * Return: 1 if everything was read, 0 otherwise
+ * Arguments: a file, an offset, a buffer and the number of bytes
+ * Purpose: read a piece of a run
+ */
+int readRun(FILE* file, long offset, void* buffer, long size) {
+	return fseek(file, offset, SEEK_SET) == 0 &&
+			fread(buffer, 1, size, file) == (size_t)size;
+}
+
+/*
+ * Name function: runTableOffset
+ * Return: the offset of the table of keys in the file of a run
+ * Arguments: the run
+ * Purpose: the table is after the header and the postings
+ */
+long runTableOffset(SortedRun* run) {
+	return sizeof(RunHeader) + run->header.postings * sizeof(Posting);
+}
+
+/*
+ * Name function: destroyRun
+ * Return: void (it does not return a value)
+ * Arguments: the run and whether its file is erased
+ * Purpose: close a run and free its memory
+ */
+void destroyRun(SortedRun* run, int erase) {
+	if(run == NULL) {
+		return;
+	}
+	if(run->file != NULL) {
+		fclose(run->file);
+	}
+	if(erase) {
+		remove(run->fileName);
+	}
+	free(run->bloom);
+	free(run->samples);
+	free(run);
+}
+
+/*
+ * Name function: openRun
+ * Return: the memory address of the run, NULL if it can't be read
+ * Arguments: the file of the run and its tier
+ * Purpose: read the header, the Bloom filter and the sampled keys of a run
+ */
+SortedRun* openRun(char* fileName, int tier) {
+	SortedRun *run = (SortedRun*)calloc(1, sizeof(SortedRun));
+	long i, samples, bloomOffset;
+
+	if(run == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	strncpy(run->fileName, fileName, LSM_NAME - 1);
+	run->tier = tier;
+	run->file = fopen(fileName, "rb");
+	if(run->file == NULL ||
+			!readRun(run->file, 0, &run->header, sizeof(RunHeader))) {
+		printf("ERROR: Can't open file %s\n", fileName);
+		destroyRun(run, 0);
+		return NULL;
+	}
+	samples = (run->header.keys + LSM_INDEX_STEP - 1) / LSM_INDEX_STEP;
+	run->bloom = (unsigned char*)malloc(run->header.bloomBits / 8);
+	run->samples = (RunKey*)malloc(sizeof(RunKey) * (samples + 1));
+	if(run->bloom == NULL || run->samples == NULL) {
+		printf("Not enough memory\n");
+		destroyRun(run, 0);
+		return NULL;
+	}
+	bloomOffset = runTableOffset(run) + (run->header.keys + 1) * sizeof(RunKey);
+	if(!readRun(run->file, bloomOffset, run->bloom, run->header.bloomBits / 8)) {
+		printf("ERROR: Can't open file %s\n", fileName);
+		destroyRun(run, 0);
+		return NULL;
+	}
+	for(i = 0; i < samples; i++) {
+		if(!readRun(run->file, runTableOffset(run) +
+				i * LSM_INDEX_STEP * sizeof(RunKey), &run->samples[i],
+				sizeof(RunKey))) {
+			printf("ERROR: Can't open file %s\n", fileName);
+			destroyRun(run, 0);
+			return NULL;
+		}
+	}
+	return run;
+}
+
+/*
+ * Name function: runName
+ * Return: void (it does not return a value)
+ * Arguments: the index and the place where the name is written
+ * Purpose: the name of the next run in the directory of the index
+ */
+void runName(LSMTree* lsm, char* fileName) {
+	pthread_mutex_lock(&lsm->lock);
+	snprintf(fileName, LSM_NAME, "%s/run-%ld.lsm", lsm->directory,
+			lsm->nextRun++);
+	pthread_mutex_unlock(&lsm->lock);
+}
+
+/*
+ * Name function: openRunWriter
+ * Return: 1 if the file was created, 0 otherwise
+ * Arguments: the index, the writer and the place where the name of the new
+ * run is written
+ * Purpose: start a run in a new file; the header is written at the end
+ */
+int openRunWriter(LSMTree* lsm, RunWriter* writer, char* fileName) {
+	RunHeader header = {0, 0, 0};
+	memset(writer, 0, sizeof(RunWriter));
+	//"x" never opens a file that exists: a name taken by another index in the
+	//same directory, or by a run left there before, is skipped
+	do {
+		runName(lsm, fileName);
+		writer->out = fopen(fileName, "wbx");
+	} while(writer->out == NULL && errno == EEXIST);
+	if(writer->out == NULL) {
+		printf("ERROR: Can't open file %s\n", fileName);
+		return 0;
+	}
+	fwrite(&header, sizeof(RunHeader), 1, writer->out);
+	return 1;
+}
+
+/*
+ * Name function: runWriterAdd
+ * Return: 1 if the posting was added, 0 otherwise
+ * Arguments: the writer, a key and one of its postings
+ * Purpose: add the postings of a run in the order of the keys; a key that is
+ * new gets an entry in the table
+ */
+int runWriterAdd(RunWriter* writer, char* key, Posting* posting) {
+	Posting copy;
+	if(writer->size == 0 || strcmp(writer->keys[writer->size - 1].key, key)) {
+		if(writer->size == writer->capacity) {
+			long capacity = writer->capacity ? writer->capacity * 2 : BUFLEN;
+			RunKey *keys = (RunKey*)realloc(writer->keys,
+					sizeof(RunKey) * (capacity + 1));
+			if(keys == NULL) {
+				printf("Not enough memory\n");
+				return 0;
+			}
+			writer->keys = keys;
+			writer->capacity = capacity;
+		}
+		//the padding is written too, so it is cleared
+		memset(&writer->keys[writer->size], 0, sizeof(RunKey));
+		strncpy(writer->keys[writer->size].key, key, LSM_KEY - 1);
+		writer->keys[writer->size++].start = writer->postings;
+	}
+	memset(&copy, 0, sizeof(Posting));
+	copy.offset = posting->offset;
+	copy.doc = posting->doc;
+	copy.position = posting->position;
+	fwrite(&copy, sizeof(Posting), 1, writer->out);
+	writer->postings++;
+	return 1;
+}
+
+/*
+ * Name function: finishRun
+ * Return: the memory address of the new run, NULL if it can't be written
+ * Arguments: the writer, the file of the run and its tier
+ * Purpose: write the table of keys, the Bloom filter and the header of a run
+ * and open it
+ */
+SortedRun* finishRun(RunWriter* writer, char* fileName, int tier) {
+	RunHeader header = {writer->size, writer->postings, 0};
+	unsigned char *bloom;
+	RunKey last;
+	long i;
+	int failed;
+
+	//a filter of at least one byte, in whole bytes
+	header.bloomBits = (MAX(writer->size * LSM_BLOOM_BITS, 8) + 7) / 8 * 8;
+	bloom = (unsigned char*)calloc(header.bloomBits / 8, 1);
+	if(bloom == NULL) {
+		printf("Not enough memory\n");
+		fclose(writer->out);
+		free(writer->keys);
+		remove(fileName);
+		return NULL;
+	}
+	for(i = 0; i < writer->size; i++) {
+		bloomAdd(bloom, header.bloomBits, writer->keys[i].key);
+	}
+	//the table ends with the end of the postings of the last key
+	memset(&last, 0, sizeof(RunKey));
+	last.start = writer->postings;
+	if(writer->size > 0) {
+		fwrite(writer->keys, sizeof(RunKey), writer->size, writer->out);
+	}
+	fwrite(&last, sizeof(RunKey), 1, writer->out);
+	fwrite(bloom, 1, header.bloomBits / 8, writer->out);
+	fseek(writer->out, 0, SEEK_SET);
+	fwrite(&header, sizeof(RunHeader), 1, writer->out);
+	failed = ferror(writer->out);
+	failed |= fclose(writer->out) != 0;
+	free(writer->keys);
+	free(bloom);
+	if(failed) {
+		printf("ERROR: Can't write file %s\n", fileName);
+		remove(fileName);
+		return NULL;
+	}
+	return openRun(fileName, tier);
+}
+
+/*
+ * Name function: loadChunk
+ * Return: 1 if the keys were read, 0 otherwise
+ * Arguments: a cursor and a position of the table
+ * Purpose: read the piece of the table that has a position
+ */
+int loadChunk(RunCursor* cursor, long position) {
+	SortedRun *run = cursor->run;
+	long count;
+	cursor->chunkStart = position - position % LSM_INDEX_STEP;
+	count = MIN(LSM_INDEX_STEP + 1, run->header.keys + 1 - cursor->chunkStart);
+	if(!readRun(cursor->file, runTableOffset(run) +
+			cursor->chunkStart * sizeof(RunKey), cursor->chunk,
+			count * sizeof(RunKey))) {
+		printf("ERROR: Can't read file %s\n", run->fileName);
+		//the cursor ends, like at the end of the run
+		cursor->position = run->header.keys;
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Name function: runKey
+ * Return: the key of a cursor, NULL at the end of its run
+ * Arguments: the cursor
+ * Purpose: the key that the merge compares
+ */
+char* runKey(RunCursor* cursor) {
+	if(cursor->position >= cursor->run->header.keys) {
+		return NULL;
+	}
+	return cursor->chunk[cursor->position - cursor->chunkStart].key;
+}
+
+/*
+ * Name function: runSeek
+ * Return: void (it does not return a value)
+ * Arguments: a cursor, its run, the file it reads and a key
+ * Purpose: put a cursor on the first key >= key; a binary search on the
+ * sampled keys finds the piece of the table that is read
+ */
+void runSeek(RunCursor* cursor, SortedRun* run, FILE* file, char* key) {
+	long low = 0, high = (run->header.keys + LSM_INDEX_STEP - 1) /
+			LSM_INDEX_STEP, middle, i;
+
+	cursor->run = run;
+	cursor->file = file;
+	cursor->position = run->header.keys;
+	while(low < high) {
+		middle = (low + high) / 2;
+		if(strcmp(run->samples[middle].key, key) >= 0) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+	if(low == 0) {
+		//every key of the run is >= key
+		if(run->header.keys > 0 && loadChunk(cursor, 0)) {
+			cursor->position = 0;
+		}
+		return;
+	}
+	//the first key of piece low - 1 is before key, the answer is after it
+	if(!loadChunk(cursor, (low - 1) * LSM_INDEX_STEP)) {
+		return;
+	}
+	for(i = (low - 1) * LSM_INDEX_STEP + 1;
+			i < MIN(low * LSM_INDEX_STEP, run->header.keys); i++) {
+		if(strcmp(cursor->chunk[i - cursor->chunkStart].key, key) >= 0) {
+			cursor->position = i;
+			return;
+		}
+	}
+	if(i < run->header.keys && loadChunk(cursor, i)) {
+		cursor->position = i;
+	}
+}
+
+/*
+ * Name function: runAdvance
+ * Return: void (it does not return a value)
+ * Arguments: a cursor
+ * Purpose: move to the next key of the run, reading the next piece of the
+ * table when needed
+ */
+void runAdvance(RunCursor* cursor) {
+	cursor->position++;
+	if(cursor->position < cursor->run->header.keys &&
+			cursor->position - cursor->chunkStart == LSM_INDEX_STEP) {
+		loadChunk(cursor, cursor->position);
+	}
+}
+
+/*
+ * Name function: runPostings
+ * Return: void (it does not return a value)
+ * Arguments: a cursor, the words and the writer of a merged run (one of them
+ * is NULL)
+ * Purpose: read the postings of the key of a cursor, BUFLEN at a time, into
+ * a range or a new run
+ */
+void runPostings(RunCursor* cursor, Range* words, RunWriter* writer) {
+	Posting buffer[BUFLEN];
+	long i = cursor->position - cursor->chunkStart;
+	long first = cursor->chunk[i].start, last = cursor->chunk[i + 1].start, j, n;
+	char *key = cursor->chunk[i].key;
+
+	for(; first < last; first += n) {
+		n = MIN(last - first, BUFLEN);
+		if(!readRun(cursor->file, sizeof(RunHeader) + first * sizeof(Posting),
+				buffer, n * sizeof(Posting))) {
+			printf("ERROR: Can't read file %s\n", cursor->run->fileName);
+			return;
+		}
+		for(j = 0; j < n; j++) {
+			if(words != NULL) {
+				addToRange(words, &buffer[j]);
+			} else {
+				runWriterAdd(writer, key, &buffer[j]);
+			}
+		}
+	}
+}
+
+/*
+ * Name function: findGroup
+ * Return: the oldest run of the oldest LSM_FANOUT runs of the same tier that
+ * are next to each other, NULL if there are none
+ * Arguments: the index (locked)
+ * Purpose: choose the runs that the next compaction merges
+ */
+SortedRun* findGroup(LSMTree* lsm) {
+	SortedRun *first = lsm->runs, *run;
+	int length = 0;
+	for(run = lsm->runs; run != NULL; run = run->next) {
+		if(run->tier != first->tier) {
+			first = run;
+			length = 0;
+		}
+		if(++length == LSM_FANOUT) {
+			return first;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Name function: compactGroup
+ * Return: 1 if the runs were merged, 0 otherwise
+ * Arguments: the index (not locked) and the first run of a group
+ * Purpose: merge LSM_FANOUT runs into one run of the tier above and put it in
+ * their place; the runs don't change, so only the swap is locked
+ */
+int compactGroup(LSMTree* lsm, SortedRun* first) {
+	RunCursor *cursors = (RunCursor*)malloc(sizeof(RunCursor) * LSM_FANOUT);
+	char fileName[LSM_NAME], key[LSM_KEY], *next;
+	SortedRun *run, *merged = NULL, **link;
+	RunWriter writer;
+	int i, opened = 0;
+
+	if(cursors == NULL || !openRunWriter(lsm, &writer, fileName)) {
+		if(cursors == NULL) {
+			printf("Not enough memory\n");
+		}
+		free(cursors);
+		return 0;
+	}
+	//the merge reads with its own files, so the queries can go on; a flush
+	//can link a run after the last run of the group, so its next is not read
+	for(run = first; ; run = run->next) {
+		FILE *file = fopen(run->fileName, "rb");
+		if(file == NULL) {
+			printf("ERROR: Can't open file %s\n", run->fileName);
+			break;
+		}
+		runSeek(&cursors[opened++], run, file, "");
+		if(opened == LSM_FANOUT) {
+			break;
+		}
+	}
+	while(opened == LSM_FANOUT) {
+		next = NULL;
+		for(i = 0; i < LSM_FANOUT; i++) {
+			if(runKey(&cursors[i]) != NULL &&
+					(next == NULL || strcmp(runKey(&cursors[i]), next) < 0)) {
+				next = runKey(&cursors[i]);
+			}
+		}
+		if(next == NULL) {
+			break;
+		}
+		strcpy(key, next);
+		//the runs are from the oldest, so the postings of a key stay in order
+		for(i = 0; i < LSM_FANOUT; i++) {
+			if(runKey(&cursors[i]) != NULL &&
+					strcmp(runKey(&cursors[i]), key) == 0) {
+				runPostings(&cursors[i], NULL, &writer);
+				runAdvance(&cursors[i]);
+			}
+		}
+	}
+	if(opened == LSM_FANOUT) {
+		merged = finishRun(&writer, fileName, first->tier + 1);
+	} else {
+		fclose(writer.out);
+		free(writer.keys);
+		remove(fileName);
+	}
+	for(i = 0; i < opened; i++) {
+		fclose(cursors[i].file);
+	}
+	free(cursors);
+	if(merged == NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&lsm->lock);
+	for(link = &lsm->runs; *link != first; link = &(*link)->next);
+	for(run = first, i = 1; i < LSM_FANOUT; i++, run = run->next);
+	merged->next = run->next;
+	run->next = NULL;
+	*link = merged;
+	pthread_mutex_unlock(&lsm->lock);
+	//no query sees the old runs any more
+	while(first != NULL) {
+		run = first->next;
+		destroyRun(first, 1);
+		first = run;
+	}
+	return 1;
+}
+
+/*
+ * Name function: compactRuns
+ * Return: void (it does not return a value)
+ * Arguments: the index
+ * Purpose: merge groups of runs until there are no LSM_FANOUT runs of a tier
+ * next to each other
+ */
+void compactRuns(LSMTree* lsm) {
+	SortedRun *first;
+	while(1) {
+		pthread_mutex_lock(&lsm->lock);
+		first = findGroup(lsm);
+		pthread_mutex_unlock(&lsm->lock);
+		if(first == NULL || !compactGroup(lsm, first)) {
+			return;
+		}
+	}
+}
+
+/*
+ * Name function: compactWorker
+ * Return: NULL
+ * Arguments: the index
+ * Purpose: the compaction thread: wait for a flush that makes a group, merge
+ * it, until the index is destroyed
+ */
+void* compactWorker(void* argument) {
+	LSMTree *lsm = (LSMTree*)argument;
+	SortedRun *first;
+
+	pthread_mutex_lock(&lsm->lock);
+	while(1) {
+		while(lsm->stop == 0 && (first = findGroup(lsm)) == NULL) {
+			pthread_cond_wait(&lsm->wake, &lsm->lock);
+		}
+		if(lsm->stop) {
+			pthread_mutex_unlock(&lsm->lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&lsm->lock);
+		if(!compactGroup(lsm, first)) {
+			//a run that can't be merged stays as it is until the next flush,
+			//unless the index is destroyed in the meantime
+			pthread_mutex_lock(&lsm->lock);
+			if(lsm->stop == 0) {
+				pthread_cond_wait(&lsm->wake, &lsm->lock);
+			}
+			continue;
+		}
+		pthread_mutex_lock(&lsm->lock);
+	}
+}
+
+/*
+ * Name function: createLSMTree
+ * Return: the memory address of the index
+ * Arguments: the directory of the runs, the number of words of the memtable
+ * (0 for LSM_MEMTABLE) and whether the runs are merged by a thread
+ * Purpose: start an empty index
+ */
+LSMTree* createLSMTree(char* directory, long limit, int background) {
+	LSMTree *lsm = (LSMTree*)calloc(1, sizeof(LSMTree));
+	if(lsm == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	strncpy(lsm->directory, directory, sizeof(lsm->directory) - 1);
+	lsm->limit = (limit > 0) ? limit : LSM_MEMTABLE;
+	lsm->memtable = createTree(createStrElement, destroyStrElement,
+			createIndexInfo, destroyIndexInfo, compareStrElem);
+	if(lsm->memtable == NULL) {
+		printf("Not enough memory\n");
+		free(lsm);
+		return NULL;
+	}
+	pthread_mutex_init(&lsm->lock, NULL);
+	pthread_cond_init(&lsm->wake, NULL);
+	if(background) {
+		lsm->background = pthread_create(&lsm->compactor, NULL, compactWorker,
+				lsm) == 0;
+	}
+	return lsm;
+}
+
+/*
+ * Name function: destroyLSMTree
+ * Return: void (it does not return a value)
+ * Arguments: the index
+ * Purpose: stop the compaction thread, erase the runs and free the index
+ */
+void destroyLSMTree(LSMTree* lsm) {
+	SortedRun *run;
+	if(lsm == NULL) {
+		return;
+	}
+	if(lsm->background) {
+		pthread_mutex_lock(&lsm->lock);
+		lsm->stop = 1;
+		pthread_cond_signal(&lsm->wake);
+		pthread_mutex_unlock(&lsm->lock);
+		pthread_join(lsm->compactor, NULL);
+	}
+	while(lsm->runs != NULL) {
+		run = lsm->runs->next;
+		destroyRun(lsm->runs, 1);
+		lsm->runs = run;
+	}
+	destroyTree(lsm->memtable);
+	pthread_mutex_destroy(&lsm->lock);
+	pthread_cond_destroy(&lsm->wake);
+	free(lsm);
+}
+
+/*
+ * Name function: flushMemtable
+ * Return: 1 if the memtable was written, 0 otherwise
+ * Arguments: the index
+ * Purpose: write the memtable as the newest run of tier 0 and start a new one;
+ * the runs are then merged by the thread or before returning
+ */
+int flushMemtable(LSMTree* lsm) {
+	char fileName[LSM_NAME];
+	TreeNode *node, *copy;
+	SortedRun *run, **link;
+	RunWriter writer;
+	TTree *memtable;
+
+	if(lsm->memtable->size == 0) {
+		return 1;
+	}
+	memtable = createTree(createStrElement, destroyStrElement,
+			createIndexInfo, destroyIndexInfo, compareStrElem);
+	if(memtable == NULL || !openRunWriter(lsm, &writer, fileName)) {
+		if(memtable == NULL) {
+			printf("Not enough memory\n");
+		}
+		destroyTree(memtable);
+		return 0;
+	}
+	//the keys deleted by lazyDelete are left out
+	for(node = minimum(lsm->memtable, lsm->memtable->root); node != NULL;
+			node = node->end->next) {
+		for(copy = node; !TOMBSTONE(node) && copy != node->end->next;
+				copy = copy->next) {
+			runWriterAdd(&writer, node->elem, (Posting*)copy->info);
+		}
+	}
+	run = finishRun(&writer, fileName, 0);
+	if(run == NULL) {
+		destroyTree(memtable);
+		return 0;
+	}
+
+	pthread_mutex_lock(&lsm->lock);
+	for(link = &lsm->runs; *link != NULL; link = &(*link)->next);
+	*link = run;
+	destroyTree(lsm->memtable);
+	lsm->memtable = memtable;
+	pthread_cond_signal(&lsm->wake);
+	pthread_mutex_unlock(&lsm->lock);
+	if(!lsm->background) {
+		compactRuns(lsm);
+	}
+	return 1;
+}
+
+/*
+ * Name function: lsmInsert
+ * Return: void (it does not return a value)
+ * Arguments: the index, a word and its posting
+ * Purpose: insert a word in the memtable and flush it when it is full
+ */
+void lsmInsert(LSMTree* lsm, char* word, Posting* posting) {
+	insert(lsm->memtable, word, posting);
+	if(lsm->memtable->size >= lsm->limit) {
+		flushMemtable(lsm);
+	}
+}
+
+/*
+ * Name function: insertLSMWord
+ * Return: void (it does not return a value)
+ * Arguments: the index (as the context of a tokenizer), the word and its
+ * posting
+ * Purpose: add a word found by a tokenizer into the index
+ */
+void insertLSMWord(void* lsm, char* word, Posting* posting) {
+	lsmInsert((LSMTree*)lsm, word, posting);
+}
+
+/*
+ * Name function: lsmAddFile
+ * Return: 1 if the file was indexed, 0 otherwise
+ * Arguments: the index, the file that I read from and the id of the document
+ * Purpose: insert the words of a file in the index, like addFileToTree
+ */
+int lsmAddFile(LSMTree* lsm, char* fileName, int doc) {
+	Tokenizer tokenizer;
+	long size;
+	char *buffer = readFile(fileName, &size);
+	if(buffer == NULL) {
+		return 0;
+	}
+	initTokenizer(&tokenizer, doc, insertLSMWord, lsm);
+	tokenize(&tokenizer, buffer, size, 0);
+	finishTokenizer(&tokenizer);
+	free(buffer);
+	return 1;
+}
+
+/*
+ * Name function: lsmWalk
+ * Return: the memory address of the words
+ * Arguments: the index, the string q and the string p (NULL for a prefix
+ * query)
+ * Purpose: a k-way merge of the runs and the memtable from the first key
+ * >= q, while the keys start with q (or are not after p); for every key, the
+ * postings of the older runs come first
+ */
+Range* lsmWalk(LSMTree* lsm, char* q, char* p) {
+	Range *words = createRange();
+	RunCursor *cursors = NULL;
+	char key[LSM_KEY], *next;
+	int lengthQ = strlen(q), lengthP = p ? strlen(p) : 0, n = 0, i;
+	SortedRun *run;
+	TreeNode *node;
+
+	if(words == NULL) {
+		return NULL;
+	}
+	pthread_mutex_lock(&lsm->lock);
+	for(run = lsm->runs; run != NULL; run = run->next) {
+		n++;
+	}
+	cursors = (RunCursor*)malloc(sizeof(RunCursor) * (n + 1));
+	if(cursors == NULL) {
+		printf("Not enough memory\n");
+		pthread_mutex_unlock(&lsm->lock);
+		return words;
+	}
+	for(run = lsm->runs, i = 0; run != NULL; run = run->next, i++) {
+		runSeek(&cursors[i], run, run->file, q);
+	}
+	node = lowerBoundNode(lsm->memtable, q);
+	while(1) {
+		next = NULL;
+		for(i = 0; i < n; i++) {
+			if(runKey(&cursors[i]) != NULL &&
+					(next == NULL || strcmp(runKey(&cursors[i]), next) < 0)) {
+				next = runKey(&cursors[i]);
+			}
+		}
+		if(node != NULL && (next == NULL || strcmp(node->elem, next) < 0)) {
+			next = node->elem;
+		}
+		if(next == NULL || (p == NULL ? strncmp(next, q, lengthQ) != 0 :
+				strncmp(p, next, lengthP) < 0)) {
+			break;
+		}
+		strcpy(key, next);
+		for(i = 0; i < n; i++) {
+			if(runKey(&cursors[i]) != NULL &&
+					strcmp(runKey(&cursors[i]), key) == 0) {
+				runPostings(&cursors[i], words, NULL);
+				runAdvance(&cursors[i]);
+			}
+		}
+		if(node != NULL && strcmp(node->elem, key) == 0) {
+			node = liveHead(walkKey(node, NULL, words));
+		}
+	}
+	pthread_mutex_unlock(&lsm->lock);
+	free(cursors);
+	return words;
+}
+
+/*
+ * Name function: lsmPrefixQuery
+ * Return: the memory address of the words
+ * Arguments: the index and the given string
+ * Purpose: the same words as singleKeyRangeQuery on a tree of every word
+ */
+Range* lsmPrefixQuery(LSMTree* lsm, char* q) {
+	return lsmWalk(lsm, q, NULL);
+}
+
+/*
+ * Name function: lsmIntervalQuery
+ * Return: the memory address of the words
+ * Arguments: the index and the two strings q, p
+ * Purpose: the same words as multiKeyRangeQuery on a tree of every word
+ */
+Range* lsmIntervalQuery(LSMTree* lsm, char* q, char* p) {
+	return lsmWalk(lsm, q, p);
+}
+
+/*
+ * Name function: lsmLookup
+ * Return: the memory address of the words
+ * Arguments: the index and a word
+ * Purpose: find the words with the same key as a word; the runs whose Bloom
+ * filter doesn't have the key are not read
+ */
+Range* lsmLookup(LSMTree* lsm, char* word) {
+	Range *words = createRange();
+	char key[LSM_KEY] = "";
+	RunCursor cursor;
+	SortedRun *run;
+	TreeNode *node;
+
+	if(words == NULL) {
+		return NULL;
+	}
+	strncat(key, word, ELEMENT_TREE_LENGTH);
+	pthread_mutex_lock(&lsm->lock);
+	for(run = lsm->runs; run != NULL; run = run->next) {
+		if(!bloomMayContain(run->bloom, run->header.bloomBits, key)) {
+			lsm->skips++;
+			continue;
+		}
+		lsm->probes++;
+		runSeek(&cursor, run, run->file, key);
+		if(runKey(&cursor) != NULL && strcmp(runKey(&cursor), key) == 0) {
+			runPostings(&cursor, words, NULL);
+		}
+	}
+	node = search(lsm->memtable, lsm->memtable->root, key);
+	if(node != NULL) {
+		walkKey(node, NULL, words);
+	}
+	pthread_mutex_unlock(&lsm->lock);
+	return words;
+}
+
+#endif /* LSMTREE_H_ */
@@ -0,0 +1,388 @@
+#ifndef PARALLELQUERY_H_
+#define PARALLELQUERY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "Dictionary.h"
+
+/*
+ * A range query split between threads. The interval is cut along the tree:
+ * a task is a subtree (with what is known about its bounds) or the list of
+ * duplicates of one key. A subtree that is not entirely inside the interval,
+ * or that is too high, is split in its left subtree, its key and its right
+ * subtree, which become new tasks. Every worker keeps its tasks in its own
+ * deque and takes the newest one; a worker without tasks steals the oldest
+ * task of another one, which is the biggest. The hits go in a buffer of the
+ * worker and every task remembers its slice, so the tree of tasks gives the
+ * slices back in key order.
+ */
+#define PARALLEL_GRAIN 8
+#define TASK_SUBTREE 0
+#define TASK_CHAIN 1
+
+typedef struct RangeTask{
+	int type;
+	TreeNode *node;
+	//whether every key of the subtree is known to be >= q / <= p
+	int low, high;
+	//the slice [begin, end) of the buffer of a worker
+	int worker;
+	int begin, end;
+	struct RangeTask *parts[3];
+}RangeTask;
+
+typedef struct TaskDeque{
+	RangeTask **tasks;
+	int first, last, capacity;
+	pthread_mutex_t lock;
+}TaskDeque;
+
+typedef struct ParallelRange{
+	TTree *tree;
+	char *q, *p;
+	int lengthP;
+	int workers;
+	TaskDeque *deques;
+	Range **buffers;
+	//tasks that were created and not finished yet
+	long pending;
+}ParallelRange;
+
+typedef struct RangeWorker{
+	ParallelRange *range;
+	int id;
+}RangeWorker;
+
+/*
+ * Name function: createRangeTask
+ * Return: the memory address of the task
+ * Arguments: its type, node and bounds
+ * Purpose: allocate a task
+ */
+RangeTask* createRangeTask(int type, TreeNode* node, int low, int high) {
+	RangeTask *task = (RangeTask*)calloc(1, sizeof(RangeTask));
+	if(task == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	task->type = type;
+	task->node = node;
+	task->low = low;
+	task->high = high;
+	return task;
+}
+
+/*
+ * Name function: pushTask
+ * Return: 1 if the task was added, 0 otherwise
+ * Arguments: a deque and a task
+ * Purpose: add a task at the end of a deque, where its owner takes it from
+ */
+int pushTask(TaskDeque* deque, RangeTask* task) {
+	pthread_mutex_lock(&deque->lock);
+	if(deque->last == deque->capacity) {
+		//move the tasks to the start before growing
+		int size = deque->last - deque->first;
+		int capacity = (size * 2 > deque->capacity) ? deque->capacity * 2 :
+				deque->capacity;
+		if(capacity == 0) {
+			capacity = BUFLEN;
+		}
+		RangeTask **tasks = (RangeTask**)malloc(sizeof(RangeTask*) * capacity);
+		if(tasks == NULL) {
+			pthread_mutex_unlock(&deque->lock);
+			printf("Not enough memory\n");
+			return 0;
+		}
+		memcpy(tasks, deque->tasks + deque->first, sizeof(RangeTask*) * size);
+		free(deque->tasks);
+		deque->tasks = tasks;
+		deque->first = 0;
+		deque->last = size;
+		deque->capacity = capacity;
+	}
+	deque->tasks[deque->last++] = task;
+	pthread_mutex_unlock(&deque->lock);
+	return 1;
+}
+
+/*
+ * Name function: takeTask
+ * Return: a task, NULL if the deque is empty
+ * Arguments: a deque and whether the task is stolen
+ * Purpose: the owner takes the newest task (the smallest, still in its cache),
+ * a thief takes the oldest one (the biggest)
+ */
+RangeTask* takeTask(TaskDeque* deque, int steal) {
+	RangeTask *task = NULL;
+	pthread_mutex_lock(&deque->lock);
+	if(deque->first < deque->last) {
+		task = steal ? deque->tasks[deque->first++] :
+				deque->tasks[--deque->last];
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return task;
+}
+
+/*
+ * Name function: addTask
+ * Return: void (it does not return a value)
+ * Arguments: the query, the worker, the task that is split, the index of
+ * the part and the new task
+ * Purpose: make a new task a part of another one and give it to the worker
+ */
+void addTask(ParallelRange* range, int id, RangeTask* parent, int i,
+		RangeTask* task) {
+	if(task == NULL) {
+		return;
+	}
+	parent->parts[i] = task;
+	__sync_fetch_and_add(&range->pending, 1);
+	if(pushTask(&range->deques[id], task) == 0) {
+		free(task);
+		parent->parts[i] = NULL;
+		__sync_fetch_and_sub(&range->pending, 1);
+	}
+}
+
+/*
+ * Name function: walkTask
+ * Return: void (it does not return a value)
+ * Arguments: the list from the first node of a key to the last copy of a key
+ * and the buffer of the worker
+ * Purpose: copy the postings of a piece of the list that is inside the
+ * interval, without the keys deleted by lazyDelete
+ */
+void walkTask(TreeNode* first, TreeNode* last, Range* words) {
+	TreeNode *node;
+	for(; first != NULL; first = first->end->next) {
+		if(!TOMBSTONE(first)) {
+			for(node = first; node != first->end->next; node = node->next) {
+				addToRange(words, node->info);
+			}
+		}
+		if(first->end == last) {
+			break;
+		}
+	}
+}
+
+/*
+ * Name function: runTask
+ * Return: void (it does not return a value)
+ * Arguments: the query, the worker and the task
+ * Purpose: walk a task that is small enough and inside the interval, or split
+ * it in the parts of its subtree that can hold keys of the interval
+ */
+void runTask(ParallelRange* range, int id, RangeTask* task) {
+	Range *words = range->buffers[id];
+	TreeNode *node = task->node;
+	int low, high;
+
+	task->worker = id;
+	task->begin = words->size;
+	if(task->type == TASK_CHAIN) {
+		walkTask(node, node->end, words);
+	} else if(task->low && task->high && node->height <= PARALLEL_GRAIN) {
+		walkTask(minimum(range->tree, node),
+				maximum(range->tree, node)->end, words);
+	} else {
+		low = task->low || range->tree->compare(node->elem, range->q) >= 0;
+		high = task->high ||
+				strncmp(range->p, node->elem, range->lengthP) >= 0;
+		//the right part is pushed first, so the owner goes on in key order
+		if(high && node->rt != NULL) {
+			addTask(range, id, task, 2,
+					createRangeTask(TASK_SUBTREE, node->rt, low, task->high));
+		}
+		if(low && high) {
+			addTask(range, id, task, 1,
+					createRangeTask(TASK_CHAIN, node, 1, 1));
+		}
+		if(low && node->lt != NULL) {
+			addTask(range, id, task, 0,
+					createRangeTask(TASK_SUBTREE, node->lt, task->low, high));
+		}
+	}
+	task->end = words->size;
+}
+
+/*
+ * Name function: rangeWorker
+ * Return: NULL
+ * Arguments: the worker
+ * Purpose: run the tasks of the worker, stealing from the others when it has
+ * none, until every task is finished
+ */
+void* rangeWorker(void* argument) {
+	RangeWorker *worker = (RangeWorker*)argument;
+	ParallelRange *range = worker->range;
+	RangeTask *task;
+	int i;
+
+	while(__sync_fetch_and_add(&range->pending, 0) > 0) {
+		task = takeTask(&range->deques[worker->id], 0);
+		for(i = 1; task == NULL && i < range->workers; i++) {
+			task = takeTask(&range->deques[(worker->id + i) % range->workers], 1);
+		}
+		if(task == NULL) {
+			sched_yield();
+			continue;
+		}
+		runTask(range, worker->id, task);
+		__sync_fetch_and_sub(&range->pending, 1);
+	}
+	return NULL;
+}
+
+/*
+ * Name function: gatherTasks
+ * Return: void (it does not return a value)
+ * Arguments: the query, a task and the result, big enough for every hit
+ * (NULL to only free the tasks)
+ * Purpose: copy the slices of the tasks in key order and free the tasks
+ */
+void gatherTasks(ParallelRange* range, RangeTask* task, Range* words) {
+	Range *buffer;
+	if(task == NULL) {
+		return;
+	}
+	buffer = range->buffers[task->worker];
+	gatherTasks(range, task->parts[0], words);
+	if(words != NULL) {
+		memcpy(words->index + words->size, buffer->index + task->begin,
+				sizeof(int) * (task->end - task->begin));
+		memcpy(words->doc + words->size, buffer->doc + task->begin,
+				sizeof(int) * (task->end - task->begin));
+		words->size += task->end - task->begin;
+	}
+	gatherTasks(range, task->parts[1], words);
+	gatherTasks(range, task->parts[2], words);
+	free(task);
+}
+
+/*
+ * Name function: parallelRangeQuery
+ * Return: the memory address of the words, NULL if there is not enough memory
+ * Arguments: the tree, the two strings q, p and the number of threads
+ * Purpose: the same words as multiKeyRangeQuery, found by several threads
+ */
+Range* parallelRangeQuery(TTree* tree, char* q, char* p, int threads) {
+	ParallelRange range;
+	RangeWorker *workers;
+	pthread_t *ids;
+	RangeTask *root;
+	Range *words;
+	int i, started, total = 0;
+
+	if(threads < 1) {
+		threads = 1;
+	}
+	if(tree == NULL || tree->root == NULL) {
+		return createRange();
+	}
+	range.tree = tree;
+	range.q = q;
+	range.p = p;
+	range.lengthP = strlen(p);
+	range.workers = threads;
+	range.pending = 1;
+	range.deques = (TaskDeque*)calloc(threads, sizeof(TaskDeque));
+	range.buffers = (Range**)calloc(threads, sizeof(Range*));
+	workers = (RangeWorker*)malloc(sizeof(RangeWorker) * threads);
+	ids = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+	root = createRangeTask(TASK_SUBTREE, tree->root, 0, 0);
+	words = createRange();
+	if(range.deques == NULL || range.buffers == NULL || workers == NULL ||
+			ids == NULL || root == NULL || words == NULL) {
+		printf("Not enough memory\n");
+		free(range.deques);
+		free(range.buffers);
+		free(workers);
+		free(ids);
+		free(root);
+		destroyRange(words);
+		return NULL;
+	}
+	for(i = 0; i < threads; i++) {
+		range.deques[i].capacity = BUFLEN;
+		range.deques[i].tasks = (RangeTask**)malloc(sizeof(RangeTask*) * BUFLEN);
+		if(range.deques[i].tasks == NULL) {
+			range.deques[i].capacity = 0;
+		}
+		range.buffers[i] = createRange();
+		if(range.buffers[i] == NULL) {
+			break;
+		}
+		pthread_mutex_init(&range.deques[i].lock, NULL);
+		workers[i].range = &range;
+		workers[i].id = i;
+	}
+	//go on with the workers that got a buffer
+	threads = range.workers = i;
+	if(threads == 0 || pushTask(&range.deques[0], root) == 0) {
+		range.pending = 0;
+	}
+
+	//the calling thread is worker 0
+	for(started = 1; started < threads; started++) {
+		if(pthread_create(&ids[started], NULL, rangeWorker,
+				&workers[started]) != 0) {
+			break;
+		}
+	}
+	rangeWorker(&workers[0]);
+	for(i = 1; i < started; i++) {
+		pthread_join(ids[i], NULL);
+	}
+
+	for(i = 0; i < threads; i++) {
+		total += range.buffers[i]->size;
+	}
+	if(total > words->capacity) {
+		int *index = (int*)realloc(words->index, sizeof(int) * total);
+		int *doc = (int*)realloc(words->doc, sizeof(int) * total);
+		if(index != NULL) {
+			words->index = index;
+		}
+		if(doc != NULL) {
+			words->doc = doc;
+		}
+		if(index == NULL || doc == NULL) {
+			//a result without some of the slices would look like a valid one
+			printf("Not enough memory\n");
+			destroyRange(words);
+			words = NULL;
+		} else {
+			words->capacity = total;
+		}
+	}
+	gatherTasks(&range, root, words);
+	for(i = 0; i < threads; i++) {
+		free(range.deques[i].tasks);
+		pthread_mutex_destroy(&range.deques[i].lock);
+		destroyRange(range.buffers[i]);
+	}
+	free(range.deques);
+	free(range.buffers);
+	free(workers);
+	free(ids);
+	return words;
+}
+
+/*
+ * Name function: parallelPrefixQuery
+ * Return: the memory address of the words
+ * Arguments: the tree, the given string and the number of threads
+ * Purpose: the same words as singleKeyRangeQuery; the keys that start with q
+ * are the interval from q to q
+ */
+Range* parallelPrefixQuery(TTree* tree, char* q, int threads) {
+	return parallelRangeQuery(tree, q, q, threads);
+}
+
+#endif /* PARALLELQUERY_H_ */
@@ -0,0 +1,810 @@
+#ifndef QUERY_H_
+#define QUERY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dictionary.h"
+
+#define QUERY_PREFIX 0
+#define QUERY_INTERVAL 1
+#define QUERY_AND 2
+#define QUERY_OR 3
+#define QUERY_NOT 4
+
+/*
+ * A boolean query is a tree: the leaves are prefix terms (q) or interval terms
+ * (q, p), the inner nodes are AND, OR (two children) and NOT (only lt).
+ * The operators work on documents: a document matches "a AND b" if it has
+ * words of both terms.
+ */
+typedef struct Query{
+	int type;
+	char *q;
+	char *p;
+	struct Query *lt;
+	struct Query *rt;
+}Query;
+
+typedef struct ListCursor{
+	TreeNode *node;
+	TreeNode *end;
+}ListCursor;
+
+typedef struct DocList{
+	int *docs;
+	int size;
+}DocList;
+
+/*
+ * Name function: copyString
+ * Return: the memory address of the copy
+ * Arguments: a string and the number of characters to copy
+ * Purpose: copy the first len characters of a string
+ */
+char* copyString(char* str, int len) {
+	char *copy = (char*)malloc(len + 1);
+	if(copy == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	memcpy(copy, str, len);
+	copy[len] = 0;
+	return copy;
+}
+
+/*
+ * Name function: destroyQuery
+ * Return: void (it does not return a value)
+ * Arguments: the query
+ * Purpose: free the memory of a query
+ */
+void destroyQuery(Query* query) {
+	if(query == NULL) {
+		return;
+	}
+	destroyQuery(query->lt);
+	destroyQuery(query->rt);
+	free(query->q);
+	free(query->p);
+	free(query);
+}
+
+/*
+ * Name function: createQuery
+ * Return: the memory address of a new query node, NULL if there is not
+ * enough memory (the children are freed then)
+ * Arguments: the type, the strings of a term and the children
+ * Purpose: allocate a node of a query and copy its strings
+ */
+Query* createQuery(int type, char* q, char* p, Query* lt, Query* rt) {
+	Query *query = (Query*)malloc(sizeof(Query));
+	if(query == NULL) {
+		printf("Not enough memory\n");
+		destroyQuery(lt);
+		destroyQuery(rt);
+		return NULL;
+	}
+	query->type = type;
+	query->q = q ? copyString(q, strlen(q)) : NULL;
+	query->p = p ? copyString(p, strlen(p)) : NULL;
+	query->lt = lt;
+	query->rt = rt;
+	if((q != NULL && query->q == NULL) || (p != NULL && query->p == NULL)) {
+		destroyQuery(query);
+		return NULL;
+	}
+	return query;
+}
+
+/*
+ * Name function: nextQueryToken
+ * Return: the length of the token, 0 at the end of the text
+ * Arguments: the text and the position where the token starts
+ * Purpose: skip the spaces and measure the next token of a query
+ */
+int nextQueryToken(char* text, int* pos) {
+	int len = 0;
+	while(text[*pos] == ' ') {
+		(*pos)++;
+	}
+	if(text[*pos] == '(' || text[*pos] == ')') {
+		return 1;
+	}
+	while(text[*pos + len] != 0 && text[*pos + len] != ' ' &&
+			text[*pos + len] != '(' && text[*pos + len] != ')') {
+		len++;
+	}
+	return len;
+}
+
+Query* parseOr(char* text, int* pos);
+
+/*
+ * Name function: parseTerm
+ * Return: the memory address of the parsed query, NULL if there is no term
+ * or it is malformed
+ * Arguments: the text and the current position
+ * Purpose: parse a term ("q", "q*", "q..p"), a NOT or a parenthesis
+ */
+Query* parseTerm(char* text, int* pos) {
+	int len = nextQueryToken(text, pos);
+	char *token, *dots;
+	Query *query;
+
+	if(len == 0 || text[*pos] == ')') {
+		return NULL;
+	}
+	if(text[*pos] == '(') {
+		(*pos)++;
+		query = parseOr(text, pos);
+		//a parenthesis that is not closed makes the query malformed
+		if(query == NULL || nextQueryToken(text, pos) != 1 ||
+				text[*pos] != ')') {
+			destroyQuery(query);
+			return NULL;
+		}
+		(*pos)++;
+		return query;
+	}
+	if(len == 3 && strncmp(text + *pos, "NOT", 3) == 0) {
+		*pos += 3;
+		query = parseTerm(text, pos);
+		return query ? createQuery(QUERY_NOT, NULL, NULL, query, NULL) : NULL;
+	}
+	token = copyString(text + *pos, len);
+	if(token == NULL) {
+		return NULL;
+	}
+	*pos += len;
+	dots = strstr(token, "..");
+	if(dots != NULL) {
+		*dots = 0;
+		query = createQuery(QUERY_INTERVAL, token, dots + 2, NULL, NULL);
+	} else {
+		//the words of the tree are cut, so is the prefix
+		if(len > 0 && token[len - 1] == '*') {
+			token[--len] = 0;
+		}
+		if(len > ELEMENT_TREE_LENGTH) {
+			token[ELEMENT_TREE_LENGTH] = 0;
+		}
+		query = createQuery(QUERY_PREFIX, token, NULL, NULL, NULL);
+	}
+	free(token);
+	return query;
+}
+
+/*
+ * Name function: parseAnd
+ * Return: the memory address of the parsed query, NULL if it is malformed
+ * Arguments: the text and the current position
+ * Purpose: parse terms joined by AND; two terms next to each other are an AND
+ */
+Query* parseAnd(char* text, int* pos) {
+	Query *query = parseTerm(text, pos), *right;
+	int len;
+
+	while(query != NULL) {
+		len = nextQueryToken(text, pos);
+		if(len == 0 || text[*pos] == ')' ||
+				(len == 2 && strncmp(text + *pos, "OR", 2) == 0)) {
+			break;
+		}
+		if(len == 3 && strncmp(text + *pos, "AND", 3) == 0) {
+			*pos += 3;
+		}
+		right = parseTerm(text, pos);
+		if(right == NULL) {
+			destroyQuery(query);
+			return NULL;
+		}
+		query = createQuery(QUERY_AND, NULL, NULL, query, right);
+	}
+	return query;
+}
+
+/*
+ * Name function: parseOr
+ * Return: the memory address of the parsed query, NULL if it is malformed
+ * Arguments: the text and the current position
+ * Purpose: parse groups of AND joined by OR
+ */
+Query* parseOr(char* text, int* pos) {
+	Query *query = parseAnd(text, pos), *right;
+	int len;
+
+	while(query != NULL) {
+		len = nextQueryToken(text, pos);
+		if(len != 2 || strncmp(text + *pos, "OR", 2) != 0) {
+			break;
+		}
+		*pos += 2;
+		right = parseAnd(text, pos);
+		if(right == NULL) {
+			destroyQuery(query);
+			return NULL;
+		}
+		query = createQuery(QUERY_OR, NULL, NULL, query, right);
+	}
+	return query;
+}
+
+/*
+ * Name function: parseQuery
+ * Return: the memory address of the query, NULL if the text is empty or
+ * malformed ("a OR", "(a", "a ) b")
+ * Arguments: the text of the query, e.g. "(v* OR j..pr) AND NOT mel"
+ * Purpose: turn a text into a boolean query; NOT binds the strongest, then
+ * AND, then OR
+ */
+Query* parseQuery(char* text) {
+	Query *query;
+	int pos = 0;
+	if(text == NULL || nextQueryToken(text, &pos) == 0) {
+		return NULL;
+	}
+	query = parseOr(text, &pos);
+	//every token has to be part of the query
+	if(query == NULL || nextQueryToken(text, &pos) != 0) {
+		printf("ERROR: Invalid query %s\n", text);
+		destroyQuery(query);
+		return NULL;
+	}
+	return query;
+}
+
+/*
+ * Name function: matchTerm
+ * Return: -1 if the key is before the term, 0 if it matches, 1 if it is after
+ * Arguments: the term and a key
+ * Purpose: place a key relative to the keys of a prefix or interval term
+ */
+int matchTerm(Query* term, char* key) {
+	int cmp;
+	if(term->type == QUERY_PREFIX) {
+		cmp = strncmp(key, term->q, strlen(term->q));
+		return (cmp < 0) ? -1 : (cmp > 0);
+	}
+	//the same rule as walkInterval
+	if(strncmp(term->q, key, strlen(term->q)) > 0) {
+		return -1;
+	}
+	if(strncmp(term->p, key, strlen(term->p)) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Name function: collectHeads
+ * Return: void (it does not return a value)
+ * Arguments: a node, the term, the array of heads and its size and capacity
+ * Purpose: save in order the first node of every key that matches a term,
+ * without visiting the subtrees that are outside the term
+ */
+void collectHeads(TreeNode* node, Query* term, TreeNode*** heads, int* size,
+		int* capacity) {
+	int m;
+	if(node == NULL) {
+		return;
+	}
+	m = matchTerm(term, node->elem);
+	if(m >= 0) {
+		collectHeads(node->lt, term, heads, size, capacity);
+	}
+	if(m == 0 && !TOMBSTONE(node)) {
+		if(*size == *capacity) {
+			TreeNode **bigger = (TreeNode**)realloc(*heads,
+					sizeof(TreeNode*) * (*capacity ? *capacity * 2 : 16));
+			if(bigger == NULL) {
+				printf("Not enough memory\n");
+				return;
+			}
+			*heads = bigger;
+			*capacity = *capacity ? *capacity * 2 : 16;
+		}
+		(*heads)[(*size)++] = node;
+	}
+	if(m <= 0) {
+		collectHeads(node->rt, term, heads, size, capacity);
+	}
+}
+
+/*
+ * Name function: comparePostings
+ * Return: a negative number, 0 or a positive number like strcmp
+ * Arguments: two postings
+ * Purpose: order postings by document and then by offset
+ */
+int comparePostings(Posting* a, Posting* b) {
+	if(a->doc != b->doc) {
+		return (a->doc < b->doc) ? -1 : 1;
+	}
+	if(a->offset != b->offset) {
+		return (a->offset < b->offset) ? -1 : 1;
+	}
+	return 0;
+}
+
+/*
+ * Name function: siftDown
+ * Return: void (it does not return a value)
+ * Arguments: the heap of list cursors, its size and a position
+ * Purpose: restore the heap property below a position
+ */
+void siftDown(ListCursor* heap, int size, int i) {
+	ListCursor aux;
+	int child;
+	while((child = 2 * i + 1) < size) {
+		if(child + 1 < size && comparePostings(heap[child + 1].node->info,
+					heap[child].node->info) < 0) {
+			child++;
+		}
+		if(comparePostings(heap[i].node->info, heap[child].node->info) <= 0) {
+			break;
+		}
+		aux = heap[i];
+		heap[i] = heap[child];
+		heap[child] = aux;
+		i = child;
+	}
+}
+
+/*
+ * Name function: mergeHeads
+ * Return: the memory address of a range sorted by document and offset
+ * Arguments: the heads of some keys and their number
+ * Purpose: merge the lists of duplicates of the keys with a heap; every list
+ * is already sorted because the words are inserted in the order of the files
+ */
+Range* mergeHeads(TreeNode** heads, int size) {
+	Range *words = createRange();
+	ListCursor *heap;
+	int i, n = size;
+
+	if(words == NULL || size == 0) {
+		return words;
+	}
+	heap = (ListCursor*)malloc(sizeof(ListCursor) * size);
+	if(heap == NULL) {
+		printf("Not enough memory\n");
+		return words;
+	}
+	for(i = 0; i < size; i++) {
+		heap[i].node = heads[i];
+		heap[i].end = heads[i]->end;
+	}
+	for(i = size / 2 - 1; i >= 0; i--) {
+		siftDown(heap, n, i);
+	}
+	while(n > 0) {
+		addToRange(words, heap[0].node->info);
+		//move to the next duplicate or drop the list if it has ended
+		if(heap[0].node != heap[0].end) {
+			heap[0].node = heap[0].node->next;
+		} else {
+			heap[0] = heap[--n];
+		}
+		siftDown(heap, n, 0);
+	}
+	free(heap);
+	return words;
+}
+
+/*
+ * Name function: termPostings
+ * Return: the memory address of a range sorted by document and offset
+ * Arguments: the tree and a term
+ * Purpose: get every posting of a prefix or interval term
+ */
+Range* termPostings(TTree* tree, Query* term) {
+	TreeNode **heads = NULL;
+	int size = 0, capacity = 0;
+	Range *words;
+
+	collectHeads(tree->root, term, &heads, &size, &capacity);
+	words = mergeHeads(heads, size);
+	free(heads);
+	return words;
+}
+
+/*
+ * Name function: rangeDocs
+ * Return: the distinct documents of a range
+ * Arguments: a range sorted by document
+ * Purpose: turn postings into a sorted list of documents
+ */
+DocList rangeDocs(Range* words) {
+	DocList list;
+	int i;
+	list.docs = (int*)malloc(sizeof(int) * (words->size + 1));
+	list.size = 0;
+	if(list.docs == NULL) {
+		printf("Not enough memory\n");
+		return list;
+	}
+	for(i = 0; i < words->size; i++) {
+		if(list.size == 0 || list.docs[list.size - 1] != words->doc[i]) {
+			list.docs[list.size++] = words->doc[i];
+		}
+	}
+	return list;
+}
+
+/*
+ * Name function: gallop
+ * Return: the first position in [lo, size) with a value >= target
+ * Arguments: a sorted array, its size, the starting position and the target
+ * Purpose: exponential search followed by a binary search, so that skipping
+ * k values costs O(log k)
+ */
+int gallop(int* a, int size, int lo, int target) {
+	int step = 1, hi = lo;
+	while(hi < size && a[hi] < target) {
+		lo = hi + 1;
+		hi += step;
+		step *= 2;
+	}
+	if(hi > size) {
+		hi = size;
+	}
+	while(lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if(a[mid] < target) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+ * Name function: intersectDocs
+ * Return: the documents in both lists
+ * Arguments: two sorted lists of documents (they are freed)
+ * Purpose: intersect by galloping through the longer list for every document
+ * of the shorter one
+ */
+DocList intersectDocs(DocList a, DocList b) {
+	DocList list, aux;
+	int i, j = 0;
+	if(a.size > b.size) {
+		aux = a;
+		a = b;
+		b = aux;
+	}
+	list.docs = (int*)malloc(sizeof(int) * (a.size + 1));
+	list.size = 0;
+	if(list.docs == NULL) {
+		printf("Not enough memory\n");
+		a.size = 0;
+	}
+	for(i = 0; i < a.size && j < b.size; i++) {
+		j = gallop(b.docs, b.size, j, a.docs[i]);
+		if(j < b.size && b.docs[j] == a.docs[i]) {
+			list.docs[list.size++] = a.docs[i];
+		}
+	}
+	free(a.docs);
+	free(b.docs);
+	return list;
+}
+
+/*
+ * Name function: uniteDocs
+ * Return: the documents in any of the lists
+ * Arguments: two sorted lists of documents (they are freed)
+ * Purpose: merge two sorted lists without duplicates
+ */
+DocList uniteDocs(DocList a, DocList b) {
+	DocList list;
+	int i = 0, j = 0;
+	list.docs = (int*)malloc(sizeof(int) * (a.size + b.size + 1));
+	list.size = 0;
+	if(list.docs == NULL) {
+		printf("Not enough memory\n");
+		a.size = b.size = 0;
+	}
+	while(i < a.size || j < b.size) {
+		if(j == b.size || (i < a.size && a.docs[i] < b.docs[j])) {
+			list.docs[list.size++] = a.docs[i++];
+		} else {
+			if(i < a.size && a.docs[i] == b.docs[j]) {
+				i++;
+			}
+			list.docs[list.size++] = b.docs[j++];
+		}
+	}
+	free(a.docs);
+	free(b.docs);
+	return list;
+}
+
+/*
+ * Name function: complementDocs
+ * Return: the documents that are not in the list
+ * Arguments: a sorted list of documents (it is freed) and the number of
+ * documents
+ * Purpose: evaluate a NOT
+ */
+DocList complementDocs(DocList a, int docCount) {
+	DocList list;
+	int doc, i = 0;
+	list.docs = (int*)malloc(sizeof(int) * (docCount + 1));
+	list.size = 0;
+	if(list.docs == NULL) {
+		printf("Not enough memory\n");
+		docCount = 0;
+	}
+	for(doc = 0; doc < docCount; doc++) {
+		if(i < a.size && a.docs[i] == doc) {
+			i++;
+		} else {
+			list.docs[list.size++] = doc;
+		}
+	}
+	free(a.docs);
+	return list;
+}
+
+/*
+ * Name function: evalDocs
+ * Return: the sorted list of the documents that match a query
+ * Arguments: the tree, the query and the number of documents
+ * Purpose: evaluate the boolean operators over lists of documents
+ */
+DocList evalDocs(TTree* tree, Query* query, int docCount) {
+	DocList list;
+	Range *words;
+	switch(query->type) {
+		case QUERY_AND:
+			return intersectDocs(evalDocs(tree, query->lt, docCount),
+					evalDocs(tree, query->rt, docCount));
+		case QUERY_OR:
+			return uniteDocs(evalDocs(tree, query->lt, docCount),
+					evalDocs(tree, query->rt, docCount));
+		case QUERY_NOT:
+			return complementDocs(evalDocs(tree, query->lt, docCount),
+					docCount);
+		default:
+			words = termPostings(tree, query);
+			list = rangeDocs(words);
+			destroyRange(words);
+			return list;
+	}
+}
+
+/*
+ * Name function: collectPositiveHeads
+ * Return: void (it does not return a value)
+ * Arguments: the tree, the query, whether it is under a NOT and the array of
+ * heads with its size and capacity
+ * Purpose: gather the keys of the terms that are not negated
+ */
+void collectPositiveHeads(TTree* tree, Query* query, int negated,
+		TreeNode*** heads, int* size, int* capacity) {
+	if(query == NULL) {
+		return;
+	}
+	if(query->type == QUERY_PREFIX || query->type == QUERY_INTERVAL) {
+		if(negated == 0) {
+			collectHeads(tree->root, query, heads, size, capacity);
+		}
+		return;
+	}
+	if(query->type == QUERY_NOT) {
+		negated = !negated;
+	}
+	collectPositiveHeads(tree, query->lt, negated, heads, size, capacity);
+	collectPositiveHeads(tree, query->rt, negated, heads, size, capacity);
+}
+
+/*
+ * Name function: compareHeads
+ * Return: a negative number, 0 or a positive number like strcmp
+ * Arguments: the addresses of two heads
+ * Purpose: order heads by key for qsort
+ */
+int compareHeads(const void* a, const void* b) {
+	return compareStrElem((*(TreeNode**)a)->elem, (*(TreeNode**)b)->elem);
+}
+
+/*
+ * Name function: booleanQuery
+ * Return: the memory address of the words
+ * Arguments: the tree, the query and the number of documents
+ * Purpose: find the documents that match a query and return the words of its
+ * terms (the negated ones excluded) from those documents, sorted by document
+ * and offset
+ */
+Range* booleanQuery(TTree* tree, Query* query, int docCount) {
+	TreeNode **heads = NULL, **unique;
+	int size = 0, capacity = 0, i, j, k;
+	DocList docs;
+	Range *all, *words;
+
+	if(tree == NULL || query == NULL) {
+		return createRange();
+	}
+	docs = evalDocs(tree, query, docCount);
+	collectPositiveHeads(tree, query, 0, &heads, &size, &capacity);
+
+	//a key can be part of more than one term, but its words are given once
+	if(size > 0) {
+		qsort(heads, size, sizeof(TreeNode*), compareHeads);
+	}
+	unique = heads;
+	k = 0;
+	for(i = 0; i < size; i++) {
+		if(k == 0 || unique[k - 1] != heads[i]) {
+			unique[k++] = heads[i];
+		}
+	}
+	all = mergeHeads(unique, k);
+	free(heads);
+
+	//keep the words from the documents that match
+	words = createRange();
+	j = 0;
+	for(i = 0; all != NULL && i < all->size && words != NULL; i++) {
+		while(j < docs.size && docs.docs[j] < all->doc[i]) {
+			j++;
+		}
+		if(j < docs.size && docs.docs[j] == all->doc[i]) {
+			Posting posting;
+			posting.offset = all->index[i];
+			posting.doc = all->doc[i];
+			addToRange(words, &posting);
+		}
+	}
+	destroyRange(all);
+	free(docs.docs);
+	return words;
+}
+
+/*
+ * Name function: keyHead
+ * Return: the first node of the key of a word, NULL if it is not in the tree
+ * Arguments: the tree and the word
+ * Purpose: find the list of duplicates of a word, cut like the words of the
+ * tree; every word with the same key shares this list
+ */
+TreeNode* keyHead(TTree* tree, char* word) {
+	char *key = createStrElement(word);
+	TreeNode *node = search(tree, tree->root, key);
+	destroyStrElement(key);
+	return node;
+}
+
+/*
+ * Name function: comparePositions
+ * Return: a negative number, 0 or a positive number like strcmp
+ * Arguments: a posting, a document and a position
+ * Purpose: order postings by document and then by position
+ */
+int comparePositions(Posting* a, int doc, long position) {
+	if(a->doc != doc) {
+		return (a->doc < doc) ? -1 : 1;
+	}
+	if(a->position != position) {
+		return (a->position < position) ? -1 : 1;
+	}
+	return 0;
+}
+
+/*
+ * Name function: phraseQuery
+ * Return: the memory address of the words where the phrase starts
+ * Arguments: the tree and the phrase (words separated by spaces)
+ * Purpose: find the words that are followed by the rest of the phrase, by
+ * merging the sorted lists of positions of every word; the text is not read,
+ * so the words are matched on their keys ("the cat" also finds "them catalog")
+ */
+Range* phraseQuery(TTree* tree, char* phrase) {
+	Range *words = createRange();
+	ListCursor *lists;
+	Posting *first, *posting;
+	int count = 0, pos = 0, len, i;
+	char *word;
+
+	if(words == NULL || tree == NULL || phrase == NULL) {
+		return words;
+	}
+	lists = (ListCursor*)malloc(sizeof(ListCursor) * (strlen(phrase) + 1));
+	if(lists == NULL) {
+		printf("Not enough memory\n");
+		return words;
+	}
+	//a cursor over the list of duplicates of every word
+	while((len = nextQueryToken(phrase, &pos)) != 0) {
+		word = copyString(phrase + pos, len);
+		pos += len;
+		lists[count].node = keyHead(tree, word);
+		free(word);
+		if(lists[count].node == NULL) {
+			free(lists);
+			return words;
+		}
+		lists[count].end = lists[count].node->end->next;
+		count++;
+	}
+
+	//for every start, move the other cursors to position + i
+	while(count > 0 && lists[0].node != lists[0].end) {
+		first = lists[0].node->info;
+		for(i = 1; i < count; i++) {
+			while(lists[i].node != lists[i].end &&
+					comparePositions(lists[i].node->info, first->doc,
+						first->position + i) < 0) {
+				lists[i].node = lists[i].node->next;
+			}
+			if(lists[i].node == lists[i].end) {
+				free(lists);
+				return words;
+			}
+			posting = lists[i].node->info;
+			if(comparePositions(posting, first->doc, first->position + i) != 0) {
+				break;
+			}
+		}
+		if(i == count) {
+			addToRange(words, first);
+		}
+		lists[0].node = lists[0].node->next;
+	}
+	free(lists);
+	return words;
+}
+
+/*
+ * Name function: proximityQuery
+ * Return: the memory address of the words
+ * Arguments: the tree, two words and the maximum distance k
+ * Purpose: find the occurrences of the first word that have the second word at
+ * most k words before or after them in the same document (a NEAR/k b); like
+ * phraseQuery, the words are matched on their keys
+ */
+Range* proximityQuery(TTree* tree, char* a, char* b, int k) {
+	Range *words = createRange();
+	TreeNode *na, *nb, *enda, *endb;
+	Posting *pa;
+
+	if(words == NULL || tree == NULL) {
+		return words;
+	}
+	na = keyHead(tree, a);
+	nb = keyHead(tree, b);
+	if(na == NULL || nb == NULL) {
+		return words;
+	}
+	enda = na->end->next;
+	endb = nb->end->next;
+	//both lists only move forward
+	for(; na != enda; na = na->next) {
+		pa = na->info;
+		while(nb != endb && comparePositions(nb->info, pa->doc,
+					pa->position - k) < 0) {
+			nb = nb->next;
+		}
+		if(nb == endb) {
+			break;
+		}
+		if(nb == na && nb->next != endb) {
+			//the same word does not count as its own neighbour
+			if(comparePositions(nb->next->info, pa->doc, pa->position + k) <= 0) {
+				addToRange(words, pa);
+			}
+			continue;
+		}
+		if(nb != na && comparePositions(nb->info, pa->doc,
+					pa->position + k) <= 0) {
+			addToRange(words, pa);
+		}
+	}
+	return words;
+}
+
+#endif /* QUERY_H_ */
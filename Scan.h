@@ -0,0 +1,336 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Dictionary.h"
+#include "StaticIndex.h"
+
+/*
+ * Answering queries straight from the text, without a tree. The tokenizer
+ * gives a word the offset of its first character minus the number of ", "
+ * before it, and drops a word that reaches the end of the file, so a word is
+ * a run of 'a'-'z', '-', ':' that starts somewhere before the last run of the
+ * file. The runs are found 16 characters at a time from bit masks.
+ * The costs below are in scans of the file: building the tree costs about
+ * SCAN_BUILD_COST scans and every query checked during a scan adds about
+ * SCAN_QUERY_COST, while a query on the tree costs about as much as scanning
+ * SCAN_TREE_QUERY characters. So a few queries on a big file are scans.
+ */
+#define SCAN_BUILD_COST 15
+#define SCAN_QUERY_COST 0.5
+#define SCAN_TREE_QUERY 4096
+#define SCAN_STEP 16
+
+typedef struct ScanHit{
+	int32_t key;
+	long offset;
+}ScanHit;
+
+typedef struct ScanQuery{
+	char *q, *p;
+	int lengthQ, lengthP;
+	ScanHit *hits;
+	long size, capacity;
+}ScanQuery;
+
+/*
+ * Name function: isWordChar
+ * Return: 1 if the character can be part of a word, 0 otherwise
+ * Arguments: a character
+ * Purpose: the characters of the words, like in tokenize
+ */
+int isWordChar(char c) {
+	return (c >= 'a' && c <= 'z') || c == '-' || c == ':';
+}
+
+/*
+ * Name function: wordMask
+ * Return: a mask with bit i set if s[i] can be part of a word
+ * Arguments: SCAN_STEP characters
+ * Purpose: classify SCAN_STEP characters at once
+ */
+int wordMask(char* s) {
+#ifdef __SSE2__
+	__m128i v = _mm_loadu_si128((__m128i*)s);
+	//'a'..'z' become the 26 smallest signed bytes
+	__m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(128 - 'a')));
+	__m128i word = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+	word = _mm_or_si128(word, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+	word = _mm_or_si128(word, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+	return _mm_movemask_epi8(word);
+#else
+	int i, mask = 0;
+	for(i = 0; i < SCAN_STEP; i++) {
+		mask |= isWordChar(s[i]) << i;
+	}
+	return mask;
+#endif
+}
+
+/*
+ * Name function: charMask
+ * Return: a mask with bit i set if s[i] is c
+ * Arguments: SCAN_STEP characters and a character
+ * Purpose: find a character in SCAN_STEP characters at once
+ */
+int charMask(char* s, char c) {
+#ifdef __SSE2__
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)s),
+			_mm_set1_epi8(c)));
+#else
+	int i, mask = 0;
+	for(i = 0; i < SCAN_STEP; i++) {
+		mask |= (s[i] == c) << i;
+	}
+	return mask;
+#endif
+}
+
+/*
+ * Name function: addScanHit
+ * Return: void (it does not return a value)
+ * Arguments: a query, the key of a word and its offset
+ * Purpose: save a word that matches a query
+ */
+void addScanHit(ScanQuery* query, int32_t key, long offset) {
+	if(query->size == query->capacity) {
+		long capacity = query->capacity ? query->capacity * 2 : BUFLEN;
+		ScanHit *hits = (ScanHit*)realloc(query->hits, sizeof(ScanHit) * capacity);
+		if(hits == NULL) {
+			printf("Not enough memory\n");
+			return;
+		}
+		query->hits = hits;
+		query->capacity = capacity;
+	}
+	query->hits[query->size].key = key;
+	query->hits[query->size].offset = offset;
+	query->size++;
+}
+
+/*
+ * Name function: scanWord
+ * Return: void (it does not return a value)
+ * Arguments: the queries (as the context of a scan, ended by one with no q),
+ * the start of a word and its offset
+ * Purpose: check a word against every query, with the same comparisons as
+ * walkPrefix (p is NULL) and walkInterval
+ */
+void scanWord(void* context, char* word, long offset) {
+	ScanQuery *queries = (ScanQuery*)context;
+	char key[ELEMENT_TREE_LENGTH + 1];
+	int i;
+	for(i = 0; i < ELEMENT_TREE_LENGTH && isWordChar(word[i]); i++) {
+		key[i] = word[i];
+	}
+	key[i] = 0;
+	for(i = 0; queries[i].q != NULL; i++) {
+		if(queries[i].p == NULL ?
+				strncmp(key, queries[i].q, queries[i].lengthQ) == 0 :
+				strcmp(key, queries[i].q) >= 0 &&
+				strncmp(queries[i].p, key, queries[i].lengthP) >= 0) {
+			addScanHit(&queries[i], packKey(key), offset);
+		}
+	}
+}
+
+/*
+ * Name function: scanText
+ * Return: void (it does not return a value)
+ * Arguments: a text, its size, the first character of the words that are
+ * wanted (0 for every word), the function that gets every word with its
+ * offset and its context
+ * Purpose: find the words of a text, with the offsets of the tokenizer
+ */
+void scanText(char* text, long size, char first,
+		void (*found)(void*, char*, long), void* context) {
+	long end = size, pos = 0, commas = 0, start;
+	int words, pairs, starts, carry = 0, bit;
+
+	//the last run of the file is not followed by anything, so it is no word
+	while(end > 0 && isWordChar(text[end - 1])) {
+		end--;
+	}
+	//text[pos + SCAN_STEP] is read for the ", " at the end of a step
+	for(; pos + SCAN_STEP < end; pos += SCAN_STEP) {
+		words = wordMask(text + pos);
+		pairs = charMask(text + pos, ',') & charMask(text + pos + 1, ' ');
+		starts = words & ~((words << 1) | carry);
+		if(first != 0) {
+			starts &= charMask(text + pos, first);
+		}
+		while(starts != 0) {
+			bit = __builtin_ctz(starts);
+			start = pos + bit;
+			found(context, text + start, start - commas -
+					__builtin_popcount(pairs & ((1 << bit) - 1)));
+			starts &= starts - 1;
+		}
+		commas += __builtin_popcount(pairs);
+		carry = (words >> (SCAN_STEP - 1)) & 1;
+	}
+	for(; pos < end; pos++) {
+		if(isWordChar(text[pos]) && carry == 0 &&
+				(first == 0 || text[pos] == first)) {
+			found(context, text + pos, pos - commas);
+		}
+		if(text[pos] == ',' && pos + 1 < size && text[pos + 1] == ' ') {
+			commas++;
+		}
+		carry = isWordChar(text[pos]);
+	}
+}
+
+/*
+ * Name function: compareScanHits
+ * Return: a negative number, 0 or a positive number, like strcmp
+ * Arguments: two hits
+ * Purpose: order the hits like the tree, by key and then by offset
+ */
+int compareScanHits(const void* a, const void* b) {
+	const ScanHit *x = (const ScanHit*)a, *y = (const ScanHit*)b;
+	if(x->key != y->key) {
+		return (x->key < y->key) ? -1 : 1;
+	}
+	return (x->offset < y->offset) ? -1 : (x->offset > y->offset);
+}
+
+/*
+ * Name function: scanQueries
+ * Return: 1 if the file was scanned, 0 otherwise
+ * Arguments: the file, the strings q and p of every query (p is NULL for a
+ * prefix query), their number and an array for the results
+ * Purpose: answer queries with one scan of a mapped file; out[i] gets the
+ * same range as singleKeyRangeQuery/multiKeyRangeQuery on the tree of the file
+ */
+int scanQueries(char* fileName, char** qs, char** ps, int n, Range** out) {
+	ScanQuery *queries = (ScanQuery*)calloc(n + 1, sizeof(ScanQuery));
+	struct stat info;
+	char *text = NULL;
+	int fd = open(fileName, O_RDONLY), i;
+	long j;
+
+	if(queries == NULL || fd < 0 || fstat(fd, &info) < 0) {
+		printf("ERROR: Can't open file %s\n", fileName);
+		free(queries);
+		if(fd >= 0) {
+			close(fd);
+		}
+		return 0;
+	}
+	if(info.st_size > 0) {
+		text = (char*)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(text == MAP_FAILED) {
+			printf("ERROR: Can't open file %s\n", fileName);
+			free(queries);
+			close(fd);
+			return 0;
+		}
+	}
+	close(fd);
+
+	for(i = 0; i < n; i++) {
+		queries[i].q = qs[i];
+		queries[i].p = (ps != NULL) ? ps[i] : NULL;
+		queries[i].lengthQ = strlen(qs[i]);
+		queries[i].lengthP = queries[i].p ? strlen(queries[i].p) : 0;
+	}
+	if(text != NULL) {
+		//with a single prefix query only the words with its first character
+		scanText(text, info.st_size, (n == 1 && queries[0].p == NULL) ?
+				queries[0].q[0] : 0, scanWord, queries);
+		munmap(text, info.st_size);
+	}
+	for(i = 0; i < n; i++) {
+		if(queries[i].size > 0) {
+			qsort(queries[i].hits, queries[i].size, sizeof(ScanHit),
+					compareScanHits);
+		}
+		out[i] = createRange();
+		for(j = 0; out[i] != NULL && j < queries[i].size; j++) {
+			Posting posting = {queries[i].hits[j].offset, 0, 0};
+			addToRange(out[i], &posting);
+		}
+		free(queries[i].hits);
+	}
+	free(queries);
+	return 1;
+}
+
+/*
+ * Name function: scanPrefixQuery
+ * Return: the memory address of the words
+ * Arguments: the file and the given string
+ * Purpose: the same words as singleKeyRangeQuery, without a tree
+ */
+Range* scanPrefixQuery(char* fileName, char* q) {
+	Range *words = NULL;
+	scanQueries(fileName, &q, NULL, 1, &words);
+	return words;
+}
+
+/*
+ * Name function: scanIntervalQuery
+ * Return: the memory address of the words
+ * Arguments: the file and the two strings q, p
+ * Purpose: the same words as multiKeyRangeQuery, without a tree
+ */
+Range* scanIntervalQuery(char* fileName, char* q, char* p) {
+	Range *words = NULL;
+	scanQueries(fileName, &q, &p, 1, &words);
+	return words;
+}
+
+/*
+ * Name function: chooseScan
+ * Return: 1 if scanning is cheaper than building the tree, 0 otherwise
+ * Arguments: the size of the file and the number of queries
+ * Purpose: compare one scan that checks every query against a build of the
+ * tree and the queries on it
+ */
+int chooseScan(long size, int n) {
+	return size * (1 + SCAN_QUERY_COST * n) <
+			size * SCAN_BUILD_COST + (double)n * SCAN_TREE_QUERY;
+}
+
+/*
+ * Name function: runQueries
+ * Return: 1 if the queries were answered, 0 otherwise
+ * Arguments: the file, the strings q and p of every query (p is NULL for a
+ * prefix query), their number and an array for the results
+ * Purpose: answer queries on a file with a scan or with a tree, whichever
+ * is cheaper for their number
+ */
+int runQueries(char* fileName, char** qs, char** ps, int n, Range** out) {
+	TTree *tree;
+	int i;
+	struct stat info;
+	if(stat(fileName, &info) < 0 || chooseScan(info.st_size, n)) {
+		return scanQueries(fileName, qs, ps, n, out);
+	}
+	tree = buildTreeFromFile(fileName);
+	if(tree == NULL) {
+		return 0;
+	}
+	for(i = 0; i < n; i++) {
+		out[i] = (ps != NULL && ps[i] != NULL) ?
+				multiKeyRangeQuery(tree, qs[i], ps[i]) :
+				singleKeyRangeQuery(tree, qs[i]);
+	}
+	destroyTree(tree);
+	return 1;
+}
+
+#endif /* SCAN_H_ */
@@ -0,0 +1,615 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Dictionary.h"
+#include "Ingest.h"
+
+/*
+ * The index is built once and then answers requests, one JSON object per
+ * line, for example
+ *	{"id": 1, "op": "prefix", "q": "v"}
+ *	{"id": 2, "op": "interval", "q": "j", "p": "pr"}
+ *	{"id": 3, "op": "count", "q": "j", "p": "pr"}
+ * and every request gets one line back, in the order of the requests:
+ *	{"id": 1, "count": 2, "hits": [[0, 31], [0, 102]]}
+ *	{"id": 3, "count": 7}
+ * Every line that is already read is part of the same batch: its requests
+ * are answered at the same time by the workers, then the answers are written.
+ */
+#define SERVER_WORKERS 4
+#define SERVER_BACKLOG 16
+
+typedef struct TextBuffer{
+	char *data;
+	long size;
+	long capacity;
+}TextBuffer;
+
+typedef struct ServerBatch{
+	int left;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+}ServerBatch;
+
+typedef struct ServerJob{
+	char *request;
+	TextBuffer response;
+	ServerBatch *batch;
+	struct ServerJob *next;
+}ServerJob;
+
+typedef struct Server{
+	TTree *tree;
+	pthread_t workers[SERVER_WORKERS];
+	int started;
+	//the jobs that wait for a worker
+	ServerJob *first, *last;
+	int stop;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+}Server;
+
+typedef struct ServerConnection{
+	Server *server;
+	int fd;
+}ServerConnection;
+
+/*
+ * Name function: appendText
+ * Return: void (it does not return a value)
+ * Arguments: the buffer, a text and its length
+ * Purpose: add a text at the end of a buffer, doubling it when it is full
+ */
+void appendText(TextBuffer* buffer, char* text, long length) {
+	if(buffer->size + length + 1 > buffer->capacity) {
+		long capacity = buffer->capacity ? buffer->capacity : BUFLEN;
+		char *data;
+		while(buffer->size + length + 1 > capacity) {
+			capacity *= 2;
+		}
+		data = (char*)realloc(buffer->data, capacity);
+		if(data == NULL) {
+			printf("Not enough memory\n");
+			return;
+		}
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->data + buffer->size, text, length);
+	buffer->size += length;
+	buffer->data[buffer->size] = 0;
+}
+
+/*
+ * Name function: appendString
+ * Return: void (it does not return a value)
+ * Arguments: the buffer and a string
+ * Purpose: add a whole string at the end of a buffer
+ */
+void appendString(TextBuffer* buffer, char* text) {
+	appendText(buffer, text, strlen(text));
+}
+
+/*
+ * Name function: appendNumber
+ * Return: void (it does not return a value)
+ * Arguments: the buffer and a number
+ * Purpose: add a number at the end of a buffer
+ */
+void appendNumber(TextBuffer* buffer, long number) {
+	char text[32];
+	appendText(buffer, text, sprintf(text, "%ld", number));
+}
+
+/*
+ * Name function: skipJsonSpaces
+ * Return: the first character that is not a space
+ * Arguments: a position in a text
+ * Purpose: skip the spaces between JSON tokens
+ */
+char* skipJsonSpaces(char* s) {
+	while(*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') {
+		s++;
+	}
+	return s;
+}
+
+/*
+ * Name function: skipJsonValue
+ * Return: the first character after the value, NULL if it is not valid
+ * Arguments: the start of a string, number or literal
+ * Purpose: find where a value of a flat object ends
+ */
+char* skipJsonValue(char* s) {
+	if(*s == '"') {
+		for(s++; *s != '"'; s++) {
+			if(*s == 0 || (*s == '\\' && *++s == 0)) {
+				return NULL;
+			}
+		}
+		return s + 1;
+	}
+	while(*s != 0 && *s != ',' && *s != '}' && *s != ' ' && *s != '\t') {
+		s++;
+	}
+	return s;
+}
+
+/*
+ * Name function: jsonField
+ * Return: the start of the value of a field, NULL if it is missing
+ * Arguments: a line with a flat JSON object, the name of the field and where
+ * to put the length of the value
+ * Purpose: find a field of a request, without building the whole object
+ */
+char* jsonField(char* line, char* name, long* length) {
+	char *s = skipJsonSpaces(line), *key, *value;
+	long size = strlen(name);
+	if(*s++ != '{') {
+		return NULL;
+	}
+	for(s = skipJsonSpaces(s); *s == '"'; s = skipJsonSpaces(s + 1)) {
+		key = s + 1;
+		s = skipJsonValue(s);
+		if(s == NULL) {
+			return NULL;
+		}
+		s = skipJsonSpaces(s);
+		if(*s++ != ':') {
+			return NULL;
+		}
+		value = skipJsonSpaces(s);
+		s = skipJsonValue(value);
+		if(s == NULL) {
+			return NULL;
+		}
+		if(s == value) {
+			return NULL;
+		}
+		if(strncmp(key, name, size) == 0 && key[size] == '"') {
+			*length = s - value;
+			return value;
+		}
+		s = skipJsonSpaces(s);
+		if(*s != ',') {
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Name function: jsonString
+ * Return: the string (it has to be freed), NULL if the field is not a string
+ * Arguments: a line with a flat JSON object and the name of the field
+ * Purpose: get a string field of a request, without its escapes
+ */
+char* jsonString(char* line, char* name) {
+	long length, i, j = 0;
+	char *value = jsonField(line, name, &length), *string;
+	if(value == NULL || *value != '"') {
+		return NULL;
+	}
+	string = (char*)malloc(length);
+	if(string == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	for(i = 1; i < length - 1; i++) {
+		if(value[i] == '\\') {
+			i++;
+			//the keys are plain text, so \uXXXX can't match any of them
+			string[j++] = (value[i] == 'n') ? '\n' : (value[i] == 't') ? '\t' :
+					(value[i] == 'u') ? '?' : value[i];
+			if(value[i] == 'u') {
+				i += 4;
+			}
+		} else {
+			string[j++] = value[i];
+		}
+	}
+	string[j] = 0;
+	return string;
+}
+
+/*
+ * Name function: answerRequest
+ * Return: void (it does not return a value)
+ * Arguments: the tree, a request and the buffer of its answer
+ * Purpose: run the query of one request line and write its answer line
+ */
+void answerRequest(TTree* tree, char* request, TextBuffer* response) {
+	char *op = jsonString(request, "op"), *q = jsonString(request, "q");
+	char *p = jsonString(request, "p"), *id;
+	Range *words = NULL;
+	long length;
+	int i;
+
+	appendString(response, "{\"id\": ");
+	id = jsonField(request, "id", &length);
+	if(id != NULL) {
+		appendText(response, id, length);
+	} else {
+		appendString(response, "null");
+	}
+	if(op == NULL || q == NULL) {
+		appendString(response, ", \"error\": \"missing op or q\"}\n");
+	} else if(strcmp(op, "prefix") == 0 || (strcmp(op, "count") == 0 &&
+			p == NULL)) {
+		words = singleKeyRangeQuery(tree, q);
+	} else if(strcmp(op, "interval") != 0 && strcmp(op, "count") != 0) {
+		appendString(response, ", \"error\": \"unknown op\"}\n");
+	} else if(p == NULL) {
+		appendString(response, ", \"error\": \"missing p\"}\n");
+	} else {
+		words = multiKeyRangeQuery(tree, q, p);
+	}
+
+	if(words != NULL) {
+		appendString(response, ", \"count\": ");
+		appendNumber(response, words->size);
+		if(strcmp(op, "count") != 0) {
+			appendString(response, ", \"hits\": [");
+			for(i = 0; i < words->size; i++) {
+				appendString(response, i ? ", [" : "[");
+				appendNumber(response, words->doc[i]);
+				appendString(response, ", ");
+				appendNumber(response, words->index[i]);
+				appendString(response, "]");
+			}
+			appendString(response, "]");
+		}
+		appendString(response, "}\n");
+		destroyRange(words);
+	}
+	free(op);
+	free(q);
+	free(p);
+}
+
+/*
+ * Name function: serverWorker
+ * Return: NULL
+ * Arguments: the server
+ * Purpose: answer the jobs of the queue until the server stops
+ */
+void* serverWorker(void* argument) {
+	Server *server = (Server*)argument;
+	ServerJob *job;
+
+	while(1) {
+		pthread_mutex_lock(&server->lock);
+		while(server->first == NULL && server->stop == 0) {
+			pthread_cond_wait(&server->ready, &server->lock);
+		}
+		if(server->first == NULL) {
+			pthread_mutex_unlock(&server->lock);
+			return NULL;
+		}
+		job = server->first;
+		server->first = job->next;
+		if(server->first == NULL) {
+			server->last = NULL;
+		}
+		pthread_mutex_unlock(&server->lock);
+
+		answerRequest(server->tree, job->request, &job->response);
+
+		pthread_mutex_lock(&job->batch->lock);
+		if(--job->batch->left == 0) {
+			pthread_cond_signal(&job->batch->done);
+		}
+		pthread_mutex_unlock(&job->batch->lock);
+	}
+}
+
+/*
+ * Name function: createServer
+ * Return: the memory address of the server
+ * Arguments: the tree it answers from
+ * Purpose: start the pool of workers
+ */
+Server* createServer(TTree* tree) {
+	Server *server = (Server*)calloc(1, sizeof(Server));
+	if(server == NULL) {
+		printf("Not enough memory\n");
+		return NULL;
+	}
+	server->tree = tree;
+	pthread_mutex_init(&server->lock, NULL);
+	pthread_cond_init(&server->ready, NULL);
+	for(server->started = 0; server->started < SERVER_WORKERS;
+			server->started++) {
+		if(pthread_create(&server->workers[server->started], NULL,
+				serverWorker, server) != 0) {
+			break;
+		}
+	}
+	if(server->started == 0) {
+		printf("Can't start the workers\n");
+		pthread_mutex_destroy(&server->lock);
+		pthread_cond_destroy(&server->ready);
+		free(server);
+		return NULL;
+	}
+	return server;
+}
+
+/*
+ * Name function: destroyServer
+ * Return: void (it does not return a value)
+ * Arguments: the server
+ * Purpose: stop the workers once the queue is empty and free the server
+ */
+void destroyServer(Server* server) {
+	int i;
+	if(server == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&server->lock);
+	server->stop = 1;
+	pthread_cond_broadcast(&server->ready);
+	pthread_mutex_unlock(&server->lock);
+	for(i = 0; i < server->started; i++) {
+		pthread_join(server->workers[i], NULL);
+	}
+	pthread_mutex_destroy(&server->lock);
+	pthread_cond_destroy(&server->ready);
+	free(server);
+}
+
+/*
+ * Name function: writeAll
+ * Return: 1 if everything was written, 0 otherwise
+ * Arguments: a file descriptor, a text and its length
+ * Purpose: write a text even if the descriptor takes it in several pieces
+ */
+int writeAll(int fd, char* text, long length) {
+	long written;
+	while(length > 0) {
+		written = write(fd, text, length);
+		if(written <= 0) {
+			return 0;
+		}
+		text += written;
+		length -= written;
+	}
+	return 1;
+}
+
+/*
+ * Name function: runBatch
+ * Return: 1 if the answers were written, 0 otherwise
+ * Arguments: the server, the request lines, their number and where to write
+ * Purpose: give every request of a batch to the workers, wait for all of them
+ * and write the answers in the order of the requests
+ */
+int runBatch(Server* server, char** lines, int count, int out) {
+	ServerJob *jobs = (ServerJob*)calloc(count, sizeof(ServerJob));
+	ServerBatch batch;
+	int i, result = 1;
+
+	if(jobs == NULL) {
+		printf("Not enough memory\n");
+		return 0;
+	}
+	batch.left = count;
+	pthread_mutex_init(&batch.lock, NULL);
+	pthread_cond_init(&batch.done, NULL);
+	for(i = 0; i < count; i++) {
+		jobs[i].request = lines[i];
+		jobs[i].batch = &batch;
+		jobs[i].next = (i + 1 < count) ? &jobs[i + 1] : NULL;
+	}
+
+	pthread_mutex_lock(&server->lock);
+	if(server->last != NULL) {
+		server->last->next = &jobs[0];
+	} else {
+		server->first = &jobs[0];
+	}
+	server->last = &jobs[count - 1];
+	pthread_cond_broadcast(&server->ready);
+	pthread_mutex_unlock(&server->lock);
+
+	pthread_mutex_lock(&batch.lock);
+	while(batch.left > 0) {
+		pthread_cond_wait(&batch.done, &batch.lock);
+	}
+	pthread_mutex_unlock(&batch.lock);
+
+	for(i = 0; i < count; i++) {
+		if(result && jobs[i].response.data != NULL) {
+			result = writeAll(out, jobs[i].response.data, jobs[i].response.size);
+		}
+		free(jobs[i].response.data);
+	}
+	pthread_mutex_destroy(&batch.lock);
+	pthread_cond_destroy(&batch.done);
+	free(jobs);
+	return result;
+}
+
+/*
+ * Name function: serveStream
+ * Return: void (it does not return a value)
+ * Arguments: the server and the descriptors it reads from and writes to
+ * Purpose: answer request lines until the end of the input; the complete
+ * lines of every read are one batch
+ */
+void serveStream(Server* server, int in, int out) {
+	TextBuffer input = {NULL, 0, 0};
+	char buffer[BUFLEN], **lines = NULL, *line;
+	long got, start, i;
+	int count, capacity = 0;
+
+	while((got = read(in, buffer, BUFLEN)) > 0) {
+		appendText(&input, buffer, got);
+		if(input.data == NULL) {
+			break;
+		}
+		//split the complete lines
+		count = 0;
+		start = 0;
+		for(i = 0; i < input.size; i++) {
+			if(input.data[i] != '\n') {
+				continue;
+			}
+			input.data[i] = 0;
+			line = skipJsonSpaces(input.data + start);
+			start = i + 1;
+			if(*line == 0) {
+				continue;
+			}
+			if(count == capacity) {
+				char **more = (char**)realloc(lines,
+						sizeof(char*) * (capacity ? capacity * 2 : BUFLEN));
+				if(more == NULL) {
+					printf("Not enough memory\n");
+					break;
+				}
+				lines = more;
+				capacity = capacity ? capacity * 2 : BUFLEN;
+			}
+			lines[count++] = line;
+		}
+		if(count > 0 && runBatch(server, lines, count, out) == 0) {
+			break;
+		}
+		//keep the last line until it is complete
+		memmove(input.data, input.data + start, input.size - start);
+		input.size -= start;
+		input.data[input.size] = 0;
+	}
+	//the last request may not end with a new line
+	if(got == 0 && input.data != NULL && *skipJsonSpaces(input.data) != 0) {
+		line = input.data;
+		runBatch(server, &line, 1, out);
+	}
+	free(input.data);
+	free(lines);
+}
+
+/*
+ * Name function: serveConnection
+ * Return: NULL
+ * Arguments: the connection
+ * Purpose: answer a client of the socket in its own thread
+ */
+void* serveConnection(void* argument) {
+	ServerConnection *connection = (ServerConnection*)argument;
+	serveStream(connection->server, connection->fd, connection->fd);
+	close(connection->fd);
+	free(connection);
+	return NULL;
+}
+
+/*
+ * Name function: serveSocket
+ * Return: 0 if the socket can't be opened (otherwise it does not return)
+ * Arguments: the server and the path of a Unix domain socket
+ * Purpose: accept clients on a socket; every client is served by its own
+ * thread and all of them share the workers
+ */
+int serveSocket(Server* server, char* path) {
+	struct sockaddr_un address;
+	ServerConnection *connection;
+	pthread_t thread;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(fd < 0 || strlen(path) >= sizeof(address.sun_path)) {
+		printf("Can't open the socket %s\n", path);
+		if(fd >= 0) {
+			close(fd);
+		}
+		return 0;
+	}
+	//a client that leaves must not stop the server
+	signal(SIGPIPE, SIG_IGN);
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+	if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+			listen(fd, SERVER_BACKLOG) < 0) {
+		printf("Can't open the socket %s\n", path);
+		close(fd);
+		return 0;
+	}
+	while(1) {
+		connection = (ServerConnection*)malloc(sizeof(ServerConnection));
+		if(connection == NULL) {
+			printf("Not enough memory\n");
+			continue;
+		}
+		connection->server = server;
+		connection->fd = accept(fd, NULL, NULL);
+		if(connection->fd < 0 || pthread_create(&thread, NULL,
+				serveConnection, connection) != 0) {
+			if(connection->fd >= 0) {
+				close(connection->fd);
+			}
+			free(connection);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+}
+
+/*
+ * Name function: serveInput
+ * Return: NULL
+ * Arguments: the server
+ * Purpose: answer the requests of the standard input in its own thread
+ */
+void* serveInput(void* argument) {
+	serveStream((Server*)argument, STDIN_FILENO, STDOUT_FILENO);
+	return NULL;
+}
+
+/*
+ * Name function: runServer
+ * Return: 0 at the end of the input, 1 if the index can't be built
+ * Arguments: the path of a socket (NULL for none), the documents of the corpus
+ * and their number (none means text.txt)
+ * Purpose: build the index once and answer requests from the standard input
+ * and from the socket; with a socket it serves its clients after the end of
+ * the input too
+ */
+int runServer(char* path, char** fileNames, int count) {
+	TTree *tree = (count > 0) ? ingestCorpus(fileNames, count) :
+			buildTreeFromFile("text.txt");
+	Server *server;
+	pthread_t input;
+
+	if(tree == NULL) {
+		return 1;
+	}
+	//the index does not change any more, so the walks can follow memory
+	compact(tree);
+	server = createServer(tree);
+	if(server == NULL) {
+		destroyTree(tree);
+		return 1;
+	}
+	if(path == NULL || pthread_create(&input, NULL, serveInput, server) != 0) {
+		serveInput(server);
+	} else {
+		serveSocket(server, path);
+		pthread_join(input, NULL);
+	}
+	destroyServer(server);
+	destroyTree(tree);
+	return 0;
+}
+
+#endif /* SERVER_H_ */
@@ -0,0 +1,298 @@
+#ifndef STATICINDEX_H_
+#define STATICINDEX_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Dictionary.h"
+
+/*
+ * A read-only copy of a dictionary tree for lookups. The keys have at most
+ * ELEMENT_TREE_LENGTH characters, so every key fits in an int with its
+ * characters from the most significant byte down and 0 after its end; the
+ * ints are ordered like the strings (strcmp compares unsigned chars).
+ * The keys are kept in a static 16-way search tree: every block is one cache
+ * line of STATIC_BLOCK sorted keys and the children of block k are the blocks
+ * k * (STATIC_BLOCK + 1) + i + 1, so there are no pointers to follow and a
+ * lookup touches one line per level instead of one per key.
+ */
+#if ELEMENT_TREE_LENGTH > 3
+#error "StaticIndex.h packs the keys in 24 bits"
+#endif
+
+#define STATIC_BLOCK 16
+#define STATIC_ALIGN 64
+//bigger than every packed key, fills the last block
+#define STATIC_PAD INT32_MAX
+
+typedef struct StaticIndex{
+	//number of distinct keys
+	long size;
+	long blocks;
+	//blocks * STATIC_BLOCK keys, aligned to a cache line
+	int32_t *keys;
+	//the position in the sorted order of every key of the blocks
+	int32_t *order;
+	void *memory;
+	//the keys in sorted order
+	int32_t *sorted;
+	//the postings of key i are postings[start[i]] .. postings[start[i + 1] - 1]
+	long *start;
+	Posting *postings;
+}StaticIndex;
+
+/*
+ * Name function: packKey
+ * Return: the key as an int
+ * Arguments: a string
+ * Purpose: put the first ELEMENT_TREE_LENGTH characters of a string in an int
+ * that compares like the string
+ */
+int32_t packKey(char* s) {
+	int32_t key = 0;
+	int i, end = 0;
+	for(i = 0; i < ELEMENT_TREE_LENGTH; i++) {
+		//nothing after the end of a short string is read
+		if(end == 0 && s[i] == 0) {
+			end = 1;
+		}
+		key = (key << 8) | (end ? 0 : (unsigned char)s[i]);
+	}
+	return key;
+}
+
+/*
+ * Name function: packBound
+ * Return: the smallest packed key that is after every key starting with s
+ * Arguments: a string
+ * Purpose: the keys whose first strlen(s) characters are <= s are the ones
+ * before this bound
+ */
+int32_t packBound(char* s) {
+	int length = strlen(s);
+	if(length >= ELEMENT_TREE_LENGTH) {
+		return packKey(s) + 1;
+	}
+	return packKey(s) + (1 << (8 * (ELEMENT_TREE_LENGTH - length)));
+}
+
+/*
+ * Name function: fillStaticBlocks
+ * Return: void (it does not return a value)
+ * Arguments: the index, the sorted keys, a block and the number of keys placed
+ * so far
+ * Purpose: place the sorted keys in the blocks with an in-order walk of the
+ * implicit tree; the slots left at the end get STATIC_PAD
+ */
+void fillStaticBlocks(StaticIndex* index, int32_t* sorted, long k, long* t) {
+	int i;
+	if(k >= index->blocks) {
+		return;
+	}
+	for(i = 0; i < STATIC_BLOCK; i++) {
+		fillStaticBlocks(index, sorted, k * (STATIC_BLOCK + 1) + i + 1, t);
+		if(*t < index->size) {
+			index->keys[k * STATIC_BLOCK + i] = sorted[*t];
+			index->order[k * STATIC_BLOCK + i] = *t;
+			(*t)++;
+		} else {
+			index->keys[k * STATIC_BLOCK + i] = STATIC_PAD;
+			index->order[k * STATIC_BLOCK + i] = index->size;
+		}
+	}
+	fillStaticBlocks(index, sorted, k * (STATIC_BLOCK + 1) + STATIC_BLOCK + 1, t);
+}
+
+/*
+ * Name function: destroyStaticIndex
+ * Return: void (it does not return a value)
+ * Arguments: the index
+ * Purpose: free the memory of an index
+ */
+void destroyStaticIndex(StaticIndex* index) {
+	if(index == NULL) {
+		return;
+	}
+	free(index->memory);
+	free(index->order);
+	free(index->sorted);
+	free(index->start);
+	free(index->postings);
+	free(index);
+}
+
+/*
+ * Name function: buildStaticIndex
+ * Return: the memory address of the index
+ * Arguments: a dictionary tree
+ * Purpose: copy the keys and the postings of a tree in the static layout; the
+ * postings of a key keep the order of its list of duplicates
+ */
+StaticIndex* buildStaticIndex(TTree* tree) {
+	StaticIndex *index = (StaticIndex*)calloc(1, sizeof(StaticIndex));
+	TreeNode *node, *copy;
+	long count = 0, t = 0;
+
+	if(index == NULL || tree == NULL) {
+		printf("Not enough memory\n");
+		free(index);
+		return NULL;
+	}
+	//the keys deleted by lazyDelete are left out
+	for(node = tree->root ? minimum(tree, tree->root) : NULL; node != NULL;
+			node = node->end->next) {
+		if(!TOMBSTONE(node)) {
+			index->size++;
+			count += node->count;
+		}
+	}
+	index->blocks = (index->size + STATIC_BLOCK - 1) / STATIC_BLOCK;
+	index->memory = malloc(sizeof(int32_t) * (index->blocks * STATIC_BLOCK + 1) +
+			STATIC_ALIGN);
+	index->order = (int32_t*)malloc(sizeof(int32_t) *
+			(index->blocks * STATIC_BLOCK + 1));
+	index->sorted = (int32_t*)malloc(sizeof(int32_t) * (index->size + 1));
+	index->start = (long*)malloc(sizeof(long) * (index->size + 1));
+	index->postings = (Posting*)malloc(sizeof(Posting) * (count + 1));
+	if(index->memory == NULL || index->order == NULL || index->sorted == NULL ||
+			index->start == NULL || index->postings == NULL) {
+		printf("Not enough memory\n");
+		destroyStaticIndex(index);
+		return NULL;
+	}
+	index->keys = (int32_t*)(((uintptr_t)index->memory + STATIC_ALIGN - 1) &
+			~(uintptr_t)(STATIC_ALIGN - 1));
+
+	//the list of the tree is sorted, so the keys come in order
+	count = 0;
+	for(node = tree->root ? minimum(tree, tree->root) : NULL; node != NULL;
+			node = node->end->next) {
+		if(TOMBSTONE(node)) {
+			continue;
+		}
+		index->sorted[t] = packKey(node->elem);
+		index->start[t++] = count;
+		for(copy = node; copy != node->end->next; copy = copy->next) {
+			index->postings[count++] = *((Posting*)copy->info);
+		}
+	}
+	index->start[t] = count;
+	t = 0;
+	fillStaticBlocks(index, index->sorted, 0, &t);
+	return index;
+}
+
+/*
+ * Name function: staticBlockRank
+ * Return: the number of keys of a block that are smaller than x
+ * Arguments: a block and a packed key
+ * Purpose: search inside a block; with SSE2 the 16 keys are compared with x
+ * at once and the results are counted from a mask
+ */
+int staticBlockRank(int32_t* block, int32_t x) {
+#ifdef __SSE2__
+	__m128i value = _mm_set1_epi32(x);
+	__m128i a = _mm_cmpgt_epi32(value, _mm_load_si128((__m128i*)block));
+	__m128i b = _mm_cmpgt_epi32(value, _mm_load_si128((__m128i*)block + 1));
+	__m128i c = _mm_cmpgt_epi32(value, _mm_load_si128((__m128i*)block + 2));
+	__m128i d = _mm_cmpgt_epi32(value, _mm_load_si128((__m128i*)block + 3));
+	//one byte per key, then one bit per key
+	__m128i bytes = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+	return __builtin_popcount(_mm_movemask_epi8(bytes));
+#else
+	int i, rank = 0;
+	for(i = 0; i < STATIC_BLOCK; i++) {
+		rank += block[i] < x;
+	}
+	return rank;
+#endif
+}
+
+/*
+ * Name function: staticLowerBound
+ * Return: the position in the sorted order of the first key >= x, size if
+ * there is none
+ * Arguments: the index and a packed key
+ * Purpose: go down the blocks, remembering the last key >= x seen
+ */
+long staticLowerBound(StaticIndex* index, int32_t x) {
+	long k = 0, bound = index->size;
+	int rank;
+	while(k < index->blocks) {
+		rank = staticBlockRank(index->keys + k * STATIC_BLOCK, x);
+		if(rank < STATIC_BLOCK) {
+			bound = index->order[k * STATIC_BLOCK + rank];
+		}
+		k = k * (STATIC_BLOCK + 1) + rank + 1;
+	}
+	return bound;
+}
+
+/*
+ * Name function: staticSlice
+ * Return: the memory address of the words
+ * Arguments: the index and the keys [first, last) of the sorted order
+ * Purpose: copy the postings of a run of keys into a range
+ */
+Range* staticSlice(StaticIndex* index, long first, long last) {
+	Range *words = createRange();
+	long i;
+	if(words == NULL || index == NULL || first >= last) {
+		return words;
+	}
+	for(i = index->start[first]; i < index->start[last]; i++) {
+		addToRange(words, &index->postings[i]);
+	}
+	return words;
+}
+
+/*
+ * Name function: staticLookup
+ * Return: the memory address of the words
+ * Arguments: the index and a word
+ * Purpose: find the words with the same key as a word
+ */
+Range* staticLookup(StaticIndex* index, char* word) {
+	int32_t key = packKey(word);
+	long first = staticLowerBound(index, key);
+	if(first < index->size && index->sorted[first] == key) {
+		return staticSlice(index, first, first + 1);
+	}
+	return createRange();
+}
+
+/*
+ * Name function: staticPrefixQuery
+ * Return: the memory address of the words
+ * Arguments: the index and the given string
+ * Purpose: the same words as singleKeyRangeQuery
+ */
+Range* staticPrefixQuery(StaticIndex* index, char* q) {
+	//no key is longer than ELEMENT_TREE_LENGTH, so none starts with a longer q
+	if(strlen(q) > ELEMENT_TREE_LENGTH) {
+		return createRange();
+	}
+	return staticSlice(index, staticLowerBound(index, packKey(q)),
+			staticLowerBound(index, packBound(q)));
+}
+
+/*
+ * Name function: staticIntervalQuery
+ * Return: the memory address of the words
+ * Arguments: the index and the two strings q, p
+ * Purpose: the same words as multiKeyRangeQuery
+ */
+Range* staticIntervalQuery(StaticIndex* index, char* q, char* p) {
+	//a q longer than a key is after the key made of its first characters
+	int32_t first = packKey(q) + (strlen(q) > ELEMENT_TREE_LENGTH);
+	return staticSlice(index, staticLowerBound(index, first),
+			staticLowerBound(index, packBound(p)));
+}
+
+#endif /* STATICINDEX_H_ */
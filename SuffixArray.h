@@ -0,0 +1,407 @@
+#ifndef SUFFIXARRAY_H_
+#define SUFFIXARRAY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dictionary.h"
+#include "Scan.h"
+
+/*
+ * Finding the words that contain a string anywhere, not only at their start.
+ * Every different word of a file is put once in a text, followed by
+ * SUFFIX_SEPARATOR, with the offsets of all its copies kept aside, and all
+ * the suffixes of this text are sorted (prefix doubling, with a radix sort
+ * at every step). The suffixes that start with q are then consecutive: a
+ * binary search finds the first one and the LCP array (the common prefix of
+ * every suffix with the one before it) tells where they end. A separator is
+ * not a word character, so a match never goes from one word to the next.
+ */
+#define SUFFIX_SEPARATOR '\n'
+
+typedef struct SuffixWord{
+	char *word;
+	int length;
+	long offset;
+}SuffixWord;
+
+typedef struct SuffixWords{
+	SuffixWord *items;
+	long size, capacity;
+}SuffixWords;
+
+typedef struct SuffixArray{
+	//the different words, each followed by SUFFIX_SEPARATOR, and 0 at the end
+	char *text;
+	long size;
+	//the start of the i-th smallest suffix and its common prefix with the one
+	//before it
+	long *sa;
+	long *lcp;
+	//the word of every character of the text
+	long *owner;
+	//the offsets of word i are offsets[first[i]] .. offsets[first[i + 1] - 1]
+	long *first;
+	long *offsets;
+	long words;
+}SuffixArray;
+
+/*
+ * Name function: destroySuffixArray
+ * Return: void (it does not return a value)
+ * Arguments: the suffix array
+ * Purpose: free the memory of a suffix array
+ */
+void destroySuffixArray(SuffixArray* array) {
+	if(array == NULL) {
+		return;
+	}
+	free(array->text);
+	free(array->sa);
+	free(array->lcp);
+	free(array->owner);
+	free(array->first);
+	free(array->offsets);
+	free(array);
+}
+
+/*
+ * Name function: addSuffixWord
+ * Return: void (it does not return a value)
+ * Arguments: the words found so far (as the context of a scan), the start of
+ * a word and its offset
+ * Purpose: save a whole word with its offset
+ */
+void addSuffixWord(void* context, char* word, long offset) {
+	SuffixWords *words = (SuffixWords*)context;
+	SuffixWord *item;
+	if(words->size == words->capacity) {
+		long capacity = words->capacity ? words->capacity * 2 : BUFLEN;
+		SuffixWord *items = (SuffixWord*)realloc(words->items,
+				sizeof(SuffixWord) * capacity);
+		if(items == NULL) {
+			printf("Not enough memory\n");
+			return;
+		}
+		words->items = items;
+		words->capacity = capacity;
+	}
+	item = &words->items[words->size++];
+	item->word = word;
+	item->offset = offset;
+	for(item->length = 0; isWordChar(word[item->length]); item->length++);
+}
+
+/*
+ * Name function: compareSuffixWords
+ * Return: a negative number, 0 or a positive number, like strcmp
+ * Arguments: two words
+ * Purpose: put the copies of a word together, in the order of the text
+ */
+int compareSuffixWords(const void* a, const void* b) {
+	const SuffixWord *x = (const SuffixWord*)a, *y = (const SuffixWord*)b;
+	int result = memcmp(x->word, y->word, MIN(x->length, y->length));
+	if(result != 0) {
+		return result;
+	}
+	if(x->length != y->length) {
+		return x->length - y->length;
+	}
+	return (x->offset < y->offset) ? -1 : (x->offset > y->offset);
+}
+
+/*
+ * Name function: fillSuffixText
+ * Return: 1 if the text was made, 0 otherwise
+ * Arguments: the suffix array and the sorted words
+ * Purpose: put every different word once in the text and its offsets aside
+ */
+int fillSuffixText(SuffixArray* array, SuffixWords* words) {
+	long i, j, distinct = 0, size = 0;
+	SuffixWord *item;
+	for(i = 0; i < words->size; i++) {
+		item = &words->items[i];
+		if(i == 0 || item->length != item[-1].length ||
+				memcmp(item->word, item[-1].word, item->length) != 0) {
+			distinct++;
+			size += item->length + 1;
+		}
+	}
+	array->text = (char*)malloc(size + 1);
+	array->sa = (long*)malloc(sizeof(long) * (size + 1));
+	array->lcp = (long*)malloc(sizeof(long) * (size + 1));
+	array->owner = (long*)malloc(sizeof(long) * (size + 1));
+	array->first = (long*)malloc(sizeof(long) * (distinct + 1));
+	array->offsets = (long*)malloc(sizeof(long) * (words->size + 1));
+	if(array->text == NULL || array->sa == NULL || array->lcp == NULL ||
+			array->owner == NULL || array->first == NULL ||
+			array->offsets == NULL) {
+		printf("Not enough memory\n");
+		return 0;
+	}
+	for(i = 0; i < words->size; i++) {
+		item = &words->items[i];
+		if(i == 0 || item->length != item[-1].length ||
+				memcmp(item->word, item[-1].word, item->length) != 0) {
+			array->first[array->words] = i;
+			memcpy(array->text + array->size, item->word, item->length);
+			for(j = 0; j <= item->length; j++) {
+				array->owner[array->size + j] = array->words;
+			}
+			array->size += item->length;
+			array->text[array->size++] = SUFFIX_SEPARATOR;
+			array->words++;
+		}
+		array->offsets[i] = item->offset;
+	}
+	array->first[array->words] = words->size;
+	array->text[array->size] = 0;
+	return 1;
+}
+
+/*
+ * Name function: sortSuffixes
+ * Return: 1 if the suffixes were sorted, 0 otherwise
+ * Arguments: the suffix array
+ * Purpose: sort the suffixes by their first 2^k characters for k = 0, 1, ...
+ * until they are all different; every step is a radix sort of the pairs of
+ * ranks of the step before
+ */
+int sortSuffixes(SuffixArray* array) {
+	long n = array->size, i, k, classes, a, b;
+	long *rank = (long*)malloc(sizeof(long) * (n + 1));
+	long *other = (long*)malloc(sizeof(long) * (n + 1));
+	long *count = (long*)malloc(sizeof(long) * (n + 256));
+	long *sa = array->sa;
+
+	if(rank == NULL || other == NULL || count == NULL) {
+		printf("Not enough memory\n");
+		free(rank);
+		free(other);
+		free(count);
+		return 0;
+	}
+	//sort by the first character
+	memset(count, 0, sizeof(long) * 256);
+	for(i = 0; i < n; i++) {
+		count[(unsigned char)array->text[i]]++;
+	}
+	for(i = 1; i < 256; i++) {
+		count[i] += count[i - 1];
+	}
+	for(i = n - 1; i >= 0; i--) {
+		sa[--count[(unsigned char)array->text[i]]] = i;
+	}
+	for(i = 0; i < n; i++) {
+		rank[sa[i]] = (i > 0 && array->text[sa[i]] == array->text[sa[i - 1]]) ?
+				rank[sa[i - 1]] : i;
+	}
+
+	for(k = 1; k < n; k *= 2) {
+		//by the rank of the second half: the suffixes without one come first
+		classes = 0;
+		for(i = n - k; i < n; i++) {
+			other[classes++] = i;
+		}
+		for(i = 0; i < n; i++) {
+			if(sa[i] >= k) {
+				other[classes++] = sa[i] - k;
+			}
+		}
+		//then stable by the rank of the first half
+		memset(count, 0, sizeof(long) * n);
+		for(i = 0; i < n; i++) {
+			count[rank[i]]++;
+		}
+		for(i = 1; i < n; i++) {
+			count[i] += count[i - 1];
+		}
+		for(i = n - 1; i >= 0; i--) {
+			sa[--count[rank[other[i]]]] = other[i];
+		}
+		//the new rank of a suffix is the position of the first equal one
+		other[sa[0]] = 0;
+		classes = 1;
+		for(i = 1; i < n; i++) {
+			a = sa[i - 1];
+			b = sa[i];
+			if(rank[a] == rank[b] && (a + k < n ? rank[a + k] : -1) ==
+					(b + k < n ? rank[b + k] : -1)) {
+				other[b] = other[a];
+			} else {
+				other[b] = i;
+				classes++;
+			}
+		}
+		memcpy(rank, other, sizeof(long) * n);
+		if(classes == n) {
+			break;
+		}
+	}
+	free(rank);
+	free(other);
+	free(count);
+	return 1;
+}
+
+/*
+ * Name function: computeLcp
+ * Return: 1 if the array was computed, 0 otherwise
+ * Arguments: the suffix array
+ * Purpose: Kasai's algorithm: going through the suffixes in text order, the
+ * common prefix with the suffix before drops by at most one each time
+ */
+int computeLcp(SuffixArray* array) {
+	long n = array->size, i, j, h = 0;
+	long *rank = (long*)malloc(sizeof(long) * (n + 1));
+	if(rank == NULL) {
+		printf("Not enough memory\n");
+		return 0;
+	}
+	for(i = 0; i < n; i++) {
+		rank[array->sa[i]] = i;
+	}
+	for(i = 0; i < n; i++) {
+		if(rank[i] == 0) {
+			array->lcp[0] = 0;
+			h = 0;
+			continue;
+		}
+		j = array->sa[rank[i] - 1];
+		while(array->text[i + h] == array->text[j + h] && array->text[i + h] != 0) {
+			h++;
+		}
+		array->lcp[rank[i]] = h;
+		if(h > 0) {
+			h--;
+		}
+	}
+	free(rank);
+	return 1;
+}
+
+/*
+ * Name function: buildSuffixArrayFromFile
+ * Return: the memory address of the suffix array
+ * Arguments: the file that I read from
+ * Purpose: index every substring of the words of a file
+ */
+SuffixArray* buildSuffixArrayFromFile(char* fileName) {
+	SuffixArray *array = (SuffixArray*)calloc(1, sizeof(SuffixArray));
+	SuffixWords words = {NULL, 0, 0};
+	long size;
+	char *buffer = readFile(fileName, &size);
+	int built;
+
+	if(array == NULL || buffer == NULL) {
+		if(array == NULL) {
+			printf("Not enough memory\n");
+		}
+		free(array);
+		free(buffer);
+		return NULL;
+	}
+	scanText(buffer, size, 0, addSuffixWord, &words);
+	if(words.size > 0) {
+		qsort(words.items, words.size, sizeof(SuffixWord), compareSuffixWords);
+	}
+	built = fillSuffixText(array, &words);
+	free(words.items);
+	free(buffer);
+	if(built == 0 || sortSuffixes(array) == 0 || computeLcp(array) == 0) {
+		destroySuffixArray(array);
+		return NULL;
+	}
+	return array;
+}
+
+/*
+ * Name function: compareLongs
+ * Return: a negative number, 0 or a positive number, like strcmp
+ * Arguments: two longs
+ * Purpose: sort the words of the matches
+ */
+int compareLongs(const void* a, const void* b) {
+	long x = *(const long*)a, y = *(const long*)b;
+	return (x < y) ? -1 : (x > y);
+}
+
+/*
+ * Name function: infixQuery
+ * Return: the memory address of the words
+ * Arguments: the suffix array and the given string
+ * Purpose: find the words that contain q, in the order of the text, in
+ * O(|q| log n) for the first match and O(k log k) for the k matches
+ */
+Range* infixQuery(SuffixArray* array, char* q) {
+	Range *words = createRange();
+	long length = strlen(q), low = 0, high, middle, i, j, count = 0;
+	long *found, *offsets;
+
+	if(words == NULL || array == NULL || array->size == 0) {
+		return words;
+	}
+	for(i = 0; i < length; i++) {
+		if(!isWordChar(q[i])) {
+			return words;
+		}
+	}
+	//the first suffix that is not smaller than q
+	high = array->size;
+	while(low < high) {
+		middle = (low + high) / 2;
+		if(strncmp(array->text + array->sa[middle], q, length) < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if(low == array->size ||
+			strncmp(array->text + array->sa[low], q, length) != 0) {
+		return words;
+	}
+	//the next suffixes share at least |q| characters with it
+	for(high = low + 1; high < array->size && array->lcp[high] >= length;
+			high++);
+
+	//a word can contain q more than once
+	found = (long*)malloc(sizeof(long) * (high - low));
+	if(found == NULL) {
+		printf("Not enough memory\n");
+		return words;
+	}
+	for(i = low; i < high; i++) {
+		found[i - low] = array->owner[array->sa[i]];
+	}
+	qsort(found, high - low, sizeof(long), compareLongs);
+	for(i = 0, j = 0; i < high - low; i++) {
+		if(i == 0 || found[i] != found[j - 1]) {
+			found[j++] = found[i];
+			count += array->first[found[i] + 1] - array->first[found[i]];
+		}
+	}
+
+	//the copies of the words, in the order of the text
+	offsets = (long*)malloc(sizeof(long) * count);
+	if(offsets == NULL) {
+		printf("Not enough memory\n");
+		free(found);
+		return words;
+	}
+	for(i = 0, count = 0; i < j; i++) {
+		memcpy(offsets + count, array->offsets + array->first[found[i]],
+				sizeof(long) * (array->first[found[i] + 1] - array->first[found[i]]));
+		count += array->first[found[i] + 1] - array->first[found[i]];
+	}
+	qsort(offsets, count, sizeof(long), compareLongs);
+	for(i = 0; i < count; i++) {
+		Posting posting = {offsets[i], 0, 0};
+		addToRange(words, &posting);
+	}
+	free(offsets);
+	free(found);
+	return words;
+}
+
+#endif /* SUFFIXARRAY_H_ */
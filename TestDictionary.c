@@ -2,6 +2,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include "AVLTree.h"
+#include "Query.h"
+#include "BucketIndex.h"
+#include "StaticIndex.h"
+#include "ParallelQuery.h"
+#include "Server.h"
+#include "Ingest.h"
+#include "Scan.h"
+#include "Fuzzy.h"
+#include "SuffixArray.h"
+#include "FrontCoding.h"
+#include "LSMTree.h"
+#include "DocStore.h"
 
 void* createLong(void* value){
 	long *l = malloc(sizeof(long));
@@ -13,6 +25,10 @@ void destroyLong(void* value){
 	free((long*)value);
 }
 
+unsigned long hashLong(void* value){
+	return (unsigned long)(*((long*)value)) * 2654435761ul;
+}
+
 int compareLong(void* a, void* b){
 	if(*((long*)a) < *((long*)b))
 		return -1;
@@ -354,6 +370,72 @@ int testTreeListDelete(TTree **tree, float score) {
 	return 1;
 }
 
+long checkBalance(TreeNode* node) {                  // height or -1 if broken
+	if(node == NULL)
+		return 0;
+	long hl = checkBalance(node->lt);
+	long hr = checkBalance(node->rt);
+	if(hl < 0 || hr < 0 || labs(hl - hr) > 1 || node->height != MAX(hl, hr) + 1)
+		return -1;
+	if((node->lt != NULL && node->lt->pt != node) ||
+			(node->rt != NULL && node->rt->pt != node))
+		return -1;
+	return node->height;
+}
+
+long checkRanks(TreeNode* node) {                    // rank + 1 or -1
+	if(node == NULL)
+		return 0;
+	long rl = checkRanks(node->lt);
+	long rr = checkRanks(node->rt);
+	if(rl < 0 || rr < 0 || node->height - rl < 1 || node->height - rl > 2 ||
+			node->height - rr < 1 || node->height - rr > 2)
+		return -1;
+	if(node->lt == NULL && node->rt == NULL && node->height != 1)
+		return -1;
+	if((node->lt != NULL && node->lt->pt != node) ||
+			(node->rt != NULL && node->rt->pt != node))
+		return -1;
+	return node->height;
+}
+
+long checkCounts(TreeNode* node) {                   // max count or -1
+	if(node == NULL)
+		return 0;
+	long count = 1;
+	for(TreeNode* dup = node; dup != node->end; dup = dup->next)
+		count++;
+	long ml = checkCounts(node->lt);
+	long mr = checkCounts(node->rt);
+	if(ml < 0 || mr < 0 || count != node->count ||
+			node->maxCount != MAX(count, MAX(ml, mr)))
+		return -1;
+	return node->maxCount;
+}
+
+int checkList(TTree* tree, long* values, long n) {   // list equals values
+	TreeNode* node = minimum(tree, tree->root);
+	long i;
+	if(node != NULL && node->prev != NULL)
+		return 0;
+	for(i = 0; i < n; i++, node = node->next) {
+		if(node == NULL || *((long*)node->elem) != values[i])
+			return 0;
+		if(node->next != NULL && node->next->prev != node)
+			return 0;
+	}
+	return node == NULL;
+}
+
+TTree* createLongTree(long first, long last) {
+	TTree* tree = createTree(createLong, destroyLong,
+			createLong, destroyLong,
+			compareLong);
+	for(long i = first; i <= last; i++)
+		insert(tree, &i, &i);
+	return tree;
+}
+
 int testFree(TTree **tree, float score) {
 	destroyTree(*tree);
 	printf(". Testul Destroy: *Se va verifica cu valgrind*\t\t Puncte: %.3f\n", score);
@@ -361,6 +443,1331 @@ int testFree(TTree **tree, float score) {
 	return 1;
 }
 
+int testSplitJoin(TTree **tree, float score) {
+	long values[] = {0, 1, 2, 3, 4, 5, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+	long value = 5;
+	*tree = createLongTree(0, 14);
+	insert(*tree, &value, &value);
+
+	value = 6;
+	TTree* right = splitTree(*tree, &value);
+	ASSERT(checkBalance((*tree)->root) >= 0, "Split-01");
+	ASSERT(checkBalance(right->root) >= 0, "Split-02");
+	ASSERT(checkList(*tree, values, 7), "Split-03");
+	ASSERT(checkList(right, values + 7, 9), "Split-04");
+	ASSERT(right->size == 9, "Split-05");
+	//the duplicate of 5 stays in the size of the left tree
+	ASSERT((*tree)->size == 7, "Split-08");
+
+	joinTrees(*tree, right);
+	ASSERT(checkBalance((*tree)->root) >= 0, "Join-01");
+	ASSERT(checkList(*tree, values, 16), "Join-02");
+	ASSERT(*((long*)search(*tree, (*tree)->root, &value)->elem) == 6l, "Join-03");
+
+	value = 20;
+	right = splitTree(*tree, &value);
+	ASSERT(right->root == NULL && checkList(*tree, values, 16), "Split-06");
+	joinTrees(*tree, right);
+
+	value = -1;
+	right = splitTree(*tree, &value);
+	ASSERT((*tree)->root == NULL && checkList(right, values, 16), "Split-07");
+	joinTrees(*tree, right);
+	ASSERT(checkList(*tree, values, 16), "Join-04");
+	//the duplicate of 5 is counted in the size of the tree
+	ASSERT((*tree)->size == 16, "Join-05");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed2("Split&Join", score);
+	return 1;
+}
+
+int testUnion(TTree **tree, float score) {
+	long values[] = {0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 7, 8, 9, 10, 11, 12};
+	*tree = createLongTree(0, 6);
+	TTree* other = createLongTree(4, 12);
+
+	unionTrees(*tree, other);
+	ASSERT(checkBalance((*tree)->root) >= 0, "Union-01");
+	ASSERT(checkList(*tree, values, 16), "Union-02");
+	long value = 5;
+	TreeNode* node = search(*tree, (*tree)->root, &value);
+	ASSERT(node->next == node->end && node->end->next != NULL, "Union-03");
+
+	other = createLongTree(2, 3);
+	joinTrees(*tree, other);
+	ASSERT(checkBalance((*tree)->root) >= 0, "Union-04");
+	value = 3;
+	node = search(*tree, (*tree)->root, &value);
+	ASSERT(node != node->end, "Union-05");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Union", score);
+	return 1;
+}
+
+int testDeleteRange(TTree **tree, float score) {
+	long values[] = {0, 1, 2, 13, 14, 15, 16, 17, 18, 19};
+	long q = 3, p = 12, i;
+	*tree = createLongTree(0, 19);
+	insert(*tree, &q, &q);
+	insert(*tree, &p, &p);
+
+	deleteRange(*tree, &q, &p);
+	ASSERT(checkBalance((*tree)->root) >= 0, "DeleteRange-01");
+	ASSERT(checkList(*tree, values, 10), "DeleteRange-02");
+	ASSERT(search(*tree, (*tree)->root, &q) == NULL, "DeleteRange-03");
+	//the duplicates of 3 and 12 were counted when inserted and when deleted
+	ASSERT((*tree)->size == 10, "DeleteRange-11");
+
+	q = 15;
+	p = 14;
+	deleteRange(*tree, &q, &p);
+	ASSERT(checkList(*tree, values, 10), "DeleteRange-04");
+
+	q = -5;
+	p = 0;
+	deleteRange(*tree, &q, &p);
+	ASSERT(checkList(*tree, values + 1, 9), "DeleteRange-05");
+
+	q = 16;
+	p = 100;
+	deleteRange(*tree, &q, &p);
+	ASSERT(checkBalance((*tree)->root) >= 0, "DeleteRange-06");
+	ASSERT(checkList(*tree, values + 1, 5), "DeleteRange-07");
+
+	q = 0;
+	deleteRange(*tree, &q, &p);
+	ASSERT((*tree)->root == NULL, "DeleteRange-08");
+	ASSERT((*tree)->size == 0, "DeleteRange-12");
+	free(*tree);
+
+	// Large tree, many ranges
+	*tree = createLongTree(0, 999);
+	for(i = 0; i < 1000; i += 50) {
+		q = i + 10;
+		p = i + 29;
+		deleteRange(*tree, &q, &p);
+		ASSERT(checkBalance((*tree)->root) >= 0, "DeleteRange-09");
+	}
+	ASSERT(countList(minimum(*tree, (*tree)->root)) == 600, "DeleteRange-10");
+	ASSERT((*tree)->size == 600, "DeleteRange-13");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed2("Delete-Range", score);
+	return 1;
+}
+
+int testCounts(TTree **tree, float score) {
+	long values[] = {5, 5, 5, 2, 9, 9, 1, 7, 5};
+	long value, i;
+	*tree = createLongTree(0, 0);
+	for(i = 0; i < sizeof(values)/sizeof(values[0]); i++)
+		insert(*tree, values + i, values + i);
+
+	value = 5;
+	ASSERT(search(*tree, (*tree)->root, &value)->count == 4, "Counts-01");
+	ASSERT((*tree)->root->maxCount == 4, "Counts-02");
+	ASSERT(checkCounts((*tree)->root) == 4, "Counts-03");
+
+	delete(*tree, &value);
+	delete(*tree, &value);
+	ASSERT(search(*tree, (*tree)->root, &value)->count == 2, "Counts-04");
+	ASSERT(checkCounts((*tree)->root) == 2, "Counts-05");
+
+	delete(*tree, &value);
+	delete(*tree, &value);
+	value = 9;
+	ASSERT(checkCounts((*tree)->root) == 2, "Counts-06");
+	delete(*tree, &value);
+	ASSERT(checkCounts((*tree)->root) == 1, "Counts-07");
+	destroyTree(*tree);
+
+	// Random inserts and deletes keep heights, lists and counts right
+	srand(42);
+	*tree = createLongTree(0, 0);
+	for(i = 0; i < 5000; i++) {
+		value = rand() % 200;
+		if(rand() % 3)
+			insert(*tree, &value, &value);
+		else if(search(*tree, (*tree)->root, &value) != NULL)
+			delete(*tree, &value);
+		ASSERT(checkBalance((*tree)->root) >= 0, "Counts-08");
+		ASSERT(checkCounts((*tree)->root) >= 0, "Counts-09");
+	}
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Counts", score);
+	return 1;
+}
+
+TreeNode* searchInTree(TTree* tree, long value) {      // search without hash
+	TreeNode* node = tree->root;
+	while(node != NULL && *((long*)node->elem) != value)
+		node = (*((long*)node->elem) > value) ? node->lt : node->rt;
+	return node;
+}
+
+int checkHash(TTree* tree, long last) {
+	for(long value = -1; value <= last; value++)
+		if(search(tree, tree->root, &value) != searchInTree(tree, value))
+			return 0;
+	return tree->hashIndex != NULL;
+}
+
+int testHashIndex(TTree **tree, float score) {
+	long value, q, p, i;
+	*tree = createLongTree(0, 99);
+	ASSERT(enableHashIndex(*tree, hashLong) == 1, "Hash-01");
+	ASSERT((*tree)->hashIndex->size == 100, "Hash-02");
+	ASSERT(checkHash(*tree, 120), "Hash-03");
+
+	srand(7);
+	for(i = 0; i < 3000; i++) {
+		value = rand() % 120;
+		if(rand() % 2)
+			insert(*tree, &value, &value);
+		else
+			delete(*tree, &value);
+	}
+	ASSERT(checkHash(*tree, 120), "Hash-04");
+
+	q = 10;
+	p = 30;
+	deleteRange(*tree, &q, &p);
+	ASSERT(checkHash(*tree, 120), "Hash-05");
+
+	value = 60;
+	TTree* right = splitTree(*tree, &value);
+	ASSERT(checkHash(*tree, 120) && checkHash(right, 120), "Hash-06");
+	joinTrees(*tree, right);
+	ASSERT(checkHash(*tree, 120), "Hash-07");
+
+	TTree* other = createLongTree(50, 150);
+	unionTrees(*tree, other);
+	ASSERT(checkHash(*tree, 160), "Hash-08");
+	long keys = 0;
+	for(TreeNode* node = minimum(*tree, (*tree)->root); node != NULL;
+			node = node->end->next)
+		keys++;
+	ASSERT((*tree)->hashIndex->size == keys, "Hash-09");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Hash-Index", score);
+	return 1;
+}
+
+int testBatch(TTree **tree, float score) {
+	long values[100], i;
+	void* keys[100];
+	TreeNode* out[100];
+	*tree = createLongTree(0, 0);
+	for(i = 0; i < 60; i++) {
+		values[i] = 2 * i;
+		insert(*tree, values + i, values + i);
+	}
+	for(i = 0; i < 100; i++) {
+		values[i] = 130 - i;
+		keys[i] = values + i;
+	}
+
+	searchBatch(*tree, keys, 100, out);
+	for(i = 0; i < 100; i++)
+		ASSERT(out[i] == search(*tree, (*tree)->root, keys[i]), "Batch-01");
+
+	lowerBoundBatch(*tree, keys, 100, out);
+	for(i = 0; i < 100; i++)
+		ASSERT(out[i] == lowerBoundNode(*tree, keys[i]), "Batch-02");
+	ASSERT(out[0] == NULL, "Batch-03");
+	ASSERT(*((long*)out[99]->elem) == 32, "Batch-04");
+	ASSERT(out[11] == NULL && *((long*)out[12]->elem) == 118, "Batch-05");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Batch", score);
+	return 1;
+}
+
+int testWavl(TTree **tree, float score) {
+	long value, i, n = 0, values[6000];
+	*tree = createLongTree(0, 0);
+	ASSERT(setTreePolicy(*tree, TREE_WAVL) == 1, "WAVL-01");
+	ASSERT(setTreePolicy(*tree, TREE_AVL) == 0, "WAVL-02");
+
+	// Random inserts and deletes keep ranks, lists and counts right
+	srand(11);
+	for(i = 0; i < 6000; i++) {
+		value = rand() % 300;
+		if(rand() % 2)
+			insert(*tree, &value, &value);
+		else
+			delete(*tree, &value);
+		ASSERT(checkRanks((*tree)->root) >= 0, "WAVL-03");
+		ASSERT(checkCounts((*tree)->root) >= 0, "WAVL-04");
+	}
+	for(TreeNode* node = minimum(*tree, (*tree)->root); node != NULL;
+			node = node->next)
+		values[n++] = *((long*)node->elem);
+	ASSERT(n == (*tree)->size, "WAVL-05");
+
+	value = 150;
+	TTree* right = splitTree(*tree, &value);
+	ASSERT(right->policy == TREE_WAVL, "WAVL-06");
+	ASSERT(checkRanks((*tree)->root) >= 0 && checkRanks(right->root) >= 0,
+			"WAVL-07");
+	joinTrees(*tree, right);
+	ASSERT(checkRanks((*tree)->root) >= 0, "WAVL-08");
+	ASSERT(checkList(*tree, values, n), "WAVL-09");
+
+	destroyTree(*tree);
+
+	// Joining a key at the right of a spine of 2,2 nodes keeps the ranks
+	*tree = createLongTree(0, 0);
+	setTreePolicy(*tree, TREE_WAVL);
+	for(value = 1; value < 52; value++)
+		insert(*tree, &value, &value);
+	n = 0;
+	for(value = 0; value < 52; value++)
+		if(value % 3)
+			delete(*tree, &value);
+		else
+			values[n++] = value;
+	values[n++] = 52;
+	right = createLongTree(52, 52);
+	joinTrees(*tree, right);
+	ASSERT(checkRanks((*tree)->root) >= 0, "WAVL-10");
+	ASSERT(checkList(*tree, values, n), "WAVL-11");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("WAVL", score);
+	return 1;
+}
+
+int testCursor(TTree **tree, float score) {
+	long values[] = {1, 3, 3, 3, 5, 7, 7, 9};
+	long value, i;
+	*tree = createLongTree(1, 0);
+	for(i = 7; i >= 0; i--)
+		insert(*tree, values + i, values + i);
+
+	value = 3;
+	TreeCursor cursor = lowerBound(*tree, &value);
+	ASSERT(cursor.node == search(*tree, (*tree)->root, &value), "Cursor-01");
+	cursor = upperBound(*tree, &value);
+	ASSERT(*((long*)cursor.node->elem) == 5, "Cursor-02");
+	value = 10;
+	ASSERT(upperBound(*tree, &value).node == NULL, "Cursor-03");
+
+	// Forwards and backwards over every copy
+	cursor = cursorFirst(*tree);
+	for(i = 0; i < 8; i++) {
+		ASSERT(cursor.node != NULL &&
+				*((long*)cursor.node->elem) == values[i], "Cursor-04");
+		ASSERT(*((long*)cursor.head->elem) == values[i], "Cursor-05");
+		cursorNext(&cursor);
+	}
+	ASSERT(cursor.node == NULL, "Cursor-06");
+	for(i = 7; i >= 0; i--) {
+		ASSERT(cursorPrev(&cursor) == 1, "Cursor-07");
+		ASSERT(*((long*)cursor.node->elem) == values[i] &&
+				*((long*)cursor.head->elem) == values[i], "Cursor-08");
+	}
+	ASSERT(cursorPrev(&cursor) == 0, "Cursor-09");
+
+	// Key by key, and seeking backwards
+	value = 4;
+	ASSERT(cursorSeek(&cursor, &value) == 1, "Cursor-10");
+	ASSERT(cursorNextKey(&cursor) == 1 &&
+			*((long*)cursor.node->elem) == 7, "Cursor-11");
+	ASSERT(cursorNextKey(&cursor) == 1 &&
+			*((long*)cursor.node->elem) == 9, "Cursor-12");
+	ASSERT(cursorNextKey(&cursor) == 0, "Cursor-13");
+	ASSERT(cursorPrevKey(&cursor) == 1 &&
+			*((long*)cursor.node->elem) == 9, "Cursor-14");
+	ASSERT(cursorPrevKey(&cursor) == 1 && cursorPrevKey(&cursor) == 1 &&
+			cursor.node == cursor.head &&
+			*((long*)cursor.node->elem) == 5, "Cursor-15");
+	value = 2;
+	ASSERT(cursorSeek(&cursor, &value) == 1 && cursor.node->next->prev ==
+			cursor.node && *((long*)cursor.node->elem) == 3, "Cursor-16");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Cursor", score);
+	return 1;
+}
+
+int testLazyDelete(TTree **tree, float score) {
+	long values[] = {1, 3, 3, 3, 5, 7, 7, 9}, left[] = {1, 3, 3, 5, 9};
+	long value, i, counts[100] = {0}, size = 0;
+	*tree = createLongTree(1, 0);
+	setPurgeRatio(*tree, 0.9);
+	for(i = 7; i >= 0; i--)
+		insert(*tree, values + i, values + i);
+	TreeNode* root = (*tree)->root;
+
+	// A deleted key stays in the tree, but nothing finds it
+	value = 5;
+	lazyDelete(*tree, &value);
+	ASSERT(search(*tree, (*tree)->root, &value) == NULL, "Lazy-01");
+	ASSERT((*tree)->size == 7 && (*tree)->tombstones == 1, "Lazy-02");
+	ASSERT((*tree)->root == root && checkBalance(root) >= 0, "Lazy-03");
+	value = 4;
+	ASSERT(*((long*)lowerBound(*tree, &value).node->elem) == 7, "Lazy-04");
+	value = 3;
+	lazyDelete(*tree, &value);
+	ASSERT(search(*tree, (*tree)->root, &value)->count == 2 &&
+			(*tree)->tombstones == 1, "Lazy-05");
+	value = 7;
+	lazyDeleteKey(*tree, &value);
+	ASSERT(search(*tree, (*tree)->root, &value) == NULL, "Lazy-06");
+	ASSERT((*tree)->size == 4 && (*tree)->tombstones == 3, "Lazy-07");
+	TreeCursor cursor = cursorFirst(*tree);
+	cursorNextKey(&cursor);
+	ASSERT(cursorNextKey(&cursor) == 1 &&
+			*((long*)cursor.node->elem) == 9, "Lazy-08");
+
+	// An insert brings a key back, the purge takes the rest out
+	value = 5;
+	insert(*tree, &value, &value);
+	ASSERT(search(*tree, (*tree)->root, &value)->count == 1, "Lazy-09");
+	ASSERT((*tree)->size == 5 && (*tree)->tombstones == 2, "Lazy-10");
+	purgeTombstones(*tree);
+	ASSERT((*tree)->tombstones == 0 && checkList(*tree, left, 5), "Lazy-11");
+	ASSERT(checkBalance((*tree)->root) >= 0, "Lazy-12");
+	ASSERT(checkCounts((*tree)->root) == 2, "Lazy-13");
+	destroyTree(*tree);
+
+	// Random lazy deletions purge as they go
+	srand(7);
+	*tree = createLongTree(1, 0);
+	setPurgeRatio(*tree, 0.1);
+	for(i = 0; i < 5000; i++) {
+		value = rand() % 100;
+		if(rand() % 2) {
+			insert(*tree, &value, &value);
+			counts[value]++;
+			size++;
+		} else if(rand() % 4) {
+			lazyDelete(*tree, &value);
+			size -= counts[value] > 0;
+			counts[value] -= counts[value] > 0;
+		} else {
+			lazyDeleteKey(*tree, &value);
+			size -= counts[value];
+			counts[value] = 0;
+		}
+		TreeNode* node = search(*tree, (*tree)->root, &value);
+		ASSERT(counts[value] == (node ? node->count : 0), "Lazy-14");
+		ASSERT((*tree)->size == size && checkBalance((*tree)->root) >= 0,
+				"Lazy-15");
+	}
+	purgeTombstones(*tree);
+	ASSERT((*tree)->tombstones == 0 && checkCounts((*tree)->root) >= 0,
+			"Lazy-16");
+	ASSERT(countList(minimum(*tree, (*tree)->root)) == size, "Lazy-17");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Lazy-Delete", score);
+	return 1;
+}
+
+void writeTexts(char** names, char** texts, int count) {
+	for(int i = 0; i < count; i++) {
+		FILE* out = fopen(names[i], "w");
+		fputs(texts[i], out);
+		fclose(out);
+	}
+}
+
+void removeTexts(char** names, int count) {
+	for(int i = 0; i < count; i++)
+		remove(names[i]);
+}
+
+TTree* createTextTree(char** texts, int count) {    // one document per text
+	char* names[] = {"test_text_0.txt", "test_text_1.txt", "test_text_2.txt"};
+	writeTexts(names, texts, count);
+	TTree* tree = buildTreeFromCorpus(names, count);
+	removeTexts(names, count);
+	return tree;
+}
+
+int checkWords(Range* words, long* pairs, long n) {  // (doc, offset) pairs
+	int ok = words != NULL && words->size == n;
+	for(long i = 0; ok && i < n; i++)
+		ok = words->doc[i] == pairs[2 * i] && words->index[i] == pairs[2 * i + 1];
+	destroyRange(words);
+	return ok;
+}
+
+int checkQuery(TTree* tree, char* text, long* pairs, long n) {
+	Query* query = parseQuery(text);
+	if(query == NULL)
+		return 0;
+	int ok = checkWords(booleanQuery(tree, query, 3), pairs, n);
+	destroyQuery(query);
+	return ok;
+}
+
+char* corpusTexts[] = {
+	"the cat sat on the mat.\n",
+	"a dog and a cat.\n",
+	"the dog barked.\n",
+};
+
+int testBoolean(TTree **tree, float score) {
+	long and[] = {1, 2, 1, 12};
+	long or[] = {0, 4, 1, 12, 2, 8};
+	long andNot[] = {0, 0, 0, 15};
+	long group[] = {0, 0, 0, 4, 0, 15, 2, 0, 2, 4};
+	long interval[] = {1, 0, 1, 2, 1, 6, 1, 10, 2, 4, 2, 8};
+	*tree = createTextTree(corpusTexts, 3);
+
+	ASSERT(checkQuery(*tree, "cat AND dog", and, 2), "Boolean-01");
+	ASSERT(checkQuery(*tree, "cat dog", and, 2), "Boolean-02");
+	ASSERT(checkQuery(*tree, "cat OR bark", or, 3), "Boolean-03");
+	ASSERT(checkQuery(*tree, "the AND NOT dog", andNot, 2), "Boolean-04");
+	ASSERT(checkQuery(*tree, "(cat OR dog) AND the", group, 5), "Boolean-05");
+	ASSERT(checkQuery(*tree, "a..b AND dog", interval, 6), "Boolean-06");
+	// Only negated terms: the documents match, but there are no words
+	ASSERT(checkQuery(*tree, "NOT cat", NULL, 0), "Boolean-07");
+
+	// Malformed queries are refused instead of cut short
+	ASSERT(parseQuery("") == NULL && parseQuery("cat OR") == NULL,
+			"Boolean-08");
+	ASSERT(parseQuery("(cat") == NULL && parseQuery("cat ) dog") == NULL,
+			"Boolean-09");
+	ASSERT(parseQuery("cat AND") == NULL && parseQuery("NOT") == NULL &&
+			parseQuery("()") == NULL, "Boolean-10");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Boolean", score);
+	return 1;
+}
+
+char* phraseTexts[] = {
+	"the cat sat on the mat.\n",
+	"them catalog and the dog.\n",
+	"a cat and the cat.\n",
+};
+
+int testPhrase(TTree **tree, float score) {
+	long phrase[] = {0, 0, 1, 0, 2, 10};
+	long near[] = {0, 4, 1, 5, 2, 14};
+	long dog[] = {1, 17}, mat[] = {0, 19}, none[] = {0};
+	*tree = createTextTree(phraseTexts, 3);
+
+	// The words are matched on their 3-character keys, so "them catalog" is
+	// a "the cat" too
+	ASSERT(checkWords(phraseQuery(*tree, "the cat"), phrase, 3), "Phrase-01");
+	ASSERT(checkWords(phraseQuery(*tree, "the cat sat on"), phrase, 1),
+			"Phrase-02");
+	ASSERT(checkWords(phraseQuery(*tree, "cat the"), none, 0), "Phrase-03");
+	ASSERT(checkWords(phraseQuery(*tree, "the dog"), dog, 1), "Phrase-04");
+	ASSERT(checkWords(proximityQuery(*tree, "cat", "the", 1), near, 3),
+			"Phrase-05");
+	ASSERT(checkWords(proximityQuery(*tree, "mat", "cat", 3), none, 0),
+			"Phrase-06");
+	ASSERT(checkWords(proximityQuery(*tree, "mat", "cat", 4), mat, 1),
+			"Phrase-07");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Phrase", score);
+	return 1;
+}
+
+char* randomText(long words, unsigned seed) {      // words of '-', ':', a-e
+	char* text = malloc(words * 10 + 1);
+	char* separators[] = {" ", " ", ", ", ",", ".", "\n", " ; "};
+	long at = 0;
+	srand(seed);
+	for(long i = 0; i < words; i++) {
+		for(int j = rand() % 6; j >= 0; j--)
+			text[at++] = "abcde-:"[(rand() % 9) % 7];
+		at += sprintf(text + at, "%s", separators[rand() % 7]);
+	}
+	text[at] = 0;
+	return text;
+}
+
+int sameWords(Range* a, Range* b) {                 // same order, both freed
+	int ok = a != NULL && b != NULL && a->size == b->size;
+	for(long i = 0; ok && i < a->size; i++)
+		ok = a->doc[i] == b->doc[i] && a->index[i] == b->index[i];
+	destroyRange(a);
+	destroyRange(b);
+	return ok;
+}
+
+char* corpusNames[] = {"test_corpus_0.txt", "test_corpus_1.txt",
+	"test_corpus_2.txt"};
+char* prefixes[] = {"", "a", "ab", "abc", "b-", "e:", "-", "zz"};
+char* intervals[][2] = {{"a", "b"}, {"ab", "ad"}, {"c", "c"}, {"b", "a"},
+	{"-", "::"}, {"dd", "zz"}};
+#define PREFIXES (sizeof(prefixes) / sizeof(char*))
+#define INTERVALS (sizeof(intervals) / sizeof(intervals[0]))
+
+int testBucketIndex(TTree **tree, float score) {
+	char* texts[] = {randomText(3000, 1), randomText(2000, 2), "cab:"};
+	writeTexts(corpusNames, texts, 3);
+	*tree = buildTreeFromCorpus(corpusNames, 3);
+	BucketIndex* index = buildBucketIndexFromCorpus(corpusNames, 3);
+
+	// The slots give the words of the tree, in the same order
+	for(int i = 0; i < PREFIXES; i++)
+		ASSERT(sameWords(bucketPrefixQuery(index, prefixes[i]),
+				singleKeyRangeQuery(*tree, prefixes[i])), "Bucket-01");
+	for(int i = 0; i < INTERVALS; i++)
+		ASSERT(sameWords(bucketIntervalQuery(index, intervals[i][0],
+				intervals[i][1]), multiKeyRangeQuery(*tree, intervals[i][0],
+				intervals[i][1])), "Bucket-02");
+	ASSERT(sameWords(bucketLookup(index, "abcd"),
+			multiKeyRangeQuery(*tree, "abc", "abc")), "Bucket-03");
+
+	removeTexts(corpusNames, 3);
+	free(texts[0]);
+	free(texts[1]);
+	destroyBucketIndex(index);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Bucket", score);
+	return 1;
+}
+
+Range* nodeWords(TreeNode* node) {                 // the copies of one key
+	Range* words = createRange();
+	if(node != NULL)
+		walkKey(node, NULL, words);
+	return words;
+}
+
+int testStaticIndex(TTree **tree, float score) {
+	char* texts[] = {randomText(3000, 3), randomText(2000, 4)};
+	char* keys[] = {"a", "ab", "abc", "abcd", "e:", "-", "zz"};
+	*tree = createTextTree(texts, 2);
+	// A deleted key is left out of the index
+	lazyDeleteKey(*tree, "ab");
+	StaticIndex* index = buildStaticIndex(*tree);
+
+	for(int i = 0; i < PREFIXES; i++)
+		ASSERT(sameWords(staticPrefixQuery(index, prefixes[i]),
+				singleKeyRangeQuery(*tree, prefixes[i])), "Static-01");
+	for(int i = 0; i < INTERVALS; i++)
+		ASSERT(sameWords(staticIntervalQuery(index, intervals[i][0],
+				intervals[i][1]), multiKeyRangeQuery(*tree, intervals[i][0],
+				intervals[i][1])), "Static-02");
+	// Short keys are packed without reading after their end
+	for(int i = 0; i < sizeof(keys) / sizeof(char*); i++)
+		ASSERT(sameWords(staticLookup(index, keys[i]),
+				nodeWords(keyHead(*tree, keys[i]))), "Static-03");
+
+	free(texts[0]);
+	free(texts[1]);
+	destroyStaticIndex(index);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Static", score);
+	return 1;
+}
+
+int testParallelQuery(TTree **tree, float score) {
+	char* texts[] = {randomText(20000, 5), randomText(10000, 6)};
+	*tree = createTextTree(texts, 2);
+	lazyDeleteKey(*tree, "abc");
+
+	// Every number of threads gives the slices back in key order
+	for(int threads = 1; threads <= 4; threads *= 2) {
+		for(int i = 0; i < PREFIXES; i++)
+			ASSERT(sameWords(parallelPrefixQuery(*tree, prefixes[i], threads),
+					singleKeyRangeQuery(*tree, prefixes[i])), "Parallel-01");
+		for(int i = 0; i < INTERVALS; i++)
+			ASSERT(sameWords(parallelRangeQuery(*tree, intervals[i][0],
+					intervals[i][1], threads), multiKeyRangeQuery(*tree,
+					intervals[i][0], intervals[i][1])), "Parallel-02");
+	}
+
+	free(texts[0]);
+	free(texts[1]);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Parallel", score);
+	return 1;
+}
+
+char* serverRequests[] = {
+	"{\"id\": 1, \"op\": \"prefix\", \"q\": \"ca\"}\n",
+	"{\"id\": 2, \"op\": \"interval\", \"q\": \"b\", \"p\": \"cat\"}\n",
+	"  {\"id\": \"x\", \"op\": \"count\", \"q\": \"the\"}\n",
+	"{\"id\": 4, \"op\": \"count\", \"q\": \"a\", \"p\": \"b\"}\n",
+	"\n",
+	"{\"id\": 5, \"q\": \"a\"}\n",
+	"{\"id\": 6, \"op\": \"prefix\"}\n",
+	"{\"id\": 7, \"op\": \"interval\", \"q\": \"a\"}\n",
+	"{\"id\": 8, \"op\": \"suffix\", \"q\": \"a\"}\n",
+	"not json\n",
+	"{\"id\": 10, \"note\": \"a \\\"}\\\", \\\\\", \"op\": \"prefix\", \"q\": \"do\"}\n",
+	"{\"id\": 11, \"op\": \"count\", \"q\": \"\\u0064og\"}\n",
+};
+
+char* serverAnswers[] = {
+	"{\"id\": 1, \"count\": 2, \"hits\": [[0, 4], [1, 12]]}\n",
+	"{\"id\": 2, \"count\": 3, \"hits\": [[2, 8], [0, 4], [1, 12]]}\n",
+	"{\"id\": \"x\", \"count\": 3}\n",
+	"{\"id\": 4, \"count\": 4}\n",
+	"",
+	"{\"id\": 5, \"error\": \"missing op or q\"}\n",
+	"{\"id\": 6, \"error\": \"missing op or q\"}\n",
+	"{\"id\": 7, \"error\": \"missing p\"}\n",
+	"{\"id\": 8, \"error\": \"unknown op\"}\n",
+	"{\"id\": null, \"error\": \"missing op or q\"}\n",
+	"{\"id\": 10, \"count\": 2, \"hits\": [[1, 2], [2, 4]]}\n",
+	"{\"id\": 11, \"count\": 0}\n",
+};
+
+int testServer(TTree **tree, float score) {
+	char request[2 * BUFLEN], answers[2 * BUFLEN] = "", got[2 * BUFLEN];
+	char* last = "{\"id\": 13, \"op\": \"count\", \"q\": \"o\"}";
+	int in[2], out[2];
+	long size = 0, length = 0, n;
+	*tree = createTextTree(corpusTexts, 3);
+	Server* server = createServer(*tree);
+	ASSERT(server != NULL && pipe(in) == 0 && pipe(out) == 0, "Server-01");
+
+	for(int i = 0; i < sizeof(serverRequests) / sizeof(char*); i++) {
+		writeAll(in[1], serverRequests[i], strlen(serverRequests[i]));
+		size += strlen(serverRequests[i]);
+		strcat(answers, serverAnswers[i]);
+	}
+	// A request that the end of the first read cuts in two, then a last
+	// request without a new line
+	sprintf(request, "{\"id\": 12,%*s\"op\": \"prefix\", \"q\": \"ma\"}\n",
+			BUFLEN, "");
+	ASSERT(size < BUFLEN && size + strlen(request) > BUFLEN, "Server-02");
+	writeAll(in[1], request, strlen(request));
+	writeAll(in[1], last, strlen(last));
+	strcat(answers, "{\"id\": 12, \"count\": 1, \"hits\": [[0, 19]]}\n");
+	strcat(answers, "{\"id\": 13, \"count\": 1}\n");
+	close(in[1]);
+
+	// The answers come back in the order of the requests
+	serveStream(server, in[0], out[1]);
+	close(in[0]);
+	close(out[1]);
+	while((n = read(out[0], got + length, sizeof(got) - length - 1)) > 0)
+		length += n;
+	got[length] = 0;
+	close(out[0]);
+	ASSERT(strcmp(got, answers) == 0, "Server-03");
+
+	destroyServer(server);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Server", score);
+	return 1;
+}
+
+int sameLists(TTree* a, TTree* b) {                // keys and postings
+	TreeNode* x = minimum(a, a->root);
+	TreeNode* y = minimum(b, b->root);
+	for(; x != NULL && y != NULL; x = x->next, y = y->next) {
+		Posting* px = x->info;
+		Posting* py = y->info;
+		if(strcmp(x->elem, y->elem) != 0 || px->doc != py->doc ||
+				px->offset != py->offset || px->position != py->position)
+			return 0;
+	}
+	return x == NULL && y == NULL;
+}
+
+int testIngest(TTree **tree, float score) {
+	// Two files bigger than INGEST_CHUNK, a missing one and a small one
+	char* names[] = {"test_corpus_0.txt", "test_corpus_1.txt",
+		"test_missing.txt", "test_corpus_2.txt"};
+	char* texts[] = {randomText(30000, 7), randomText(20000, 8),
+		"ab, cd,"};
+	writeTexts(corpusNames, texts, 3);
+	ASSERT(strlen(texts[0]) > INGEST_CHUNK && strlen(texts[1]) > INGEST_CHUNK,
+			"Ingest-01");
+	*tree = buildTreeFromCorpus(names, 4);
+	TTree* ingested = ingestCorpus(names, 4);
+
+	ASSERT(ingested != NULL && sameLists(*tree, ingested), "Ingest-02");
+	ASSERT(ingested->size == (*tree)->size, "Ingest-03");
+
+	removeTexts(corpusNames, 3);
+	free(texts[0]);
+	free(texts[1]);
+	destroyTree(ingested);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Ingest", score);
+	return 1;
+}
+
+int testScan(TTree **tree, float score) {
+	char* text = randomText(5000, 9);
+	// Commas with and without a space, dots, bytes that are not part of
+	// words and a last word with nothing after it
+	char* tail = "ab, cd,ef.gh\tij\x01kl 0ab ABc caf\xc3\xa9 d-:e, ,a, abc";
+	char* texts[] = {realloc(text, strlen(text) + strlen(tail) + 1)};
+	strcat(texts[0], tail);
+	writeTexts(corpusNames, texts, 1);
+	*tree = buildTreeFromFile(corpusNames[0]);
+
+	for(int i = 0; i < PREFIXES; i++)
+		ASSERT(sameWords(scanPrefixQuery(corpusNames[0], prefixes[i]),
+				singleKeyRangeQuery(*tree, prefixes[i])), "Scan-01");
+	for(int i = 0; i < INTERVALS; i++)
+		ASSERT(sameWords(scanIntervalQuery(corpusNames[0], intervals[i][0],
+				intervals[i][1]), multiKeyRangeQuery(*tree, intervals[i][0],
+				intervals[i][1])), "Scan-02");
+	ASSERT(sameWords(scanPrefixQuery(corpusNames[0], "ca"),
+			singleKeyRangeQuery(*tree, "ca")), "Scan-03");
+
+	removeTexts(corpusNames, 1);
+	free(texts[0]);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Scan", score);
+	return 1;
+}
+
+int editDistance(char* a, char* b) {               // plain Levenshtein table
+	int la = strlen(a), lb = strlen(b), d[8][8];
+	for(int i = 0; i <= la; i++)
+		for(int j = 0; j <= lb; j++)
+			if(i == 0 || j == 0)
+				d[i][j] = i + j;
+			else
+				d[i][j] = MIN(MIN(d[i - 1][j], d[i][j - 1]) + 1,
+						d[i - 1][j - 1] + (a[i - 1] != b[j - 1]));
+	return d[la][lb];
+}
+
+Range* editWords(TTree* tree, char* word, int maxEdits) {
+	Range* words = createRange();
+	char* q = createStrElement(word);
+	for(TreeNode* node = minimum(tree, tree->root); node != NULL;
+			node = node->end->next)
+		if(editDistance(node->elem, q) <= maxEdits)
+			walkKey(node, NULL, words);
+	destroyStrElement(q);
+	return words;
+}
+
+int testFuzzy(TTree **tree, float score) {
+	char* texts[] = {randomText(3000, 10), randomText(2000, 11)};
+	char* words[] = {"abc", "a", "", "e:-", "zzz", "abcdef", "bb"};
+	*tree = createTextTree(texts, 2);
+	lazyDeleteKey(*tree, "abd");
+
+	// The pruned walk finds the keys of a scan of every key
+	for(int i = 0; i < sizeof(words) / sizeof(char*); i++)
+		for(int edits = 0; edits <= 3; edits++)
+			ASSERT(sameWords(fuzzySearch(*tree, words[i], edits),
+					editWords(*tree, words[i], edits)), "Fuzzy-01");
+
+	free(texts[0]);
+	free(texts[1]);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Fuzzy", score);
+	return 1;
+}
+
+typedef struct InfixScan {
+	char* q;
+	Range* words;
+} InfixScan;
+
+void addInfixWord(void* context, char* word, long offset) {
+	InfixScan* scan = context;
+	int length = 0, lengthQ = strlen(scan->q);
+	while(isWordChar(word[length]))
+		length++;
+	for(int i = 0; i + lengthQ <= length; i++)
+		if(strncmp(word + i, scan->q, lengthQ) == 0) {
+			Posting posting = {offset, 0, 0};
+			addToRange(scan->words, &posting);
+			return;
+		}
+}
+
+int testSuffixArray(TTree **tree, float score) {
+	char* text = randomText(4000, 12);
+	char* tail = " abcabc cabbage -:- e, a";
+	char* texts[] = {realloc(text, strlen(text) + strlen(tail) + 1)};
+	char* qs[] = {"a", "bc", "cab", "abca", "-:", "e:e", "bbb", "x", "a b"};
+	strcat(texts[0], tail);
+	writeTexts(corpusNames, texts, 1);
+	SuffixArray* array = buildSuffixArrayFromFile(corpusNames[0]);
+	ASSERT(array != NULL, "Suffix-01");
+
+	// Every word that contains q, found by checking the words one by one
+	for(int i = 0; i < sizeof(qs) / sizeof(char*); i++) {
+		InfixScan scan = {qs[i], createRange()};
+		scanText(texts[0], strlen(texts[0]), 0, addInfixWord, &scan);
+		ASSERT(sameWords(infixQuery(array, qs[i]), scan.words), "Suffix-02");
+	}
+
+	removeTexts(corpusNames, 1);
+	free(texts[0]);
+	destroySuffixArray(array);
+	*tree = NULL;
+	printf(". ");
+	passed3("Suffix", score);
+	return 1;
+}
+
+#ifdef TREE_STATS
+int testStats(TTree **tree, float score) {
+	long copies[] = {1, 2, 3, 5, 8}, chains[TREE_STATS_BUCKETS] = {91, 2, 1, 1};
+	long value, i, rotations = 0;
+	TreeStats stats;
+	*tree = createLongTree(1, 0);
+
+	// Sorted keys keep rotating the tree
+	for(value = 1; value <= 100; value++) {
+		insert(*tree, &value, &value);
+		if(value % 10 == 0) {
+			ASSERT((*tree)->stats.rotations > rotations, "Stats-01");
+			rotations = (*tree)->stats.rotations;
+		}
+	}
+	// Keys 200 .. 204 with 1, 2, 3, 5 and 8 copies, then 10 keys deleted
+	for(i = 0; i < 5; i++)
+		for(value = 200 + i; copies[i] > 0; copies[i]--)
+			insert(*tree, &value, &value);
+	for(value = 1; value <= 10; value++)
+		delete(*tree, &value);
+
+	treeStatsSnapshot(*tree, NULL, NULL, &stats);
+	ASSERT(stats.nodes == 109 && stats.keys == 95, "Stats-02");
+	ASSERT(stats.nodesAllocated - stats.nodesFreed == stats.nodes, "Stats-03");
+	ASSERT(stats.height == (*tree)->root->height &&
+			stats.height <= stats.maxHeight, "Stats-04");
+	for(i = 0; i < TREE_STATS_BUCKETS; i++)
+		ASSERT(stats.chains[i] == chains[i], "Stats-05");
+	ASSERT(stats.compares > 0, "Stats-06");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Stats", score);
+	return 1;
+}
+#endif
+
+#ifdef QUERY_TRACE
+void countTraceEvent(TraceEvent* event, void* context) {
+	if(event->op == TRACE_PREFIX) {
+		((long*)context)[event->phase]++;
+	}
+}
+
+int testTrace(TTree **tree, float score) {
+	char *texts[] = {"ab abc abd b ab", "abc ba"};
+	long phases[TRACE_PHASES] = {0}, expected[TRACE_PHASES] = {0};
+	long value, end;
+	int bucket, bit;
+
+	// Every bucket ends right before the next one and is 25% wide at most
+	for(bucket = 0; traceBucketEnd(bucket) < (1L << 61); bucket++) {
+		end = traceBucketEnd(bucket);
+		ASSERT(traceBucket(end) == bucket && traceBucket(end + 1) == bucket + 1,
+				"Trace-01");
+		if(bucket >= TRACE_SUB_BUCKETS) {
+			value = traceBucketEnd(bucket - 1) + 1;
+			ASSERT((end - value + 1) * TRACE_SUB_BUCKETS <= value, "Trace-02");
+		}
+	}
+	for(bit = TRACE_SUB_BITS; bit < 62; bit++) {
+		ASSERT(traceBucket(1L << bit) ==
+				(bit - TRACE_SUB_BITS + 1) << TRACE_SUB_BITS, "Trace-03");
+		ASSERT(traceBucket((1L << bit) - 1) ==
+				((bit - TRACE_SUB_BITS + 1) << TRACE_SUB_BITS) - 1, "Trace-03");
+	}
+
+	// 1 .. 100 and 10000: the ends of the buckets of 51, 100 and 10000
+	memset(&traceOps[TRACE_PRINT], 0, sizeof(TraceHistogram));
+	for(value = 1; value <= 100; value++)
+		traceRecord(TRACE_PRINT, value);
+	traceRecord(TRACE_PRINT, 10000);
+	ASSERT(traceQuantile(TRACE_PRINT, 0.5) == 55, "Trace-04");
+	ASSERT(traceQuantile(TRACE_PRINT, 0.99) == 111, "Trace-05");
+	ASSERT(traceQuantile(TRACE_PRINT, 0.999) == 10000, "Trace-06");
+	memset(&traceOps[TRACE_PRINT], 0, sizeof(TraceHistogram));
+
+	// One event for every phase of a prefix query
+	*tree = createTextTree(texts, 2);
+	setTraceHook(countTraceEvent, phases);
+	destroyRange(singleKeyRangeQuery(*tree, "ab"));
+	setTraceHook(NULL, NULL);
+	expected[TRACE_GROW] = expected[TRACE_DESCENT] = 1;
+	expected[TRACE_WALK] = expected[TRACE_TOTAL] = 1;
+	ASSERT(memcmp(phases, expected, sizeof(phases)) == 0, "Trace-07");
+
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Trace", score);
+	return 1;
+}
+#endif
+
+TreeNode* searchWord(TTree* tree, char* word) {     // search without hash
+	TreeNode* node = tree->root;
+	while(node != NULL && strcmp(node->elem, word) != 0)
+		node = strcmp(node->elem, word) > 0 ? node->lt : node->rt;
+	return node;
+}
+
+int checkWordTree(TTree* tree) {                    // list, balance, hash
+	TreeNode* node = minimum(tree, tree->root);
+	long n = 0;
+	if((tree->policy == TREE_WAVL ? checkRanks(tree->root) :
+			checkBalance(tree->root)) < 0 || (node != NULL && node->prev != NULL))
+		return 0;
+	for(; node != NULL; node = node->next, n++) {
+		if(node->next != NULL && (node->next->prev != node ||
+				strcmp(node->elem, node->next->elem) > 0))
+			return 0;
+		if(node->prev == NULL || strcmp(node->prev->elem, node->elem) != 0)
+			if(search(tree, tree->root, node->elem) !=
+					(TOMBSTONE(node) ? NULL : node) ||
+					searchWord(tree, node->elem) != node)
+				return 0;
+	}
+	return n == tree->size + tree->tombstones && tree->hashIndex != NULL;
+}
+
+int sameQueries(TTree* a, TTree* b) {               // prefixes and intervals
+	for(int i = 0; i < PREFIXES; i++)
+		if(!sameWords(singleKeyRangeQuery(a, prefixes[i]),
+				singleKeyRangeQuery(b, prefixes[i])))
+			return 0;
+	for(int i = 0; i < INTERVALS; i++)
+		if(!sameWords(multiKeyRangeQuery(a, intervals[i][0], intervals[i][1]),
+				multiKeyRangeQuery(b, intervals[i][0], intervals[i][1])))
+			return 0;
+	return 1;
+}
+
+int testCompact(TTree **tree, float score) {
+	char* texts[] = {randomText(2000, 5), randomText(1000, 6)};
+	char* added[] = {"ab", "zz", "-a", "abc", "e:e", "ab"};
+	char* removed[] = {"ab", "b", "c-", "abc", "zz", "d"};
+	char* erased[] = {"a", "e:e", "c", "b-"};
+	Posting posting = {0, 2, 0};
+	long steps;
+	TTree* copy = NULL;
+
+	// Once with each policy
+	for(int policy = TREE_AVL; policy <= TREE_WAVL; policy++) {
+		*tree = createTextTree(texts, 2);
+		copy = createTextTree(texts, 2);
+		ASSERT(setTreePolicy(*tree, policy) == 1, "Compact-01");
+		ASSERT(enableHashIndex(*tree, hashStrElement) == 1, "Compact-01");
+		ASSERT(enableHashIndex(copy, hashStrElement) == 1, "Compact-01");
+
+		// The same inserts and deletes (some of them lazy) between the steps as
+		// on the copy
+		for(steps = 0; compactStep(*tree, 7); steps++) {
+			posting.offset = posting.position = steps;
+			insert(*tree, added[steps % 6], &posting);
+			insert(copy, added[steps % 6], &posting);
+			delete(*tree, removed[steps % 6]);
+			delete(copy, removed[steps % 6]);
+			lazyDelete(*tree, erased[steps % 4]);
+			lazyDelete(copy, erased[steps % 4]);
+		}
+		ASSERT(steps > 10, "Compact-02");
+		ASSERT(minimum(*tree, (*tree)->root)->arena != NULL, "Compact-02");
+		ASSERT(checkWordTree(*tree) && sameLists(*tree, copy), "Compact-03");
+		ASSERT(sameQueries(*tree, copy), "Compact-04");
+
+		// A whole compact, then the tree keeps working
+		compact(*tree);
+		insert(*tree, "abd", &posting);
+		insert(copy, "abd", &posting);
+		delete(*tree, "b");
+		delete(copy, "b");
+		ASSERT(checkWordTree(*tree) && sameLists(*tree, copy), "Compact-05");
+		ASSERT(sameQueries(*tree, copy), "Compact-06");
+
+		destroyTree(copy);
+		destroyTree(*tree);
+		*tree = NULL;
+	}
+
+	free(texts[0]);
+	free(texts[1]);
+	printf(". ");
+	passed3("Compact", score);
+	return 1;
+}
+
+void* createWholeWord(void* str) {                 // a key of any length
+	char* word = malloc(strlen(str) + 1);
+	strcpy(word, str);
+	return word;
+}
+
+int testFrontCoding(TTree **tree, float score) {
+	char word[64], *qs[] = {"", "a", "ab", "abab", "ba-b", "aaaaaaaaaaaaaaaa",
+		"abababababababababab", "b-b-b-", "c"};
+	Posting posting = {0, 0, 0};
+	*tree = createTree(createWholeWord, destroyStrElement, createIndexInfo,
+			destroyIndexInfo, compareStrElem);
+	// Words up to 40 characters from 3 letters, a tenth of them after 16 a's,
+	// so both the short and the escaped lengths are written
+	srand(13);
+	for(int i = 0; i < 3000; i++) {
+		int length = 1 + (rand() % 4 ? rand() % 8 : rand() % 40), j = 0;
+		for(; i % 10 == 0 && j < 16; j++)
+			word[j] = 'a';
+		for(; j < length + (i % 10 == 0 ? 16 : 0); j++)
+			word[j] = "ab-"[rand() % 3];
+		word[j] = 0;
+		posting.offset = i;
+		insert(*tree, word, &posting);
+	}
+	lazyDeleteKey(*tree, "ab");
+	FrontDict* dict = buildFrontDict(*tree);
+
+	for(int i = 0; i < sizeof(qs) / sizeof(char*); i++) {
+		ASSERT(sameWords(frontPrefixQuery(dict, qs[i]),
+				singleKeyRangeQuery(*tree, qs[i])), "Front-01");
+		ASSERT(sameWords(frontLookup(dict, qs[i]),
+				nodeWords(search(*tree, (*tree)->root, qs[i]))), "Front-02");
+		for(int j = 0; j < sizeof(qs) / sizeof(char*); j++)
+			ASSERT(sameWords(frontIntervalQuery(dict, qs[i], qs[j]),
+					multiKeyRangeQuery(*tree, qs[i], qs[j])), "Front-03");
+	}
+	// Every key of the tree is found again
+	for(TreeNode* node = minimum(*tree, (*tree)->root); node != NULL;
+			node = node->end->next)
+		ASSERT(sameWords(frontLookup(dict, node->elem), nodeWords(node)),
+				"Front-04");
+
+	destroyFrontDict(dict);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("Front", score);
+	return 1;
+}
+
+LSMTree* createTextLSM(char** texts, int count, int background) {
+	LSMTree* lsm = createLSMTree(".", 50, background);  // a flush every 50 words
+	Tokenizer tokenizer;
+	for(int doc = 0; doc < count; doc++) {
+		initTokenizer(&tokenizer, doc, insertLSMWord, lsm);
+		tokenize(&tokenizer, texts[doc], strlen(texts[doc]), 0);
+		finishTokenizer(&tokenizer);
+	}
+	return lsm;
+}
+
+int testLSM(TTree **tree, float score) {
+	char* texts[] = {randomText(3000, 14), randomText(2000, 15)};
+	char* keys[] = {"a", "ab", "abc", "abcd", "e:", "-", "zz"};
+	char* left[] = {"run-0.lsm"}, *leftText[] = {"not a run\n"}, line[16];
+	*tree = createTextTree(texts, 2);
+	// A file left in the directory is not overwritten by the runs
+	writeTexts(left, leftText, 1);
+
+	// Both indexes write their runs in the same directory at the same time
+	for(int background = 0; background <= 1; background++) {
+		LSMTree* lsm = createTextLSM(texts, 2, background);
+		LSMTree* other = createTextLSM(texts + 1, 1, background);
+		ASSERT(lsm != NULL && other != NULL && lsm->runs != NULL, "LSM-01");
+		for(int i = 0; i < PREFIXES; i++)
+			ASSERT(sameWords(lsmPrefixQuery(lsm, prefixes[i]),
+					singleKeyRangeQuery(*tree, prefixes[i])), "LSM-02");
+		for(int i = 0; i < INTERVALS; i++)
+			ASSERT(sameWords(lsmIntervalQuery(lsm, intervals[i][0],
+					intervals[i][1]), multiKeyRangeQuery(*tree,
+					intervals[i][0], intervals[i][1])), "LSM-03");
+		for(int i = 0; i < sizeof(keys) / sizeof(char*); i++)
+			ASSERT(sameWords(lsmLookup(lsm, keys[i]),
+					nodeWords(keyHead(*tree, keys[i]))), "LSM-04");
+		destroyLSMTree(other);
+		destroyLSMTree(lsm);
+	}
+
+	FILE* in = fopen(left[0], "r");
+	ASSERT(in != NULL && fgets(line, 16, in) != NULL &&
+			strcmp(line, leftText[0]) == 0, "LSM-05");
+	fclose(in);
+	removeTexts(left, 1);
+	free(texts[0]);
+	free(texts[1]);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("LSM", score);
+	return 1;
+}
+
+int testDocStore(TTree **tree, float score) {
+	char* words = randomText(6000, 16), line[4096], expected[4096];
+	char* names[] = {"test_corpus_0.txt"}, *store = "test_corpus_0.store";
+	unsigned char* compressed = malloc(DOC_BOUND);
+	unsigned char* block = malloc(DOC_BLOCK);
+	long size = 0, length = strlen(words);
+	// Words that compress well between random bytes that don't, long enough
+	// to fill a block, none of them 0 so the lines can be compared as strings
+	char* text = malloc(3 * length + 4 * DOC_BLOCK + 1);
+	srand(16);
+	for(int part = 0; part < 5; part++)
+		if(part % 2 == 0) {
+			memcpy(text + size, words, length);
+			size += length;
+		} else
+			for(int i = 0; i < 2 * DOC_BLOCK; i++)
+				text[size++] = 1 + rand() % 255;
+	text[size] = 0;
+	ASSERT(length > DOC_BLOCK && size > 4 * DOC_BLOCK, "DocStore-01");
+	writeTexts(names, &text, 1);
+
+	ASSERT(buildDocStore(names[0], store), "DocStore-02");
+	DocStore* docs = openDocStore(store);
+	ASSERT(docs != NULL && docs->header.size == size, "DocStore-03");
+	// Some blocks are compressed and some are kept as they are
+	long smaller = 0, kept = 0;
+	for(long b = 0; b + 1 < docs->header.blocks; b++) {
+		smaller += docs->start[b + 1] - docs->start[b] < DOC_BLOCK;
+		kept += docs->start[b + 1] - docs->start[b] == DOC_BLOCK;
+	}
+	ASSERT(smaller > 0 && kept > 0, "DocStore-04");
+
+	// The whole text comes back, line by line
+	for(long at = 0; at < size; at += strlen(line))
+		ASSERT(docStoreLine(docs, at, line, sizeof(line)) != NULL &&
+				strncmp(line, text + at, strlen(line)) == 0, "DocStore-05");
+	ASSERT(docStoreLine(docs, size, line, sizeof(line)) == NULL, "DocStore-06");
+
+	// The same lines as fseek and fgets, with short and long buffers
+	FILE* in = fopen(names[0], "rb");
+	for(int i = 0; i < 2000; i++) {
+		long at = rand() % size;
+		int n = (i % 2) ? sizeof(line) : 2 + rand() % 30;
+		fseek(in, at, SEEK_SET);
+		ASSERT(fgets(expected, n, in) != NULL &&
+				docStoreLine(docs, at, line, n) != NULL &&
+				strcmp(line, expected) == 0, "DocStore-07");
+	}
+	fclose(in);
+
+	// A block that is cut short is damaged, whatever the place of the cut
+	memcpy(block, words, DOC_BLOCK);
+	long n = compressBlock(block, DOC_BLOCK, compressed);
+	ASSERT(n < DOC_BLOCK && decompressBlock(compressed, n, block, DOC_BLOCK) &&
+			memcmp(block, words, DOC_BLOCK) == 0, "DocStore-08");
+	for(long cut = 0; cut < n; cut++)
+		ASSERT(!decompressBlock(compressed, cut, block, DOC_BLOCK),
+				"DocStore-09");
+
+	closeDocStore(docs);
+	remove(store);
+	removeTexts(names, 1);
+	free(compressed);
+	free(block);
+	free(words);
+	free(text);
+	*tree = NULL;
+	printf(". ");
+	passed3("DocStore", score);
+	return 1;
+}
+
+int sameHits(DocStore* docs, FILE* in, Range* range, long* crossing) {
+	char line[4096], *token;
+	DocWords* words = docStoreWords(docs, range);
+	int ok = words != NULL && words->size == range->size;
+	for(int i = 0; ok && i < range->size; i++) {
+		fseek(in, range->index[i], SEEK_SET);
+		ok = fgets(line, sizeof(line), in) != NULL && words->at[i] >= 0;
+		token = ok ? strtok(line, " .,\n") : NULL;
+		// A line without a word is an empty word
+		if(token == NULL)
+			token = "";
+		ok = ok && strcmp(words->text + words->at[i], token) == 0;
+		// The ends of the blocks inside the word
+		for(long end = DOC_BLOCK; ok && end < range->index[i] + strlen(token);
+				end += DOC_BLOCK)
+			*crossing += range->index[i] < end;
+	}
+	destroyDocWords(words);
+	destroyRange(range);
+	return ok;
+}
+
+int testDocHits(TTree **tree, float score) {
+	char* text = randomText(9000, 17);
+	char* names[] = {"test_corpus_0.txt"}, *store = "test_corpus_0.store";
+	long crossing = 0;
+	// Two words across the ends of the first two blocks
+	ASSERT(strlen(text) > 2 * DOC_BLOCK + 8, "DocHits-01");
+	memcpy(text + DOC_BLOCK - 4, " abcdef ", 8);
+	memcpy(text + 2 * DOC_BLOCK - 2, " ab:e- ", 7);
+	writeTexts(names, &text, 1);
+	*tree = buildTreeFromFile(names[0]);
+	ASSERT(*tree != NULL && buildDocStore(names[0], store), "DocHits-02");
+	DocStore* docs = openDocStore(store);
+	FILE* in = fopen(names[0], "rb");
+	ASSERT(docs != NULL && in != NULL, "DocHits-02");
+
+	// The word of every hit is the token of fgets and strtok
+	for(int i = 0; i < PREFIXES; i++)
+		ASSERT(sameHits(docs, in, singleKeyRangeQuery(*tree, prefixes[i]),
+				&crossing), "DocHits-03");
+	for(int i = 0; i < INTERVALS; i++)
+		ASSERT(sameHits(docs, in, multiKeyRangeQuery(*tree, intervals[i][0],
+				intervals[i][1]), &crossing), "DocHits-04");
+	ASSERT(crossing >= 2, "DocHits-05");
+
+	fclose(in);
+	closeDocStore(docs);
+	remove(store);
+	removeTexts(names, 1);
+	free(text);
+	destroyTree(*tree);
+	*tree = NULL;
+	printf(". ");
+	passed3("DocHits", score);
+	return 1;
+}
+
 typedef struct Test {
 	int (*testFunction)(TTree** tree, float);
 	float score;
@@ -378,6 +1785,36 @@ int main(int argc, char* argv[]) {
 		{ &testTreeListInsert, 0.1},
 		{ &testTreeListDelete, 0.1},
 		{ &testFree, 0.05 },
+		{ &testSplitJoin, 0.05 },
+		{ &testUnion, 0.05 },
+		{ &testDeleteRange, 0.05 },
+		{ &testCounts, 0.05 },
+		{ &testHashIndex, 0.05 },
+		{ &testBatch, 0.05 },
+		{ &testWavl, 0.05 },
+		{ &testCursor, 0.05 },
+		{ &testLazyDelete, 0.05 },
+		{ &testBoolean, 0.05 },
+		{ &testPhrase, 0.05 },
+		{ &testBucketIndex, 0.05 },
+		{ &testStaticIndex, 0.05 },
+		{ &testParallelQuery, 0.05 },
+		{ &testServer, 0.05 },
+		{ &testIngest, 0.05 },
+		{ &testScan, 0.05 },
+		{ &testFuzzy, 0.05 },
+		{ &testSuffixArray, 0.05 },
+#ifdef TREE_STATS
+		{ &testStats, 0.05 },
+#endif
+#ifdef QUERY_TRACE
+		{ &testTrace, 0.05 },
+#endif
+		{ &testCompact, 0.05 },
+		{ &testFrontCoding, 0.05 },
+		{ &testLSM, 0.05 },
+		{ &testDocStore, 0.05 },
+		{ &testDocHits, 0.05 },
 	};
 
 	float totalScore = 0.0f, maxScore = 0.0f;
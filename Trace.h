@@ -0,0 +1,232 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/*
+ * Built with -DQUERY_TRACE (make trace), the queries, the build of a tree and
+ * the printing of the results time themselves with the monotonic clock:
+ * every call goes into a latency histogram of its kind of operation, and
+ * every phase inside it (the descent, the walk along the list, the growth of
+ * the result, the I/O, the insertion) is a span that adds to the total of
+ * its phase and is given to the trace hook, if there is one. Without
+ * QUERY_TRACE the macros are empty and cost nothing.
+ *
+ * A histogram has TRACE_SUB_BUCKETS buckets for every power of two of
+ * nanoseconds, so a percentile is known within 25% of its value. The counters
+ * are updated with relaxed atomics, so the server threads can share them.
+ */
+#define TRACE_SUB_BITS 2
+#define TRACE_SUB_BUCKETS (1 << TRACE_SUB_BITS)
+#define TRACE_BUCKETS (64 * TRACE_SUB_BUCKETS)
+
+//the operations that have a histogram
+#define TRACE_PREFIX 0
+#define TRACE_INTERVAL 1
+#define TRACE_BUILD 2
+#define TRACE_PRINT 3
+#define TRACE_OPS 4
+//the phases inside them; TRACE_NONE is a span outside of a known operation
+#define TRACE_DESCENT 0
+#define TRACE_WALK 1
+#define TRACE_GROW 2
+#define TRACE_IO 3
+#define TRACE_INSERT 4
+#define TRACE_TOTAL 5
+#define TRACE_PHASES 6
+#define TRACE_NONE -1
+
+#ifdef QUERY_TRACE
+
+#include <stdio.h>
+#include <time.h>
+
+typedef struct TraceEvent{
+	int op;
+	int phase;
+	//nanoseconds of the monotonic clock
+	long start;
+	long duration;
+}TraceEvent;
+
+typedef struct TraceHistogram{
+	long buckets[TRACE_BUCKETS];
+	long count;
+	long total;
+	long max;
+}TraceHistogram;
+
+TraceHistogram traceOps[TRACE_OPS];
+long tracePhaseTotal[TRACE_PHASES], tracePhaseCount[TRACE_PHASES];
+void (*traceHook)(TraceEvent*, void*) = NULL;
+void *traceContext = NULL;
+
+//a span starts where the one before it ended, so a phase costs one clock read
+#define TRACE_MARK(span) long span = traceNow()
+#define TRACE_BEGIN(span) TRACE_MARK(span); long span##Start = span
+#define TRACE_PHASE(op, phase, span) span = traceSpan((op), (phase), span)
+#define TRACE_END(op, span) traceOperation((op), span##Start)
+
+/*
+ * Name function: traceNow
+ * Return: the time of the monotonic clock in nanoseconds
+ * Arguments: none
+ * Purpose: the start and the end of the spans
+ */
+long traceNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/*
+ * Name function: traceBucket
+ * Return: the bucket of a duration
+ * Arguments: a duration in nanoseconds
+ * Purpose: the most significant bit gives the power of two and the next
+ * TRACE_SUB_BITS bits the bucket inside it
+ */
+int traceBucket(long duration) {
+	int msb;
+	if(duration < TRACE_SUB_BUCKETS) {
+		return duration < 0 ? 0 : duration;
+	}
+	msb = 63 - __builtin_clzl(duration);
+	return ((msb - TRACE_SUB_BITS + 1) << TRACE_SUB_BITS) +
+			((duration >> (msb - TRACE_SUB_BITS)) & (TRACE_SUB_BUCKETS - 1));
+}
+
+/*
+ * Name function: traceBucketEnd
+ * Return: the biggest duration of a bucket
+ * Arguments: a bucket
+ * Purpose: report a percentile by the end of its bucket, so it is never
+ * smaller than the real one
+ */
+long traceBucketEnd(int bucket) {
+	int msb;
+	if(bucket < TRACE_SUB_BUCKETS) {
+		return bucket;
+	}
+	msb = (bucket >> TRACE_SUB_BITS) + TRACE_SUB_BITS - 1;
+	return ((long)(TRACE_SUB_BUCKETS + (bucket & (TRACE_SUB_BUCKETS - 1)) + 1)
+			<< (msb - TRACE_SUB_BITS)) - 1;
+}
+
+/*
+ * Name function: setTraceHook
+ * Return: void (it does not return a value)
+ * Arguments: the function that gets every span (NULL for none) and its
+ * context
+ * Purpose: emit the trace events somewhere else, for example to a file
+ */
+void setTraceHook(void (*hook)(TraceEvent*, void*), void* context) {
+	traceContext = context;
+	traceHook = hook;
+}
+
+/*
+ * Name function: traceSpan
+ * Return: the time when the span ended
+ * Arguments: the operation, the phase and the time when the span started
+ * Purpose: add a span to the total of its phase and give it to the hook
+ */
+long traceSpan(int op, int phase, long start) {
+	long end = traceNow();
+	TraceEvent event = {op, phase, start, end - start};
+	__atomic_fetch_add(&tracePhaseTotal[phase], end - start, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&tracePhaseCount[phase], 1, __ATOMIC_RELAXED);
+	if(traceHook != NULL) {
+		traceHook(&event, traceContext);
+	}
+	return end;
+}
+
+/*
+ * Name function: traceRecord
+ * Return: void (it does not return a value)
+ * Arguments: the operation and its latency in nanoseconds
+ * Purpose: add a latency to the histogram of the operation
+ */
+void traceRecord(int op, long duration) {
+	TraceHistogram *histogram = &traceOps[op];
+	long max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&histogram->buckets[traceBucket(duration)], 1,
+			__ATOMIC_RELAXED);
+	__atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&histogram->total, duration, __ATOMIC_RELAXED);
+	while(duration > max && !__atomic_compare_exchange_n(&histogram->max, &max,
+			duration, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/*
+ * Name function: traceOperation
+ * Return: void (it does not return a value)
+ * Arguments: the operation and the time when it started
+ * Purpose: add the latency of a whole operation to its histogram
+ */
+void traceOperation(int op, long start) {
+	traceRecord(op, traceSpan(op, TRACE_TOTAL, start) - start);
+}
+
+/*
+ * Name function: traceQuantile
+ * Return: the latency in nanoseconds that q of the calls did not exceed
+ * (within a bucket), 0 if there were no calls
+ * Arguments: the operation and the quantile, like 0.99
+ * Purpose: the p50/p99/p999 of an operation
+ */
+long traceQuantile(int op, double q) {
+	TraceHistogram *histogram = &traceOps[op];
+	long rank = (long)(q * histogram->count + 0.999999), seen = 0;
+	int i;
+	if(histogram->count == 0) {
+		return 0;
+	}
+	for(i = 0; i < TRACE_BUCKETS; i++) {
+		seen += histogram->buckets[i];
+		if(seen >= rank) {
+			return MIN(traceBucketEnd(i), histogram->max);
+		}
+	}
+	return histogram->max;
+}
+
+/*
+ * Name function: dumpTrace
+ * Return: void (it does not return a value)
+ * Arguments: the file I write to
+ * Purpose: write the latencies of every operation and the total time of every
+ * phase, one line each, in nanoseconds
+ */
+void dumpTrace(FILE* out) {
+	char *ops[TRACE_OPS] = {"prefix", "interval", "build", "print"};
+	char *phases[TRACE_PHASES] = {"descent", "walk", "grow", "io", "insert",
+			"total"};
+	int i;
+	for(i = 0; i < TRACE_OPS; i++) {
+		if(traceOps[i].count == 0) {
+			continue;
+		}
+		fprintf(out, "op %s count %ld mean %ld p50 %ld p99 %ld p999 %ld max %ld\n",
+				ops[i], traceOps[i].count, traceOps[i].total / traceOps[i].count,
+				traceQuantile(i, 0.5), traceQuantile(i, 0.99),
+				traceQuantile(i, 0.999), traceOps[i].max);
+	}
+	for(i = 0; i < TRACE_PHASES; i++) {
+		if(tracePhaseCount[i] == 0) {
+			continue;
+		}
+		fprintf(out, "phase %s count %ld total %ld\n", phases[i],
+				tracePhaseCount[i], tracePhaseTotal[i]);
+	}
+}
+
+#else
+
+#define TRACE_MARK(span)
+#define TRACE_BEGIN(span)
+#define TRACE_PHASE(op, phase, span)
+#define TRACE_END(op, span)
+
+#endif
+
+#endif /* TRACE_H_ */